@@ -0,0 +1,781 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "libviconstream/viconstream.h"
+#include "libviconstream/simulated_source.h"
+#include "libviconstream/point_cloud.h"
+#include "libviconstream/recording.h"
+
+using namespace libviconstream;
+
+namespace
+{
+/** @brief One point of the parameter sweep. */
+struct bench_case
+{
+  std::string sweep;
+  unsigned int callbacks;
+  unsigned int subjects;
+  unsigned int segments;
+  unsigned int markers;
+  double frame_rate;
+  DispatchMode::Enum mode;
+  GrabWait::Enum grab_wait;
+  StreamMode::Enum stream_mode;
+
+  /* Each callback subscribes to one subject, else to everything. */
+  bool filtered;
+};
+
+/** @brief Results of one unpaced and one realtime run of a case. */
+struct bench_result
+{
+  /* Unpaced: the grabber runs as fast as the arbiter allows. */
+  double throughput;
+  double frame_ns;
+  double extraction_ns;
+  double dispatch_ns;
+
+  /* Realtime: frames are paced at the case's frame rate. */
+  double delivered_rate;
+  uint64_t lost;
+  uint64_t dropped;
+  latency_stats latency;
+
+  /* From the frame being due at the source to the first callback, which
+     unlike callback_start includes the grabber's wait. */
+  latency_summary frame_to_callback;
+};
+
+/** @brief The baseline, every sweep varies one parameter of it. */
+bench_case baseline()
+{
+  bench_case c;
+  c.sweep       = "baseline";
+  c.callbacks   = 1;
+  c.subjects    = 10;
+  c.segments    = 5;
+  c.markers     = 0;
+  c.frame_rate  = 200;
+  c.mode        = DispatchMode::Inline;
+  c.grab_wait   = GrabWait::Adaptive;
+  c.stream_mode = StreamMode::ServerPush;
+  c.filtered    = false;
+
+  return c;
+}
+
+/** @brief Counts frames and lost frames as seen by a callback. */
+struct frame_counter
+{
+  std::atomic< uint64_t > frames;
+  std::atomic< uint64_t > lost;
+  unsigned int last;
+
+  /* The paced source, to measure from when each frame was due. */
+  const simulated_source *source;
+  latency_histogram due_latency;
+
+  frame_counter() : frames(0), lost(0), last(0), source(nullptr)
+  {
+  }
+
+  void operator()(const frame &f)
+  {
+    /* Touch the data like a real consumer would. */
+    if (!f.subjects.empty())
+    {
+      volatile double x =
+          f.segments[f.subjects[0].root_segment].global.translation[0];
+      (void)x;
+    }
+
+    if (last != 0 && f.frame_number > last + 1)
+      lost.fetch_add(f.frame_number - last - 1, std::memory_order_relaxed);
+
+    if (source)
+      due_latency.record(
+          std::chrono::duration_cast< std::chrono::nanoseconds >(
+              std::chrono::steady_clock::now() -
+              source->frameDue(f.frame_number))
+              .count());
+
+    last = f.frame_number;
+    frames.fetch_add(1, std::memory_order_relaxed);
+  }
+};
+
+/**
+ * @brief   Runs the arbiter on a simulated source for a while.
+ *
+ * @param[in]  c          The case to run.
+ * @param[in]  realtime   Pace the frames or run unpaced.
+ * @param[in]  duration   Run time in seconds.
+ * @param[out] counter    Frame count of the first callback.
+ * @param[out] stats      Latency of the run.
+ * @param[out] dropped    Frames dropped by async queues.
+ *
+ * @return  The measured run time in seconds.
+ */
+double run(const bench_case &c, const bool realtime, const double duration,
+           frame_counter &counter, latency_stats &stats, uint64_t &dropped)
+{
+  simulator_settings s;
+  s.subjects   = c.subjects;
+  s.segments   = c.segments;
+  s.markers    = c.markers;
+  s.frame_rate = c.frame_rate;
+  s.realtime   = realtime;
+
+  std::ostream null_log(nullptr);
+  simulated_source *source = new simulated_source(s);
+  arbiter vs(std::unique_ptr< frame_source >(source), null_log);
+
+  if (realtime)
+    counter.source = source;
+
+  /* Unpaced async subscribers block, so every frame is delivered. */
+  const OverflowPolicy::Enum policy =
+      realtime ? OverflowPolicy::DropOldest : OverflowPolicy::Block;
+
+  std::vector< frame_counter > others(c.callbacks - 1);
+  std::vector< unsigned int > ids;
+
+  for (unsigned int i = 0; i < c.callbacks; i++)
+  {
+    frame_counter &fc = (i == 0 ? counter : others[i - 1]);
+
+    subscription filter;
+    if (c.filtered)
+      filter = subscription({"subject" + std::to_string(i % c.subjects)});
+
+    ids.push_back(
+        vs.registerCallback(filter, std::ref(fc), c.mode, 16, policy));
+  }
+
+  vs.enableStream(true, c.markers > 0, false, false, c.stream_mode,
+                  c.grab_wait);
+
+  /* Measure from a clean state, after the connection's test frames. */
+  const uint64_t start_frames = counter.frames;
+  vs.resetLatencyStats();
+  counter.due_latency.reset();
+
+  const auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::duration< double >(duration));
+
+  vs.latencyStats(stats);
+  const uint64_t frames = counter.frames - start_frames;
+  const double elapsed  = std::chrono::duration< double >(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+  dropped = 0;
+
+  for (auto id : ids)
+  {
+    subscriber_stats ss;
+
+    if (vs.callbackStats(id, ss))
+      dropped += ss.dropped;
+  }
+
+  vs.disableStream();
+
+  counter.frames = frames;
+  return elapsed;
+}
+
+bench_result runCase(const bench_case &c, const double duration)
+{
+  bench_result r;
+  latency_stats unpaced;
+  uint64_t dropped;
+
+  {
+    frame_counter counter;
+    const double elapsed =
+        run(c, false, duration, counter, unpaced, dropped);
+
+    r.throughput    = counter.frames / elapsed;
+    r.frame_ns      = counter.frames > 0 ? 1e9 / r.throughput : 0;
+    r.extraction_ns = 1e9 * unpaced.extraction.mean;
+    r.dispatch_ns   = r.frame_ns - r.extraction_ns;
+  }
+
+  {
+    frame_counter counter;
+    const double elapsed =
+        run(c, true, duration, counter, r.latency, r.dropped);
+
+    r.delivered_rate    = counter.frames / elapsed;
+    r.lost              = counter.lost;
+    r.frame_to_callback = counter.due_latency.summary();
+  }
+
+  return r;
+}
+
+const char *grabWaitName(const GrabWait::Enum w)
+{
+  if (w == GrabWait::FixedSleep)
+    return "fixed_sleep";
+  else if (w == GrabWait::Blocking)
+    return "blocking";
+  else
+    return "adaptive";
+}
+
+const char *streamModeName(const StreamMode::Enum m)
+{
+  if (m == StreamMode::ServerPush)
+    return "server_push";
+  else if (m == StreamMode::ClientPull)
+    return "client_pull";
+  else
+    return "client_pull_prefetch";
+}
+
+/** @brief Cost of processing the unlabeled markers of one frame. */
+struct cloud_result
+{
+  unsigned int markers;
+  double per_index_ns;
+  double bulk_ns;
+  size_t kept;
+};
+
+/**
+ * @brief   Moves a frame's unlabeled markers into a body's frame and crops
+ *          them to a box, one marker at a time as with the SDK's per index
+ *          getter and in bulk with a @p point_cloud.
+ *
+ * @param[in] markers   Number of unlabeled markers.
+ * @param[in] duration  Run time of each method in seconds.
+ */
+cloud_result runCloud(const unsigned int markers, const double duration)
+{
+  simulator_settings s;
+  s.subjects          = 1;
+  s.unlabeled_markers = markers;
+  s.realtime          = false;
+
+  simulated_source sim(s);
+  stream_settings settings;
+  settings.unlabeled_marker_data = true;
+
+  sim.connect();
+  sim.configure(settings);
+
+  /* A few frames, so the work is not on one cache resident cloud. Both
+   * methods end on the last one. */
+  std::vector< frame > frames(8);
+
+  for (auto &f : frames)
+  {
+    sim.getFrame();
+    sim.extract(f, extraction_filter());
+  }
+
+  pose body;
+  sim.truePose(0, 0, 1.0, body);
+
+  const double lo[3] = {-3000, -3000, -1500}, hi[3] = {3000, 3000, 2500};
+
+  cloud_result r;
+  r.markers = markers;
+
+  using clock = std::chrono::steady_clock;
+  const auto limit = std::chrono::duration< double >(duration);
+  size_t kept      = 0;
+  uint64_t n       = 0;
+
+  /* Per index: copy out each marker, rotate it with the quaternion and
+   * collect the ones inside into a fresh vector. */
+  auto start = clock::now();
+
+  while (clock::now() - start < limit)
+  {
+    for (auto &f : frames)
+    {
+      std::vector< std::array< double, 3 > > out;
+
+      for (size_t i = 0; i < f.unlabeled_markers.size(); i++)
+      {
+        double p[3];
+        std::copy(f.unlabeled_markers[i].translation,
+                  f.unlabeled_markers[i].translation + 3, p);
+
+        for (int k = 0; k < 3; k++)
+          p[k] -= body.translation[k];
+
+        /* v' = conj(q) v q */
+        const double qi[4] = {-body.rotation[0], -body.rotation[1],
+                              -body.rotation[2], body.rotation[3]};
+        const double v[4] = {p[0], p[1], p[2], 0};
+        double t[4], b[4];
+        quatMultiply(qi, v, t);
+        quatMultiply(t, body.rotation, b);
+
+        if (b[0] >= lo[0] && b[0] <= hi[0] && b[1] >= lo[1] && b[1] <= hi[1] &&
+            b[2] >= lo[2] && b[2] <= hi[2])
+          out.push_back({{b[0], b[1], b[2]}});
+      }
+
+      kept = out.size();
+      n++;
+    }
+  }
+
+  r.per_index_ns =
+      1e9 * std::chrono::duration< double >(clock::now() - start).count() / n;
+
+  /* Bulk: one reused cloud. */
+  point_cloud cloud;
+  n     = 0;
+  start = clock::now();
+
+  while (clock::now() - start < limit)
+  {
+    for (auto &f : frames)
+    {
+      cloud.assign(f);
+      cloud.inverseTransform(body);
+      r.kept = cloud.crop(lo, hi);
+      n++;
+    }
+  }
+
+  r.bulk_ns =
+      1e9 * std::chrono::duration< double >(clock::now() - start).count() / n;
+
+  if (r.kept != kept)
+    std::cerr << "Warning: the point cloud methods disagree." << std::endl;
+
+  return r;
+}
+
+/** @brief Cost and throughput of recording. */
+struct recorder_result
+{
+  double frame_rate;
+  unsigned int markers;
+
+  /* Paced, with the recorder attached. */
+  double paced_mb_s;
+  uint64_t delivered;
+  uint64_t recorded;
+
+  /* Median time on the frame grabber between two inline callbacks
+     registered around the recorder, with and without it attached. On a
+     single CPU this includes waking the recorder's worker. */
+  double enqueue_ns;
+  double baseline_ns;
+
+  /* Unpaced, encoding and writing as fast as possible. */
+  double max_mb_s;
+  double max_fps;
+};
+
+/** @brief Marks the time before the subscriber registered after it. */
+struct dispatch_timer
+{
+  std::chrono::steady_clock::time_point before;
+  latency_histogram between;
+};
+
+/**
+ * @brief   Runs the paced stream with or without a recorder between two
+ *          timing callbacks.
+ */
+void runRecorderStream(const simulator_settings &s, const double duration,
+                       const std::string &path, recorder_result &r,
+                       const bool attach)
+{
+  std::ostream null_log(nullptr);
+  arbiter vs(std::unique_ptr< frame_source >(new simulated_source(s)),
+             null_log);
+
+  /* Inline callbacks are dispatched in registration order. */
+  dispatch_timer timer;
+  vs.registerCallback([&timer](const frame &) {
+    timer.before = std::chrono::steady_clock::now();
+  });
+
+  recorder rec(path);
+
+  if (attach)
+    rec.attach(vs);
+
+  vs.registerCallback([&timer](const frame &) {
+    timer.between.record(
+        std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::steady_clock::now() - timer.before)
+            .count());
+  });
+
+  frame_stats fs;
+  vs.enableStream(true, s.markers > 0);
+  std::this_thread::sleep_for(std::chrono::duration< double >(duration));
+  vs.disableStream();
+  vs.frameStats(fs);
+  rec.close();
+
+  if (attach)
+  {
+    r.enqueue_ns = 1e9 * timer.between.summary().p50;
+    r.paced_mb_s = rec.bytesWritten() / duration / 1e6;
+    r.delivered  = fs.frames;
+    r.recorded   = rec.framesRecorded();
+  }
+  else
+    r.baseline_ns = 1e9 * timer.between.summary().p50;
+}
+
+/**
+ * @brief   Records a paced stream with markers from an async subscriber,
+ *          then encodes and writes frames unpaced.
+ *
+ * @param[in] rate      Frame rate in Hz.
+ * @param[in] markers   Labeled markers per subject.
+ * @param[in] duration  Run time of each measurement in seconds.
+ */
+recorder_result runRecorder(const double rate, const unsigned int markers,
+                            const double duration)
+{
+  recorder_result r;
+  r.frame_rate = rate;
+  r.markers    = markers;
+
+  char path[] = "/tmp/vs_bench_XXXXXX";
+  const int fd = ::mkstemp(path);
+
+  if (fd >= 0)
+    ::close(fd);
+
+  simulator_settings s;
+  s.subjects   = 10;
+  s.segments   = 5;
+  s.markers    = markers;
+  s.frame_rate = rate;
+
+  runRecorderStream(s, duration, path, r, false);
+  runRecorderStream(s, duration, path, r, true);
+
+  /* Unpaced: a ring of extracted frames recorded back to back. */
+  s.realtime = false;
+  simulated_source sim(s);
+  stream_settings settings;
+  settings.marker_data = markers > 0;
+
+  sim.connect();
+  sim.configure(settings);
+
+  std::vector< frame > frames(64);
+
+  for (auto &f : frames)
+  {
+    sim.getFrame();
+    sim.extract(f, extraction_filter());
+  }
+
+  uint64_t n       = 0;
+  uint64_t bytes   = 0;
+  const auto start = std::chrono::steady_clock::now();
+
+  {
+    recorder rec(path);
+
+    while (std::chrono::steady_clock::now() - start <
+           std::chrono::duration< double >(duration))
+    {
+      for (auto &f : frames)
+        rec.record(f);
+
+      n += frames.size();
+    }
+
+    rec.close();
+    bytes = rec.bytesWritten();
+  }
+
+  const double elapsed = std::chrono::duration< double >(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+  r.max_mb_s = bytes / elapsed / 1e6;
+  r.max_fps  = n / elapsed;
+
+  ::unlink(path);
+
+  return r;
+}
+
+/*********************************
+ * JSON output
+ ********************************/
+
+void writeSummary(std::ostream &os, const char *name,
+                  const latency_summary &s, const bool last = false)
+{
+  os << "        \"" << name << "\": {"
+     << "\"count\": " << s.count << ", \"mean_us\": " << 1e6 * s.mean
+     << ", \"p50_us\": " << 1e6 * s.p50 << ", \"p99_us\": " << 1e6 * s.p99
+     << ", \"p999_us\": " << 1e6 * s.p999 << ", \"max_us\": " << 1e6 * s.max
+     << "}" << (last ? "\n" : ",\n");
+}
+
+void writeCase(std::ostream &os, const bench_case &c, const bench_result &r,
+               const bool last)
+{
+  os << "    {\n"
+     << "      \"sweep\": \"" << c.sweep << "\",\n"
+     << "      \"params\": {\"callbacks\": " << c.callbacks
+     << ", \"subjects\": " << c.subjects << ", \"segments\": " << c.segments
+     << ", \"markers\": " << c.markers << ", \"frame_rate\": " << c.frame_rate
+     << ", \"dispatch\": \""
+     << (c.mode == DispatchMode::Async ? "async" : "inline")
+     << "\", \"grab_wait\": \"" << grabWaitName(c.grab_wait)
+     << "\", \"stream_mode\": \"" << streamModeName(c.stream_mode)
+     << "\", \"filtered\": " << (c.filtered ? "true" : "false") << "},\n"
+     << "      \"throughput_fps\": " << r.throughput << ",\n"
+     << "      \"frame_ns\": " << r.frame_ns << ",\n"
+     << "      \"extraction_ns\": " << r.extraction_ns << ",\n"
+     << "      \"dispatch_ns\": " << r.dispatch_ns << ",\n"
+     << "      \"delivered_fps\": " << r.delivered_rate << ",\n"
+     << "      \"lost_frames\": " << r.lost << ",\n"
+     << "      \"dropped_frames\": " << r.dropped << ",\n"
+     << "      \"latency\": {\n";
+
+  writeSummary(os, "extraction", r.latency.extraction);
+  writeSummary(os, "callback_start", r.latency.callback_start);
+  writeSummary(os, "callback_duration", r.latency.callback_duration);
+  writeSummary(os, "frame_to_callback", r.frame_to_callback, true);
+
+  os << "      }\n"
+     << "    }" << (last ? "\n" : ",\n");
+}
+
+void usage(const char *name)
+{
+  std::cerr << "Usage: " << name << " [options]\n"
+            << "  -d, --duration <s>   Run time per measurement, default 0.5\n"
+            << "  -o, --output <file>  Write the JSON to a file, default "
+               "stdout\n"
+            << "  -q, --quick          Only run the baseline\n";
+}
+}
+
+int main(int argc, char *argv[])
+{
+  double duration = 0.5;
+  std::string output;
+  bool quick = false;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string arg = argv[i];
+
+    if ((arg == "-d" || arg == "--duration") && i + 1 < argc)
+      duration = std::atof(argv[++i]);
+    else if ((arg == "-o" || arg == "--output") && i + 1 < argc)
+      output = argv[++i];
+    else if (arg == "-q" || arg == "--quick")
+      quick = true;
+    else
+    {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  /* Vary one parameter at a time around the baseline. */
+  std::vector< bench_case > cases;
+  cases.push_back(baseline());
+
+  if (!quick)
+  {
+    for (auto mode : {DispatchMode::Inline, DispatchMode::Async})
+    {
+      for (unsigned int n : {1, 4, 16})
+      {
+        bench_case c = baseline();
+        c.sweep      = "callbacks";
+        c.callbacks  = n;
+        c.mode       = mode;
+        cases.push_back(c);
+      }
+    }
+
+    for (unsigned int n : {1, 100, 500})
+    {
+      bench_case c = baseline();
+      c.sweep      = "subjects";
+      c.subjects   = n;
+      cases.push_back(c);
+    }
+
+    for (unsigned int n : {1, 20})
+    {
+      bench_case c = baseline();
+      c.sweep      = "segments";
+      c.segments   = n;
+      cases.push_back(c);
+    }
+
+    for (unsigned int n : {10, 50})
+    {
+      bench_case c = baseline();
+      c.sweep      = "markers";
+      c.markers    = n;
+      cases.push_back(c);
+    }
+
+    for (unsigned int n : {1, 4, 16})
+    {
+      bench_case c = baseline();
+      c.sweep      = "subscriptions";
+      c.subjects   = 40;
+      c.callbacks  = n;
+      c.filtered   = true;
+      cases.push_back(c);
+    }
+
+    for (double rate : {100.0, 500.0, 1000.0, 2000.0})
+    {
+      bench_case c = baseline();
+      c.sweep      = "frame_rate";
+      c.frame_rate = rate;
+      cases.push_back(c);
+    }
+
+    /* Frame to callback latency of each wait strategy, callback_start
+       p50 and p99. Blocking only applies to ServerPush. */
+    for (auto mode : {StreamMode::ServerPush, StreamMode::ClientPull,
+                      StreamMode::ClientPullPreFetch})
+    {
+      for (auto wait :
+           {GrabWait::FixedSleep, GrabWait::Blocking, GrabWait::Adaptive})
+      {
+        if (wait == GrabWait::Blocking && mode != StreamMode::ServerPush)
+          continue;
+
+        bench_case c  = baseline();
+        c.sweep       = "grab_wait";
+        c.stream_mode = mode;
+        c.grab_wait   = wait;
+        cases.push_back(c);
+      }
+    }
+  }
+
+  std::ostringstream json;
+  json << "{\n"
+       << "  \"benchmark\": \"vs_bench\",\n"
+       << "  \"duration_s\": " << duration << ",\n"
+       << "  \"hardware_concurrency\": "
+       << std::thread::hardware_concurrency() << ",\n"
+       << "  \"cases\": [\n";
+
+  for (size_t i = 0; i < cases.size(); i++)
+  {
+    const bench_case &c = cases[i];
+
+    std::cerr << "[" << i + 1 << "/" << cases.size() << "] " << c.sweep
+              << ": " << c.callbacks << " cb, " << c.subjects << " subj, "
+              << c.segments << " seg, " << c.markers << " mark, "
+              << c.frame_rate << " Hz, "
+              << (c.mode == DispatchMode::Async ? "async" : "inline") << ", "
+              << grabWaitName(c.grab_wait) << ", "
+              << streamModeName(c.stream_mode) << std::endl;
+
+    writeCase(json, c, runCase(c, duration), i + 1 == cases.size());
+  }
+
+  json << "  ],\n"
+       << "  \"point_cloud\": [\n";
+
+  /* Unlabeled marker processing, independent of the stream. */
+  std::vector< unsigned int > clouds;
+  if (quick)
+    clouds = {2000};
+  else
+    clouds = {500, 2000, 8000};
+
+  for (size_t i = 0; i < clouds.size(); i++)
+  {
+    std::cerr << "[cloud] " << clouds[i] << " unlabeled markers" << std::endl;
+
+    const cloud_result r = runCloud(clouds[i], duration);
+
+    json << "    {\"markers\": " << r.markers
+         << ", \"per_index_ns\": " << r.per_index_ns
+         << ", \"bulk_ns\": " << r.bulk_ns
+         << ", \"speedup\": " << r.per_index_ns / r.bulk_ns
+         << ", \"kept\": " << r.kept << "}"
+         << (i + 1 == clouds.size() ? "\n" : ",\n");
+  }
+
+  json << "  ],\n"
+       << "  \"recorder\": [\n";
+
+  /* Recording at a typical rate with markers, from an async subscriber. */
+  std::vector< unsigned int > recordings;
+  if (quick)
+    recordings = {20};
+  else
+    recordings = {0, 20};
+
+  for (size_t i = 0; i < recordings.size(); i++)
+  {
+    std::cerr << "[recorder] 250 Hz, " << recordings[i] << " markers"
+              << std::endl;
+
+    const recorder_result r = runRecorder(250, recordings[i], duration);
+
+    json << "    {\"frame_rate\": " << r.frame_rate
+         << ", \"markers\": " << r.markers
+         << ", \"paced_mb_s\": " << r.paced_mb_s
+         << ", \"delivered\": " << r.delivered
+         << ", \"recorded\": " << r.recorded
+         << ", \"enqueue_ns\": " << r.enqueue_ns - r.baseline_ns
+         << ", \"baseline_ns\": " << r.baseline_ns
+         << ", \"max_mb_s\": " << r.max_mb_s
+         << ", \"max_fps\": " << r.max_fps << "}"
+         << (i + 1 == recordings.size() ? "\n" : ",\n");
+  }
+
+  json << "  ]\n"
+       << "}\n";
+
+  if (output.empty())
+    std::cout << json.str();
+  else
+  {
+    std::ofstream file(output);
+
+    if (!file)
+    {
+      std::cerr << "Unable to open " << output << std::endl;
+      return 1;
+    }
+
+    file << json.str();
+  }
+
+  return 0;
+}
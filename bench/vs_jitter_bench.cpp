@@ -0,0 +1,169 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "libviconstream/viconstream.h"
+#include "libviconstream/simulated_source.h"
+
+using namespace libviconstream;
+
+namespace
+{
+/**
+ * @brief   Deviations of the frame intervals seen by an inline callback
+ *          from the frame period, in microseconds.
+ */
+std::vector< double > run(const realtime_settings &rt, const double rate,
+                          const double duration)
+{
+  simulator_settings sim;
+  sim.frame_rate = rate;
+
+  /* Only the warnings, e.g. missing privileges. */
+  log_settings log;
+  log.level = LogLevel::Warning;
+
+  arbiter vs(std::unique_ptr< frame_source >(new simulated_source(sim)),
+             std::cout, log);
+  vs.setRealtimeSettings(rt);
+
+  std::vector< double > deviations;
+  deviations.reserve(static_cast< size_t >(rate * duration) + 16);
+
+  std::chrono::steady_clock::time_point last;
+  bool first = true;
+
+  vs.registerCallback([&](const frame &) {
+    const auto now = std::chrono::steady_clock::now();
+
+    if (!first)
+      deviations.push_back(
+          std::chrono::duration< double, std::micro >(now - last).count() -
+          1e6 / rate);
+
+    first = false;
+    last  = now;
+  });
+
+  vs.enableStream(true, false, false, false, StreamMode::ServerPush,
+                  GrabWait::Blocking);
+
+  std::this_thread::sleep_for(std::chrono::duration< double >(duration));
+  vs.disableStream();
+
+  return deviations;
+}
+
+void report(const char *name, std::vector< double > d)
+{
+  if (d.empty())
+  {
+    std::cout << name << ": no frames" << std::endl;
+    return;
+  }
+
+  double mean = 0, sq = 0;
+
+  for (const double x : d)
+  {
+    mean += x;
+    sq += x * x;
+  }
+
+  mean /= d.size();
+  const double stddev = std::sqrt(std::max(sq / d.size() - mean * mean, 0.0));
+
+  for (double &x : d)
+    x = std::fabs(x);
+
+  std::sort(d.begin(), d.end());
+
+  std::printf("%-10s frames %6zu  stddev %8.1f us  p99 %8.1f us  "
+              "max %8.1f us\n",
+              name, d.size() + 1, stddev, d[d.size() * 99 / 100], d.back());
+}
+
+void usage(const char *name)
+{
+  std::cerr << "Usage: " << name << " [options]\n"
+            << "  -r, --rate <Hz>      Simulated frame rate, default 1000\n"
+            << "  -d, --duration <s>   Run time per configuration, default 5\n"
+            << "  -l, --load <n>       Busy threads, default one per CPU\n"
+            << "  -c, --cpu <n>        Pin the real-time grabber to a CPU\n";
+}
+}
+
+/* Compares the frame interval jitter of the default and a real-time frame
+   grabber against a simulated source, under CPU load. */
+int main(int argc, char *argv[])
+{
+  double rate = 1000, duration = 5;
+  int load = static_cast< int >(std::thread::hardware_concurrency());
+  int cpu  = -1;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string arg = argv[i];
+
+    if ((arg == "-r" || arg == "--rate") && i + 1 < argc)
+      rate = std::atof(argv[++i]);
+    else if ((arg == "-d" || arg == "--duration") && i + 1 < argc)
+      duration = std::atof(argv[++i]);
+    else if ((arg == "-l" || arg == "--load") && i + 1 < argc)
+      load = std::atoi(argv[++i]);
+    else if ((arg == "-c" || arg == "--cpu") && i + 1 < argc)
+      cpu = std::atoi(argv[++i]);
+    else
+    {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  /* Busy threads competing with the frame grabber. */
+  std::atomic< bool > running(true);
+  std::vector< std::thread > loaders;
+
+  for (int i = 0; i < load; i++)
+  {
+    loaders.emplace_back([&running]() {
+      volatile uint64_t n = 0;
+
+      while (running)
+        n++;
+    });
+  }
+
+  realtime_settings rt;
+  rt.grabber.policy         = SchedPolicy::Fifo;
+  rt.grabber.priority       = 80;
+  rt.grabber.stack_prefault = 256 * 1024;
+  rt.lock_memory            = true;
+
+  if (cpu >= 0)
+    rt.grabber.cpus.push_back(cpu);
+
+  std::cout << rate << " Hz, " << duration << " s, " << load
+            << " load threads" << std::endl;
+
+  report("default", run(realtime_settings(), rate, duration));
+  report("real-time", run(rt, rate, duration));
+
+  running = false;
+
+  for (auto &t : loaders)
+    t.join();
+
+  return 0;
+}
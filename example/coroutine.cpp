@@ -0,0 +1,65 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <iostream>
+#include <exception>
+#include "libviconstream/viconstream.h"
+#include "libviconstream/frame_stream.h"
+
+using namespace std;
+using namespace libviconstream;
+
+/* A coroutine which runs until it finishes, for the example. */
+struct task
+{
+    struct promise_type
+    {
+        task get_return_object() { return task(); }
+        suspend_never initial_suspend() noexcept { return {}; }
+        suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { terminate(); }
+    };
+};
+
+/* Awaits the frames until the stream is closed. */
+task print_frames(frame_stream &stream)
+{
+    frame_generator frames = stream.frames();
+
+    while(frame_ptr f = co_await frames.next())
+    {
+        cout << "Frame: " << f->frame_number << ", subjects: "
+             << f->subjects.size() << endl;
+    }
+
+    cout << "Stream closed, " << stream.framesSkipped()
+         << " frames skipped." << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    /* Get an address to the Vicon system. */
+    std::string ip = "vicon.research.ltu.se:801";
+
+    if(argc > 1)
+        ip = argv[1];
+
+    libviconstream::arbiter vs(ip, std::cout);
+
+    /* The coroutine runs on the frame grabber, always on the latest
+       frame. */
+    frame_stream stream(vs);
+    print_frames(stream);
+
+    vs.enableStream();
+
+    this_thread::sleep_for(chrono::seconds(1));
+
+    /* Ends the coroutine's loop. */
+    stream.close();
+
+    return 0;
+}
@@ -9,9 +9,10 @@
 using namespace std;
 using namespace ViconDataStreamSDK::CPP;
 
-void test_cb(const Client &frame)
+void test_cb(const libviconstream::frame &frame)
 {
-    cout << "Frame: " << frame.GetFrameNumber().FrameNumber << endl;
+    cout << "Frame: " << frame.frame_number << ", subjects: "
+         << frame.subjects.size() << endl;
 }
 
 int main(int argc, char *argv[])
@@ -24,7 +25,7 @@ int main(int argc, char *argv[])
         ip = argv[1];
 
     /* Create the vicon stream object with logging to cout. */
-    ViconStream::ViconStream vs(ip, std::cout);
+    libviconstream::arbiter vs(ip, std::cout);
 
     /* Register a callback. */
     vs.registerCallback(test_cb);
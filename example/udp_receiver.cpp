@@ -0,0 +1,47 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <iostream>
+#include <cstdlib>
+#include "libviconstream/pose_receiver.h"
+
+using namespace std;
+
+/* Receives the poses of a udp_relay, without the Vicon SDK. */
+int main(int argc, char *argv[])
+{
+    /* Port and an optional multicast group. */
+    uint16_t port = 51001;
+    std::string group;
+
+    if(argc > 1)
+        port = static_cast<uint16_t>(atoi(argv[1]));
+
+    if(argc > 2)
+        group = argv[2];
+
+    libviconstream::pose_receiver receiver;
+
+    if(!receiver.open(port, group))
+    {
+        cout << "Unable to open port " << port << endl;
+        return 1;
+    }
+
+    libviconstream::received_frame frame;
+
+    while(receiver.receive(frame, 1000))
+    {
+        cout << "Frame: " << frame.frame_number << ", age: " << frame.age_us
+             << " us" << endl;
+
+        for(const auto &p : frame.poses)
+            cout << "  " << receiver.name(p.id) << ": " << p.translation[0]
+                 << ", " << p.translation[1] << ", " << p.translation[2]
+                 << (p.occluded ? " (occluded)" : "") << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,167 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <chrono>
+
+/* Threading includes. */
+#include <mutex>
+#include <condition_variable>
+
+#include "frame_source.h"
+
+#ifndef _VICONSTREAM_AGGREGATED_SOURCE_H
+#define _VICONSTREAM_AGGREGATED_SOURCE_H
+
+namespace libviconstream
+{
+namespace Alignment
+{
+  enum Enum
+  {
+    LatestOfEach,    ///< Every new frame is merged with the others' latest.
+    TimestampMatched ///< Only frames captured within a tolerance are merged.
+  };
+}
+
+/** @brief Settings of the merging of several sources. */
+struct aggregation_settings
+{
+  /** @brief How frames of the sources are combined. */
+  Alignment::Enum alignment;
+
+  /** @brief Largest capture time difference of matched frames in seconds. */
+  double tolerance;
+
+  /** @brief LatestOfEach leaves out frames older than this in seconds, 0 to
+   *         always include the latest frame of every source. */
+  double max_age;
+
+  /**
+   * @brief   Defaults to latest-of-each, 2 ms tolerance and 100 ms age.
+   */
+  aggregation_settings();
+};
+
+/**
+ * @brief   Frame source merging the frames of several arbiters into one
+ *          stream, see @p aggregator.
+ *
+ * @note    Frames are fed with @p push from the upstream frame grabbers and
+ *          merged by @p extract on the downstream frame grabber, so the
+ *          upstream sources extract in parallel. Subject, device and
+ *          latency sample names are prefixed with the source's namespace.
+ *          Capture time is estimated as reception time minus the server's
+ *          reported latency. @p getFrame returns the latest merge, like
+ *          ServerPush, and merged frames are numbered as they are taken,
+ *          so merges replaced in the meantime do not count as lost.
+ */
+class aggregated_source : public frame_source
+{
+private:
+  /** @brief Per source state. */
+  struct input
+  {
+    /** @brief Namespace of the source. */
+    std::string ns;
+
+    /** @brief Recent frames, oldest first, guarded by the lock. */
+    std::deque< frame_ptr > frames;
+
+    /** @brief Frame rate of the source. */
+    double frame_rate;
+
+    /** @brief Subject names with and without the namespace, cached. */
+    std::vector< std::string > raw_names;
+    std::vector< std::string > names;
+  };
+
+  /** @brief Merging settings. */
+  const aggregation_settings _settings;
+
+  /** @brief The sources. */
+  std::vector< input > _inputs;
+
+  /** @brief Guards the frames of the inputs and the ready set. */
+  std::mutex _lock;
+  std::condition_variable _cv;
+
+  /** @brief The latest merge, fresh until the frame grabber takes it. */
+  std::vector< frame_ptr > _ready;
+  bool _fresh;
+
+  /** @brief The merge being extracted, owned by the frame grabber, the
+   *         number of merges taken and when this one was. */
+  std::vector< frame_ptr > _current;
+  unsigned int _current_number;
+  std::chrono::steady_clock::time_point _current_received;
+
+  /** @brief Connection state. */
+  std::atomic< bool > _connected;
+
+  /**
+   * @brief   Gets the estimated capture time of a frame.
+   */
+  static std::chrono::steady_clock::time_point captureTime(const frame &f);
+
+  /**
+   * @brief   Tries to match the newest frame of a source with frames of all
+   *          others, must be called with the lock held.
+   *
+   * @return  Returns true if a merge was made ready.
+   */
+  bool match(const size_t source);
+
+  /**
+   * @brief   Appends one source's frame to the merged frame.
+   */
+  void append(frame &f, input &in, const frame &part,
+              const extraction_filter &filter);
+
+public:
+  /**
+   * @brief   Constructor for the aggregated source.
+   *
+   * @param[in] settings   How the frames are merged.
+   */
+  aggregated_source(
+      const aggregation_settings &settings = aggregation_settings());
+
+  /**
+   * @brief   Adds a source, only before connecting.
+   *
+   * @param[in] ns   Namespace of the source's names, empty for none.
+   *
+   * @return  Index of the source for @p push.
+   */
+  size_t addInput(const std::string &ns);
+
+  /**
+   * @brief   Feeds a frame of a source, called from its frame grabber.
+   *
+   * @param[in] source  Index of the source.
+   * @param[in] f       The source's frame.
+   */
+  void push(const size_t source, const frame_ptr &f);
+
+  bool connect() override;
+  void disconnect() override;
+  bool isConnected() override;
+  void configure(const stream_settings &settings) override;
+  bool getFrame() override;
+  unsigned int frameNumber() override;
+  double frameRate() override;
+  void extract(frame &f, const extraction_filter &filter) override;
+  std::string name() const override;
+};
+
+}  // end libviconstream
+
+#endif
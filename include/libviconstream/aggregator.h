@@ -0,0 +1,117 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <string>
+#include <vector>
+#include <memory>
+#include <ostream>
+
+#include "viconstream.h"
+#include "aggregated_source.h"
+
+#ifndef _VICONSTREAM_AGGREGATOR_H
+#define _VICONSTREAM_AGGREGATOR_H
+
+namespace libviconstream
+{
+/**
+ * @brief   Merges several Vicon systems (or other sources) into one stream.
+ *
+ * @note    Every source gets its own arbiter, and with it its own frame
+ *          grabber, feeding an @p aggregated_source. A downstream arbiter
+ *          on that source dispatches the merged frames, so it offers the
+ *          full callback and polling interface through @p stream.
+ */
+class aggregator
+{
+private:
+  /** @brief Reference to the output stream for logging. */
+  std::ostream &_log;
+
+  /** @brief The merging source, owned by the downstream arbiter. */
+  aggregated_source *_merge;
+
+  /** @brief The downstream arbiter, delivering merged frames. */
+  arbiter _stream;
+
+  /** @brief The upstream arbiters, one per source. */
+  std::vector< std::unique_ptr< arbiter > > _sources;
+
+public:
+  /**
+   * @brief   Constructor for the aggregator.
+   *
+   * @param[in] log_output  Output stream for logging.
+   * @param[in] settings    How the frames of the sources are merged.
+   */
+  aggregator(std::ostream &log_output,
+             const aggregation_settings &settings = aggregation_settings());
+
+  /**
+   * @brief   Destructor, stops all streams.
+   */
+  ~aggregator();
+
+  /**
+   * @brief   Adds a source, only while the stream is disabled.
+   *
+   * @param[in] source  The source.
+   * @param[in] ns      Namespace of the source, its subjects are named
+   *                    "ns/subject". Empty to keep the names.
+   *
+   * @return  Index of the source.
+   */
+  size_t addSource(std::unique_ptr< frame_source > source,
+                   const std::string &ns);
+
+  /**
+   * @brief   Adds a Vicon system, only while the stream is disabled.
+   *
+   * @param[in] hostname  Address to the Vicon server.
+   * @param[in] ns        Namespace of the source.
+   *
+   * @return  Index of the source.
+   */
+  size_t addSource(const std::string &hostname, const std::string &ns);
+
+  /**
+   * @brief   Enable the stream of all sources, see @p arbiter::enableStream.
+   *
+   * @return  Return true if all sources were started.
+   */
+  bool enableStream(const bool enableSegmentData         = true,
+                    const bool enableMarkerData          = false,
+                    const bool enableUnlabeledMarkerData = false,
+                    const bool enableDeviceData          = false,
+                    const StreamMode::Enum streamMode    = StreamMode::ServerPush,
+                    const GrabWait::Enum grabWait        = GrabWait::Adaptive);
+
+  /**
+   * @brief   Disable the stream of all sources.
+   */
+  void disableStream();
+
+  /**
+   * @brief   Get the arbiter of the merged stream, for callbacks and polling.
+   */
+  arbiter &stream();
+
+  /**
+   * @brief   Get the arbiter of a source, for its statistics.
+   *
+   * @param[in] index   Index of the source.
+   */
+  arbiter &source(const size_t index);
+
+  /**
+   * @brief   Get the number of sources.
+   */
+  size_t sourceCount() const;
+};
+
+}  // end libviconstream
+
+#endif
@@ -0,0 +1,159 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+
+#include "latency_histogram.h"
+
+#ifndef _VICONSTREAM_ARRIVAL_TRACKER_H
+#define _VICONSTREAM_ARRIVAL_TRACKER_H
+
+namespace libviconstream
+{
+/** @brief Frame arrival timing on the host, against the frame period. */
+struct arrival_stats
+{
+  /** @brief Frame rate reported by the server in Hz, 0 if unknown. */
+  double nominal_rate;
+
+  /** @brief Frame rate measured from the frame numbers over host time in
+   *         the last window, 0 until a window completed. */
+  double effective_rate;
+
+  /** @brief Intervals between consecutive frames measured. */
+  uint64_t intervals;
+
+  /** @brief Mean and standard deviation of the intervals, in seconds. */
+  double mean_interval;
+  double stddev;
+
+  /** @brief Distribution of the intervals' absolute deviation from the
+   *         frame period, in seconds. */
+  latency_summary jitter;
+
+  /** @brief Rate changes detected, the rate before the last one and the
+   *         seconds since it, negative if none. */
+  uint64_t rate_changes;
+  double previous_rate;
+  double since_rate_change;
+};
+
+/** @brief Settings of the arrival tracking. */
+struct arrival_settings
+{
+  /** @brief Length of the windows the effective rate is measured over. */
+  std::chrono::milliseconds window;
+
+  /** @brief Relative difference of the effective rate from the current
+   *         rate, in two consecutive windows, taken as a rate change. */
+  double rate_tolerance;
+
+  /**
+   * @brief   Defaults to 500 ms windows and a 10 % tolerance.
+   */
+  arrival_settings();
+};
+
+/**
+ * @brief   Tracks the intervals between frame arrivals, the effective frame
+ *          rate and changes of the rate.
+ *
+ * @note    Only intervals between consecutive frame numbers are measured,
+ *          lost frames are counted by @p frame_counters. A rate change is
+ *          detected when the server reports a new rate, or when the
+ *          effective rate stays off the current rate while the server does
+ *          not, and restarts the interval statistics as the period
+ *          changed. Recorded by the frame grabber only, reads from any
+ *          thread are approximate while frames are arriving.
+ */
+class arrival_tracker
+{
+private:
+  const arrival_settings _settings;
+
+  /** @brief The frame grabber's state. */
+  std::chrono::steady_clock::time_point _last_time;
+  unsigned int _last_number;
+  bool _started;
+  std::chrono::steady_clock::time_point _window_start;
+  unsigned int _window_number;
+  double _reported;
+  double _rate;
+  unsigned int _off_windows;
+
+  /** @brief Set by @p reset, applied by the frame grabber. */
+  std::atomic< bool > _reset;
+
+  /** @brief Statistics, single writer. */
+  std::atomic< double > _nominal;
+  std::atomic< double > _effective;
+  std::atomic< uint64_t > _count;
+  std::atomic< double > _sum;
+  std::atomic< double > _sum_sq;
+  latency_histogram _jitter;
+  std::atomic< uint64_t > _rate_changes;
+  std::atomic< double > _previous_rate;
+  std::atomic< int64_t > _change_time;
+
+  /**
+   * @brief   Switches to a new rate and restarts the interval statistics.
+   */
+  void changeRate(const double rate,
+                  const std::chrono::steady_clock::time_point t);
+
+  /**
+   * @brief   Clears the interval statistics.
+   */
+  void clearIntervals();
+
+public:
+  /**
+   * @brief   Constructor for the tracker.
+   *
+   * @param[in] settings  Window length and rate change tolerance.
+   */
+  arrival_tracker(const arrival_settings &settings = arrival_settings());
+
+  arrival_tracker(const arrival_tracker &) = delete;
+  arrival_tracker &operator=(const arrival_tracker &) = delete;
+
+  /**
+   * @brief   Records a frame arrival, from the frame grabber.
+   *
+   * @note    A frame number which does not advance, e.g. after a
+   *          reconnect, starts the measurement over.
+   *
+   * @param[in] received      Time the frame was received.
+   * @param[in] frame_number  The frame's number.
+   * @param[in] nominal_rate  Frame rate reported by the server, 0 if
+   *                          unknown.
+   *
+   * @return  Returns true if the rate changed with this frame.
+   */
+  bool record(const std::chrono::steady_clock::time_point received,
+              const unsigned int frame_number, const double nominal_rate);
+
+  /**
+   * @brief   Gets the current rate in Hz, from the frame grabber.
+   */
+  double rate() const;
+
+  /**
+   * @brief   Resets the statistics with the next frame, except the rates.
+   */
+  void reset();
+
+  /**
+   * @brief   Gets the current statistics.
+   */
+  arrival_stats summary() const;
+};
+
+}  // end libviconstream
+
+#endif
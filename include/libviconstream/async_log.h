@@ -0,0 +1,193 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+
+/* Threading includes. */
+#include <thread>
+#include <mutex>
+
+#ifndef _VICONSTREAM_ASYNC_LOG_H
+#define _VICONSTREAM_ASYNC_LOG_H
+
+namespace libviconstream
+{
+namespace LogLevel
+{
+  enum Enum
+  {
+    Debug,   ///< Diagnostics, not written by default.
+    Info,    ///< Normal operation.
+    Warning, ///< Recoverable problems, e.g. lost frames.
+    Error    ///< Failures, never rate limited.
+  };
+}
+
+/** @brief Settings of an asynchronous log. */
+struct log_settings
+{
+  /** @brief Records in the ring, rounded up to a power of two. */
+  size_t capacity;
+
+  /** @brief Lowest level written. */
+  LogLevel::Enum level;
+
+  /** @brief Records per second below Error, the rest are dropped. */
+  unsigned int rate_limit;
+
+  /** @brief How often the writer thread drains the ring. */
+  std::chrono::milliseconds interval;
+
+  /**
+   * @brief   Defaults to 1024 records, Info, 200 records per second and a
+   *          10 ms interval.
+   */
+  log_settings();
+};
+
+/**
+ * @brief   Log writing fixed size records into a lock-free ring, which a
+ *          background thread formats and writes to an output stream.
+ *
+ * @note    Logging copies the text into a record, no allocation, lock or
+ *          I/O happens on the caller's thread, so a blocked stream cannot
+ *          stall it. Texts longer than a record are truncated. When the
+ *          ring is full or the rate limit is reached records are dropped
+ *          and counted, the writer reports the count. Lines have the form
+ *          "[seconds] ViconLog: text", relative to the log's creation.
+ */
+class async_log
+{
+public:
+  /** @brief Characters of text in a record. */
+  static const size_t text_size = 232;
+
+private:
+  /** @brief A record, 256 bytes. */
+  struct record
+  {
+    /** @brief Free for ring index i when i, written when i + 1. */
+    std::atomic< uint64_t > sequence;
+    int64_t time;
+    uint16_t length;
+    uint8_t level;
+    char text[text_size];
+  };
+
+  /** @brief The output stream, and the lock shared by all logs as they
+   *         may write to the same stream. */
+  std::ostream &_out;
+  static std::mutex _out_lock;
+
+  const log_settings _settings;
+
+  /** @brief The ring, and the next index to write and to read. */
+  std::vector< record > _ring;
+  const uint64_t _mask;
+  std::atomic< uint64_t > _head;
+  uint64_t _tail;
+
+  /** @brief Serializes the readers, the writer thread and @p flush. */
+  std::mutex _drain_lock;
+
+  /** @brief The formatted lines of a drain, written at once. */
+  std::string _batch;
+
+  /** @brief Time the log was created. */
+  const std::chrono::steady_clock::time_point _start;
+
+  /** @brief Rate limiting, records in the current second. */
+  std::atomic< int64_t > _window;
+  std::atomic< uint32_t > _window_count;
+
+  /** @brief Records dropped, and how many of them the writer reported. */
+  std::atomic< uint64_t > _dropped;
+  uint64_t _reported;
+
+  /** @brief The writer thread. */
+  std::atomic< bool > _running;
+  std::thread _writer;
+
+  /**
+   * @brief   Claims a record, nullptr if dropped.
+   */
+  record *claim(const LogLevel::Enum level, uint64_t &index);
+
+  /**
+   * @brief   Hands a claimed record to the writer.
+   */
+  void commit(record *r, const uint64_t index);
+
+  /**
+   * @brief   Writes all committed records to the stream.
+   */
+  void drain();
+
+  /**
+   * @brief   The writer thread's worker function.
+   */
+  void writerWorker();
+
+public:
+  /**
+   * @brief   Constructor for the log, starts the writer thread.
+   *
+   * @param[in] out       The output stream.
+   * @param[in] settings  The log settings.
+   */
+  async_log(std::ostream &out, const log_settings &settings = log_settings());
+
+  /**
+   * @brief   Destructor writes all records and stops the writer thread.
+   */
+  ~async_log();
+
+  async_log(const async_log &) = delete;
+  async_log &operator=(const async_log &) = delete;
+
+  /**
+   * @brief   Logs a text, safe from any number of threads.
+   *
+   * @param[in] level   Severity of the text.
+   * @param[in] text    The text.
+   * @param[in] length  Length of the text.
+   *
+   * @return  Returns false if the record was dropped.
+   */
+  bool log(const LogLevel::Enum level, const char *text, const size_t length);
+
+  /**
+   * @brief   Logs a string, safe from any number of threads.
+   */
+  bool log(const LogLevel::Enum level, const std::string &text);
+
+  /**
+   * @brief   Logs a printf style formatted text, formatted straight into
+   *          the record.
+   */
+  bool logf(const LogLevel::Enum level, const char *format, ...)
+      __attribute__((format(printf, 3, 4)));
+
+  /**
+   * @brief   Writes all records logged so far before returning.
+   */
+  void flush();
+
+  /**
+   * @brief   Number of records dropped by a full ring or the rate limit.
+   */
+  uint64_t dropped() const;
+};
+
+}  // end libviconstream
+
+#endif
@@ -0,0 +1,353 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+
+/* Vicon include. */
+#include "Client.h"
+
+#ifndef _VICONSTREAM_FRAME_H
+#define _VICONSTREAM_FRAME_H
+
+using namespace ViconDataStreamSDK::CPP;
+
+namespace libviconstream
+{
+/** @brief Timecode of a frame, mirrors Output_GetTimecode. */
+struct timecode
+{
+  unsigned int hours;
+  unsigned int minutes;
+  unsigned int seconds;
+  unsigned int frames;
+  unsigned int sub_frame;
+  bool field_flag;
+  TimecodeStandard::Enum standard;
+  unsigned int sub_frames_per_frame;
+  unsigned int user_bits;
+};
+
+/** @brief A rigid body pose as reported by the SDK. */
+struct pose
+{
+  /** @brief Translation in millimeters. */
+  double translation[3];
+
+  /** @brief Rotation quaternion in the SDK's (x, y, z, w) order. */
+  double rotation[4];
+
+  /** @brief True if the segment was occluded in this frame. */
+  bool occluded;
+};
+
+/** @brief Per subject bookkeeping, indexes into the frame's flat arrays. */
+struct subject_data
+{
+  /** @brief Index of the first segment of the subject in @p segments. */
+  uint32_t first_segment;
+
+  /** @brief Number of segments belonging to the subject. */
+  uint32_t segment_count;
+
+  /** @brief Index of the subject's root segment in @p segments. */
+  uint32_t root_segment;
+
+  /** @brief Index of the first marker of the subject in @p markers. */
+  uint32_t first_marker;
+
+  /** @brief Number of markers belonging to the subject. */
+  uint32_t marker_count;
+
+  /** @brief Frame number of the subject's sample in its own source, the
+   *         frame's number unless merged from several sources. */
+  uint32_t source_frame;
+
+  /** @brief Frame rate of the subject's source in Hz. */
+  double source_rate;
+
+  /** @brief Time from the sample's capture to the frame's reception in
+   *         seconds, the server's latency unless merged. */
+  double source_delay;
+};
+
+/** @brief A segment with its global pose. */
+struct segment_data
+{
+  /** @brief Index of the owning subject in @p subjects. */
+  uint32_t subject;
+
+  /** @brief Global pose of the segment. */
+  pose global;
+
+  /** @brief Pose relative to the parent segment. */
+  pose local;
+};
+
+/** @brief A labeled marker. */
+struct marker_data
+{
+  /** @brief Index of the owning subject in @p subjects. */
+  uint32_t subject;
+
+  /** @brief Global translation in millimeters. */
+  double translation[3];
+
+  /** @brief True if the marker was occluded in this frame. */
+  bool occluded;
+};
+
+/** @brief An unlabeled marker. */
+struct unlabeled_marker_data
+{
+  /** @brief Global translation in millimeters. */
+  double translation[3];
+};
+
+/** @brief Per device bookkeeping, indexes into @p device_outputs. */
+struct device_data
+{
+  /** @brief Index of the first output of the device. */
+  uint32_t first_output;
+
+  /** @brief Number of outputs of the device. */
+  uint32_t output_count;
+
+  /** @brief Type of the device. */
+  DeviceType::Enum type;
+};
+
+/** @brief A single device output value. */
+struct device_output_data
+{
+  /** @brief Index of the owning device in @p devices. */
+  uint32_t device;
+
+  /** @brief The output's value. */
+  double value;
+
+  /** @brief Unit of the value. */
+  Unit::Enum unit;
+
+  /** @brief True if the output was occluded in this frame. */
+  bool occluded;
+};
+
+/** @brief Latency breakdown of a frame. */
+struct frame_latency
+{
+  /** @brief Total latency reported by the server in seconds. */
+  double server_total;
+
+  /** @brief Host time when the frame was received from the source. */
+  std::chrono::steady_clock::time_point received;
+
+  /** @brief Host time when the frame was extracted and dispatch began. */
+  std::chrono::steady_clock::time_point dispatched;
+};
+
+/**
+ * @brief   Velocity and acceleration of the subjects' root segments, as a
+ *          structure of arrays index aligned with @p frame::subjects.
+ */
+struct motion_data
+{
+  /** @brief Linear velocity in mm/s. */
+  std::vector< double > velocity[3];
+
+  /** @brief Angular velocity in the world frame in rad/s. */
+  std::vector< double > angular_velocity[3];
+
+  /** @brief Linear acceleration in mm/s^2. */
+  std::vector< double > acceleration[3];
+
+  /** @brief 0 if nothing is estimated, 1 if the velocities are and 2 if the
+   *         acceleration is as well. */
+  std::vector< uint8_t > order;
+};
+
+/** @brief Interned subject name, see @p name_table. */
+struct subject_handle
+{
+  uint32_t id;
+};
+
+/** @brief Interned subject and segment name pair, see @p name_table. */
+struct segment_handle
+{
+  uint32_t id;
+};
+
+/** @brief Interned subject and marker name pair, see @p name_table. */
+struct marker_handle
+{
+  uint32_t id;
+};
+
+/**
+ * @brief   Maps interned handles to indices in a frame's data arrays, shared
+ *          by all frames with the same subject model.
+ */
+struct handle_map
+{
+  /** @brief Index by handle id, -1 if not in the model. */
+  std::vector< int32_t > subjects;
+  std::vector< int32_t > segments;
+  std::vector< int32_t > markers;
+};
+
+/**
+ * @brief   Immutable snapshot of one Vicon frame.
+ *
+ * @note    All data is stored in flat arrays, subjects and devices index into
+ *          them. Names are kept in separate arrays aligned with the data so
+ *          the data arrays stay POD. A frame handed to a callback can be
+ *          retained past the callback through @p shared_from_this().
+ */
+class frame : public std::enable_shared_from_this< frame >
+{
+public:
+  /** @brief The Vicon frame number. */
+  unsigned int frame_number;
+
+  /** @brief The server's frame rate in Hz. */
+  double frame_rate;
+
+  /** @brief The frame's timecode. */
+  timecode tc;
+
+  /**
+   * @brief   Latency of the frame, the time from @p latency.received to the
+   *          start of a callback is the callback's delivery latency.
+   */
+  frame_latency latency;
+
+  /** @brief The server's latency samples in seconds. */
+  std::vector< double > latency_samples;
+
+  /** @brief Flat data arrays. */
+  std::vector< subject_data > subjects;
+  std::vector< segment_data > segments;
+  std::vector< marker_data > markers;
+  std::vector< unlabeled_marker_data > unlabeled_markers;
+  std::vector< device_data > devices;
+  std::vector< device_output_data > device_outputs;
+
+  /** @brief Names, index aligned with the data arrays. */
+  std::vector< std::string > subject_names;
+  std::vector< std::string > segment_names;
+  std::vector< std::string > marker_names;
+  std::vector< std::string > device_names;
+  std::vector< std::string > device_output_names;
+  std::vector< std::string > latency_sample_names;
+
+  /** @brief Motion of the subjects, set by the arbiter. */
+  motion_data motion;
+
+  /** @brief Handle mapping of the frame's model, set by the arbiter. */
+  std::shared_ptr< const handle_map > handles;
+
+  frame();
+
+  /**
+   * @brief   Clears all data while keeping the allocated capacity.
+   */
+  void clear();
+
+  /**
+   * @brief   Exchanges all data with another frame without copying.
+   *
+   * @param[in,out] other   The other frame.
+   */
+  void swap(frame &other);
+
+  /**
+   * @brief   Finds a subject by name.
+   *
+   * @param[in] subject   Name of the subject.
+   *
+   * @return  Index into @p subjects, or -1 if not in the frame.
+   */
+  int findSubject(const std::string &subject) const;
+
+  /**
+   * @brief   Finds a segment by subject and segment name.
+   *
+   * @param[in] subject   Name of the subject.
+   * @param[in] segment   Name of the segment.
+   *
+   * @return  Index into @p segments, or -1 if not in the frame.
+   */
+  int findSegment(const std::string &subject,
+                  const std::string &segment) const;
+
+  /**
+   * @brief   Gets the global pose of a subject's root segment.
+   *
+   * @param[in] subject   Name of the subject.
+   *
+   * @return  Pointer to the pose, or nullptr if the subject is not in the
+   *          frame.
+   */
+  const pose *subjectPose(const std::string &subject) const;
+
+  /**
+   * @brief   Finds a subject by handle, without any string comparison.
+   *
+   * @param[in] subject   Handle of the subject.
+   *
+   * @return  Index into @p subjects, or -1 if not in the frame.
+   */
+  int findSubject(const subject_handle subject) const;
+
+  /**
+   * @brief   Finds a segment by handle, without any string comparison.
+   *
+   * @param[in] segment   Handle of the segment.
+   *
+   * @return  Index into @p segments, or -1 if not in the frame.
+   */
+  int findSegment(const segment_handle segment) const;
+
+  /**
+   * @brief   Finds a labeled marker by handle, without any string comparison.
+   *
+   * @param[in] marker    Handle of the marker.
+   *
+   * @return  Index into @p markers, or -1 if not in the frame.
+   */
+  int findMarker(const marker_handle marker) const;
+
+  /**
+   * @brief   Gets the global pose of a subject's root segment by handle.
+   *
+   * @param[in] subject   Handle of the subject.
+   *
+   * @return  Pointer to the pose, or nullptr if the subject is not in the
+   *          frame.
+   */
+  const pose *subjectPose(const subject_handle subject) const;
+
+  /**
+   * @brief   Gets the global pose of a segment by handle.
+   *
+   * @param[in] segment   Handle of the segment.
+   *
+   * @return  Pointer to the pose, or nullptr if the segment is not in the
+   *          frame.
+   */
+  const pose *segmentPose(const segment_handle segment) const;
+};
+
+/** @brief Shared handle to an immutable frame. */
+typedef std::shared_ptr< const frame > frame_ptr;
+
+}  // end libviconstream
+
+#endif
@@ -0,0 +1,48 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "frame.h"
+
+#ifndef _VICONSTREAM_FRAME_CODEC_H
+#define _VICONSTREAM_FRAME_CODEC_H
+
+namespace libviconstream
+{
+/**
+ * @brief   Version of the binary frame encoding, changes with the layout of
+ *          the frame's data structures.
+ */
+const uint32_t frame_codec_version = 4;
+
+/**
+ * @brief   Appends the binary encoding of a frame to a buffer.
+ *
+ * @note    The POD arrays are copied in their native layout, so the
+ *          encoding is only portable between hosts of the same ABI.
+ *
+ * @param[in]  f    The frame to encode.
+ * @param[out] out  The buffer to append to.
+ */
+void encodeFrame(const frame &f, std::vector< uint8_t > &out);
+
+/**
+ * @brief   Decodes a frame encoded by @p encodeFrame.
+ *
+ * @param[in]  data  Pointer to the encoded frame.
+ * @param[in]  size  Size of the encoded frame in bytes.
+ * @param[out] f     The frame to fill, cleared first.
+ *
+ * @return  Returns false if the data is truncated or malformed.
+ */
+bool decodeFrame(const uint8_t *data, const size_t size, frame &f);
+
+}  // end libviconstream
+
+#endif
@@ -0,0 +1,104 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+
+#ifndef _VICONSTREAM_FRAME_COUNTERS_H
+#define _VICONSTREAM_FRAME_COUNTERS_H
+
+namespace libviconstream
+{
+/** @brief Buckets of the gap length histogram, see @p frame_stats. */
+const unsigned int gap_buckets = 16;
+
+/** @brief Frame delivery and loss statistics. */
+struct frame_stats
+{
+  /** @brief Frames delivered. */
+  uint64_t frames;
+
+  /** @brief Frames missing from the frame numbers. */
+  uint64_t lost;
+
+  /** @brief Gaps in the frame numbers, i.e. runs of lost frames. */
+  uint64_t gaps;
+
+  /** @brief Frames lost in the longest gap. */
+  uint64_t longest_gap;
+
+  /** @brief Successful fetches whose frame number did not advance. */
+  uint64_t stale;
+
+  /** @brief Seconds since the last frame, negative if none yet. */
+  double since_last;
+
+  /** @brief Gaps by length, bucket i counts gaps of 2^i to 2^(i+1) - 1
+   *         frames, the last bucket also longer ones. */
+  uint64_t gap_histogram[gap_buckets];
+};
+
+/**
+ * @brief   Counters of delivered and lost frames.
+ *
+ * @note    Written by the frame grabber with relaxed atomics, so recording
+ *          never blocks and reads from any thread are approximate while
+ *          frames are arriving.
+ */
+class frame_counters
+{
+private:
+  std::atomic< uint64_t > _frames;
+  std::atomic< uint64_t > _lost;
+  std::atomic< uint64_t > _gaps;
+  std::atomic< uint64_t > _longest_gap;
+  std::atomic< uint64_t > _stale;
+  std::atomic< uint64_t > _histogram[gap_buckets];
+
+  /** @brief Time of the last frame in steady_clock nanoseconds, 0 if
+   *         none. */
+  std::atomic< int64_t > _last;
+
+public:
+  frame_counters();
+
+  frame_counters(const frame_counters &) = delete;
+  frame_counters &operator=(const frame_counters &) = delete;
+
+  /**
+   * @brief   Records a delivered frame.
+   *
+   * @param[in] received  Time the frame was received.
+   */
+  void recordFrame(const std::chrono::steady_clock::time_point received);
+
+  /**
+   * @brief   Records a gap in the frame numbers.
+   *
+   * @param[in] lost  Number of frames missing, at least 1.
+   */
+  void recordGap(const uint64_t lost);
+
+  /**
+   * @brief   Records a fetch whose frame number did not advance.
+   */
+  void recordStale();
+
+  /**
+   * @brief   Resets all counters except the time of the last frame.
+   */
+  void reset();
+
+  /**
+   * @brief   Gets the current statistics.
+   */
+  frame_stats summary() const;
+};
+
+}  // end libviconstream
+
+#endif
@@ -0,0 +1,187 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "frame.h"
+
+#ifndef _VICONSTREAM_FRAME_SOURCE_H
+#define _VICONSTREAM_FRAME_SOURCE_H
+
+namespace libviconstream
+{
+namespace DataKind
+{
+  enum Enum
+  {
+    GlobalPose       = 1 << 0, ///< Global pose of segments.
+    LocalPose        = 1 << 1, ///< Pose of segments relative to their parent.
+    Markers          = 1 << 2, ///< Labeled markers of subjects.
+    UnlabeledMarkers = 1 << 3, ///< Unlabeled markers in the volume.
+    Devices          = 1 << 4, ///< Devices and their outputs.
+    All              = (1 << 5) - 1
+  };
+}
+
+/**
+ * @brief   What to extract from a frame, the union of what the subscribers
+ *          need. A source may extract more than requested.
+ */
+struct extraction_filter
+{
+  /** @brief Combination of @p DataKind flags. */
+  unsigned int kinds;
+
+  /** @brief Extract all subjects, else only those in @p subjects. */
+  bool all_subjects;
+
+  /** @brief Sorted names of the subjects to extract. */
+  std::vector< std::string > subjects;
+
+  /**
+   * @brief   Extract all segments, else only those in @p segments. The
+   *          root segment of a subject is always extracted.
+   */
+  bool all_segments;
+
+  /** @brief Sorted names of the segments to extract. */
+  std::vector< std::string > segments;
+
+  /** @brief Extract all labeled markers, else only those in @p markers. */
+  bool all_markers;
+
+  /** @brief Sorted names of the labeled markers to extract. */
+  std::vector< std::string > markers;
+
+  /**
+   * @brief   Defaults to everything.
+   */
+  extraction_filter()
+      : kinds(DataKind::All), all_subjects(true), all_segments(true),
+        all_markers(true)
+  {
+  }
+
+  /**
+   * @brief   Checks if a kind of data is requested.
+   */
+  bool wants(const DataKind::Enum kind) const
+  {
+    return (kinds & kind) != 0;
+  }
+
+  /**
+   * @brief   Checks if a subject is requested.
+   */
+  bool wantsSubject(const std::string &subject) const
+  {
+    return all_subjects ||
+           std::binary_search(subjects.begin(), subjects.end(), subject);
+  }
+
+  /**
+   * @brief   Checks if a segment is requested.
+   */
+  bool wantsSegment(const std::string &segment) const
+  {
+    return all_segments ||
+           std::binary_search(segments.begin(), segments.end(), segment);
+  }
+
+  /**
+   * @brief   Checks if a labeled marker is requested.
+   */
+  bool wantsMarker(const std::string &marker) const
+  {
+    return all_markers ||
+           std::binary_search(markers.begin(), markers.end(), marker);
+  }
+};
+
+/** @brief Stream settings applied by a source after connecting. */
+struct stream_settings
+{
+  bool segment_data;
+  bool marker_data;
+  bool unlabeled_marker_data;
+  bool device_data;
+  StreamMode::Enum stream_mode;
+};
+
+/**
+ * @brief   Interface of a source of frames behind the arbiter.
+ *
+ * @note    Mirrors the subset of the SDK's Client used by the arbiter. All
+ *          functions except @p name are only called from one thread at a
+ *          time, either the caller of @p enableStream or the frame grabber.
+ */
+class frame_source
+{
+public:
+  virtual ~frame_source()
+  {
+  }
+
+  /**
+   * @brief   Connects to the source.
+   *
+   * @return  Returns true if the connection was established.
+   */
+  virtual bool connect() = 0;
+
+  /**
+   * @brief   Disconnects from the source.
+   */
+  virtual void disconnect() = 0;
+
+  /**
+   * @brief   Checks if the source is connected.
+   */
+  virtual bool isConnected() = 0;
+
+  /**
+   * @brief   Applies the data types and stream mode to stream.
+   *
+   * @param[in] settings  The settings to apply.
+   */
+  virtual void configure(const stream_settings &settings) = 0;
+
+  /**
+   * @brief   Fetches the next frame, as Client::GetFrame.
+   *
+   * @return  Returns true if a frame is available.
+   */
+  virtual bool getFrame() = 0;
+
+  /**
+   * @brief   Gets the frame number of the current frame.
+   */
+  virtual unsigned int frameNumber() = 0;
+
+  /**
+   * @brief   Gets the frame rate in Hz, 0 if unknown.
+   */
+  virtual double frameRate() = 0;
+
+  /**
+   * @brief   Extracts the current frame into a snapshot.
+   *
+   * @param[out] f        The cleared frame to fill.
+   * @param[in]  filter   The subjects and kinds of data to extract.
+   */
+  virtual void extract(frame &f, const extraction_filter &filter) = 0;
+
+  /**
+   * @brief   Gets a human readable name of the source, for logging.
+   */
+  virtual std::string name() const = 0;
+};
+
+}  // end libviconstream
+
+#endif
@@ -0,0 +1,337 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <exception>
+#include <utility>
+
+/* Coroutine includes, C++20. */
+#include <coroutine>
+
+/* Threading includes. */
+#include <mutex>
+
+#include "frame.h"
+#include "subscriber.h"
+
+#ifndef _VICONSTREAM_FRAME_STREAM_H
+#define _VICONSTREAM_FRAME_STREAM_H
+
+namespace libviconstream
+{
+class arbiter;
+
+/** @brief Resumes a coroutine which waited for a frame, e.g. by posting it
+ *         to an executor. */
+typedef std::function< void(std::coroutine_handle<>) > frame_resumer;
+
+/** @brief Settings of a frame stream. */
+struct stream_options
+{
+  /** @brief The subjects and data of the frames. */
+  subscription filter;
+
+  /** @brief Frames buffered while no coroutine waits, the oldest is
+   *         dropped when full. */
+  size_t buffer;
+
+  /** @brief Return the newest buffered frame and drop the older ones,
+   *         else return them in order. */
+  bool skip_to_latest;
+
+  /** @brief Resumes a waiting coroutine on a new frame, empty to resume it
+   *         directly on the frame grabber. */
+  frame_resumer resumer;
+
+  /**
+   * @brief   Defaults to all data, a buffer of one frame, skipping to the
+   *          latest frame and resuming on the frame grabber.
+   */
+  stream_options();
+};
+
+/**
+ * @brief   Async generator of frames, the coroutine type of
+ *          @p frame_stream::frames and of coroutines transforming frames.
+ *
+ * @note    Write one as a coroutine which co_awaits and co_yields frame
+ *          pointers, consume it with @p next. Not thread safe, one
+ *          consumer at a time.
+ */
+class frame_generator
+{
+public:
+  struct promise_type
+  {
+    frame_ptr value;
+    std::coroutine_handle<> consumer;
+    std::exception_ptr error;
+
+    /** @brief Suspends the generator and resumes its consumer. */
+    struct yield_awaiter
+    {
+      bool await_ready() noexcept
+      {
+        return false;
+      }
+
+      std::coroutine_handle<> await_suspend(
+          std::coroutine_handle< promise_type > h) noexcept
+      {
+        return h.promise().consumer;
+      }
+
+      void await_resume() noexcept
+      {
+      }
+    };
+
+    frame_generator get_return_object()
+    {
+      return frame_generator(
+          std::coroutine_handle< promise_type >::from_promise(*this));
+    }
+
+    std::suspend_always initial_suspend() noexcept
+    {
+      return {};
+    }
+
+    yield_awaiter final_suspend() noexcept
+    {
+      value.reset();
+      return {};
+    }
+
+    yield_awaiter yield_value(frame_ptr f) noexcept
+    {
+      value = std::move(f);
+      return {};
+    }
+
+    void return_void() noexcept
+    {
+    }
+
+    void unhandled_exception() noexcept
+    {
+      error = std::current_exception();
+    }
+  };
+
+  /** @brief Runs the generator to its next frame. */
+  struct next_awaiter
+  {
+    std::coroutine_handle< promise_type > generator;
+
+    bool await_ready() noexcept
+    {
+      return !generator || generator.done();
+    }
+
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<> consumer) noexcept
+    {
+      generator.promise().consumer = consumer;
+      return generator;
+    }
+
+    frame_ptr await_resume()
+    {
+      if (!generator)
+        return nullptr;
+
+      if (generator.promise().error)
+        std::rethrow_exception(
+            std::exchange(generator.promise().error, nullptr));
+
+      return std::move(generator.promise().value);
+    }
+  };
+
+private:
+  std::coroutine_handle< promise_type > _handle;
+
+  explicit frame_generator(std::coroutine_handle< promise_type > h)
+      : _handle(h)
+  {
+  }
+
+public:
+  frame_generator(frame_generator &&other) noexcept
+      : _handle(std::exchange(other._handle, nullptr))
+  {
+  }
+
+  frame_generator &operator=(frame_generator &&other) noexcept
+  {
+    if (this != &other)
+    {
+      if (_handle)
+        _handle.destroy();
+
+      _handle = std::exchange(other._handle, nullptr);
+    }
+
+    return *this;
+  }
+
+  frame_generator(const frame_generator &) = delete;
+  frame_generator &operator=(const frame_generator &) = delete;
+
+  ~frame_generator()
+  {
+    if (_handle)
+      _handle.destroy();
+  }
+
+  /**
+   * @brief   Awaits the next frame of the generator.
+   *
+   * @return  An awaitable of the frame, nullptr when the generator ended.
+   */
+  next_awaiter next() noexcept
+  {
+    return next_awaiter{_handle};
+  }
+};
+
+/**
+ * @brief   Awaitable stream of the frames of an arbiter, for coroutines:
+ *          while (frame_ptr f = co_await stream.next()) { ... }
+ *
+ * @note    Fed by an inline subscriber, so no thread or context switch is
+ *          added between the frame grabber and the coroutine. Without a
+ *          @p resumer the coroutine runs on the frame grabber until it
+ *          suspends again, like an inline callback. One coroutine may wait
+ *          at a time. Requires C++20, it is built as the optional
+ *          viconstream_coro library.
+ */
+class frame_stream
+{
+public:
+  /** @brief Awaits the next frame of the stream. */
+  class next_awaiter
+  {
+  private:
+    frame_stream &_stream;
+    frame_ptr _frame;
+
+    friend class frame_stream;
+
+  public:
+    explicit next_awaiter(frame_stream &stream) : _stream(stream)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+      return false;
+    }
+
+    /** @brief Takes a buffered frame without suspending, if any. */
+    bool await_suspend(std::coroutine_handle<> h);
+
+    frame_ptr await_resume() noexcept
+    {
+      return std::move(_frame);
+    }
+  };
+
+private:
+  const stream_options _options;
+
+  /** @brief The arbiter and the subscriber's ID, while open. */
+  arbiter *_arbiter;
+  unsigned int _id;
+
+  /** @brief Protects the buffer and the waiting coroutine. */
+  std::mutex _lock;
+
+  /** @brief Ring buffer of frames not yet awaited. */
+  std::vector< frame_ptr > _buffer;
+  size_t _head;
+  size_t _count;
+
+  /** @brief The waiting coroutine and where its frame goes. */
+  std::coroutine_handle<> _waiter;
+  next_awaiter *_waiting;
+
+  bool _closed;
+
+  /** @brief Statistics. */
+  std::atomic< uint64_t > _received;
+  std::atomic< uint64_t > _skipped;
+
+  /**
+   * @brief   Hands a frame to the waiting coroutine or the buffer, from the
+   *          frame grabber.
+   */
+  void push(const frame &f);
+
+  /**
+   * @brief   Takes the next buffered frame, with @p _lock held.
+   */
+  frame_ptr pop();
+
+  /**
+   * @brief   Resumes a coroutine through the resumer.
+   */
+  void resume(std::coroutine_handle<> h);
+
+public:
+  /**
+   * @brief   Constructor for the stream, subscribes to the arbiter.
+   *
+   * @param[in] a         The arbiter to stream from.
+   * @param[in] options   The stream options.
+   */
+  frame_stream(arbiter &a, const stream_options &options = stream_options());
+
+  /**
+   * @brief   Destructor closes the stream.
+   */
+  ~frame_stream();
+
+  frame_stream(const frame_stream &) = delete;
+  frame_stream &operator=(const frame_stream &) = delete;
+
+  /**
+   * @brief   Awaits the next frame.
+   *
+   * @return  An awaitable of the frame, nullptr once the stream is closed.
+   */
+  next_awaiter next();
+
+  /**
+   * @brief   Gets the frames as an async generator, which ends when the
+   *          stream is closed.
+   */
+  frame_generator frames();
+
+  /**
+   * @brief   Unsubscribes and resumes a waiting coroutine with nullptr.
+   */
+  void close();
+
+  /**
+   * @brief   Number of frames received from the arbiter.
+   */
+  uint64_t framesReceived() const;
+
+  /**
+   * @brief   Number of frames dropped by a full buffer or skipped to the
+   *          latest frame.
+   */
+  uint64_t framesSkipped() const;
+};
+
+}  // end libviconstream
+
+#endif
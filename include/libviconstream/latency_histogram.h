@@ -0,0 +1,104 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <atomic>
+
+#ifndef _VICONSTREAM_LATENCY_HISTOGRAM_H
+#define _VICONSTREAM_LATENCY_HISTOGRAM_H
+
+namespace libviconstream
+{
+/** @brief Summary of a latency distribution, in seconds. */
+struct latency_summary
+{
+  uint64_t count;
+  double mean;
+  double p50;
+  double p99;
+  double p999;
+  double max;
+};
+
+/**
+ * @brief   Log-linear (HDR style) histogram of durations in nanoseconds.
+ *
+ * @note    Values below 64 ns are exact, above that each power of two is
+ *          split in 32 buckets, i.e. a relative resolution of ~3 %, up to
+ *          about 18 minutes. Recording is wait-free with relaxed atomics
+ *          and safe from any number of threads, reads are approximate while
+ *          recording is ongoing.
+ */
+class latency_histogram
+{
+public:
+  /** @brief Number of buckets. */
+  static const unsigned int bucket_count = 64 + 35 * 32;
+
+private:
+  std::atomic< uint64_t > _buckets[bucket_count];
+  std::atomic< uint64_t > _count;
+  std::atomic< uint64_t > _sum;
+  std::atomic< uint64_t > _max;
+
+  /**
+   * @brief   Maps a value to its bucket.
+   */
+  static unsigned int bucketOf(uint64_t ns);
+
+  /**
+   * @brief   Gets the highest value of a bucket.
+   */
+  static uint64_t valueOf(const unsigned int bucket);
+
+public:
+  latency_histogram();
+
+  latency_histogram(const latency_histogram &) = delete;
+  latency_histogram &operator=(const latency_histogram &) = delete;
+
+  /**
+   * @brief   Records a duration, negative durations count as 0.
+   *
+   * @param[in] ns  The duration in nanoseconds.
+   */
+  void record(const int64_t ns);
+
+  /**
+   * @brief   Adds all samples of another histogram to this one.
+   *
+   * @param[in] other   The histogram to add.
+   */
+  void add(const latency_histogram &other);
+
+  /**
+   * @brief   Clears all samples, e.g. to start a new measurement window.
+   */
+  void reset();
+
+  /**
+   * @brief   Number of recorded samples.
+   */
+  uint64_t count() const;
+
+  /**
+   * @brief   Gets a percentile.
+   *
+   * @param[in] p   The percentile in [0, 100].
+   *
+   * @return  The percentile in nanoseconds, 0 if empty.
+   */
+  uint64_t percentile(const double p) const;
+
+  /**
+   * @brief   Summarizes the distribution.
+   */
+  latency_summary summary() const;
+};
+
+}  // end libviconstream
+
+#endif
@@ -0,0 +1,165 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstddef>
+#include <atomic>
+
+#ifndef _VICONSTREAM_LATEST_BUFFER_H
+#define _VICONSTREAM_LATEST_BUFFER_H
+
+namespace libviconstream
+{
+/**
+ * @brief   Single writer, multiple reader buffer holding the latest value.
+ *
+ * @note    A generalized triple buffer: the writer fills a slot which is
+ *          neither published nor pinned by a reader and then publishes it.
+ *          Readers pin the published slot with a counter and retry only if
+ *          the writer published in between, so readers never block and
+ *          never see a value being written. The writer never waits either,
+ *          if all slots are pinned the publication is skipped.
+ *
+ * @tparam  T   The value type.
+ * @tparam  N   The number of slots, at least 3.
+ */
+template < typename T, size_t N = 8 >
+class latest_buffer
+{
+  static_assert(N >= 3, "A latest_buffer needs at least 3 slots.");
+
+private:
+  struct slot
+  {
+    std::atomic< unsigned int > readers;
+    T value;
+
+    slot() : readers(0), value()
+    {
+    }
+  };
+
+  /** @brief The value slots. */
+  slot _slots[N];
+
+  /** @brief Index of the published slot, N if nothing is published. */
+  std::atomic< size_t > _published;
+
+public:
+  /**
+   * @brief   RAII handle pinning a published value while it is read.
+   */
+  class handle
+  {
+  private:
+    slot *_slot;
+
+  public:
+    explicit handle(slot *s = nullptr) : _slot(s)
+    {
+    }
+
+    handle(handle &&other) : _slot(other._slot)
+    {
+      other._slot = nullptr;
+    }
+
+    handle(const handle &) = delete;
+    handle &operator=(const handle &) = delete;
+
+    ~handle()
+    {
+      if (_slot)
+        _slot->readers.fetch_sub(1, std::memory_order_release);
+    }
+
+    /** @brief True if a value has been published. */
+    explicit operator bool() const
+    {
+      return _slot != nullptr;
+    }
+
+    const T &operator*() const
+    {
+      return _slot->value;
+    }
+
+    const T *operator->() const
+    {
+      return &_slot->value;
+    }
+  };
+
+  latest_buffer() : _published(N)
+  {
+  }
+
+  latest_buffer(const latest_buffer &) = delete;
+  latest_buffer &operator=(const latest_buffer &) = delete;
+
+  /**
+   * @brief   Gets a slot for writing, only called from the writer thread.
+   *
+   * @return  Pointer to a free slot, nullptr if all slots are pinned.
+   */
+  T *acquire()
+  {
+    const size_t published = _published.load(std::memory_order_seq_cst);
+
+    for (size_t i = 0; i < N; i++)
+    {
+      if (i != published &&
+          _slots[i].readers.load(std::memory_order_seq_cst) == 0)
+        return &_slots[i].value;
+    }
+
+    return nullptr;
+  }
+
+  /**
+   * @brief   Publishes a slot from @p acquire as the latest value.
+   *
+   * @param[in] value   Pointer returned by @p acquire.
+   */
+  void publish(T *value)
+  {
+    for (size_t i = 0; i < N; i++)
+    {
+      if (&_slots[i].value == value)
+      {
+        _published.store(i, std::memory_order_seq_cst);
+        return;
+      }
+    }
+  }
+
+  /**
+   * @brief   Pins and returns the latest value, safe from any thread.
+   *
+   * @return  A handle to the latest value, empty if none is published.
+   */
+  handle read()
+  {
+    while (true)
+    {
+      const size_t idx = _published.load(std::memory_order_seq_cst);
+
+      if (idx == N)
+        return handle();
+
+      _slots[idx].readers.fetch_add(1, std::memory_order_seq_cst);
+
+      /* Still published, the writer will not touch the slot now. */
+      if (_published.load(std::memory_order_seq_cst) == idx)
+        return handle(&_slots[idx]);
+
+      _slots[idx].readers.fetch_sub(1, std::memory_order_release);
+    }
+  }
+};
+
+}  // end libviconstream
+
+#endif
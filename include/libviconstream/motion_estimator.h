@@ -0,0 +1,113 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <vector>
+
+#include "frame.h"
+
+#ifndef _VICONSTREAM_MOTION_ESTIMATOR_H
+#define _VICONSTREAM_MOTION_ESTIMATOR_H
+
+namespace libviconstream
+{
+/** @brief Settings of the velocity and acceleration estimation. */
+struct motion_settings
+{
+  /** @brief Time constant of the first order low-pass on the velocities and
+   *         the acceleration in seconds, 0 for plain differences. */
+  double smoothing;
+
+  /** @brief A subject not seen for longer than this in seconds starts over,
+   *         as do occluded subjects. */
+  double max_gap;
+
+  /**
+   * @brief   Defaults to no smoothing and a 100 ms gap.
+   */
+  motion_settings();
+};
+
+/**
+ * @brief   Estimates the velocities and acceleration of all subjects' root
+ *          segments, filling @p frame::motion.
+ *
+ * @note    State is kept per subject handle as a structure of arrays.
+ *          Each frame is processed in three passes: the subjects are
+ *          gathered into contiguous arrays, all estimates are computed in
+ *          one branch free loop the compiler vectorizes, and the state is
+ *          scattered back. The time between samples follows the frame
+ *          numbers of each subject's source, so dropped frames give the
+ *          correct time step. A sample repeated in merged frames of
+ *          several sources keeps the estimates until its source delivers.
+ */
+class motion_estimator
+{
+private:
+  /** @brief The settings. */
+  motion_settings _settings;
+
+  /** @brief State by subject handle id: the last pose, the estimates and
+   *         the number of consecutive samples behind them, up to 3. */
+  std::vector< double > _position[3];
+  std::vector< double > _rotation[4];
+  std::vector< double > _velocity[3];
+  std::vector< double > _angular[3];
+  std::vector< double > _acceleration[3];
+  std::vector< unsigned int > _frame;
+  std::vector< double > _time;
+  std::vector< uint8_t > _samples;
+
+  /** @brief Scratch arrays of the frame being processed, by subject index. */
+  std::vector< uint32_t > _ids;
+  std::vector< uint8_t > _next;
+  std::vector< double > _cur_position[3];
+  std::vector< double > _cur_rotation[4];
+  std::vector< double > _prev_position[3];
+  std::vector< double > _prev_rotation[4];
+  std::vector< double > _prev_velocity[3];
+  std::vector< double > _prev_angular[3];
+  std::vector< double > _prev_acceleration[3];
+  std::vector< double > _inv_dt;
+  std::vector< double > _gain_v;
+  std::vector< double > _gain_a;
+  std::vector< double > _has_v;
+
+  /**
+   * @brief   Grows the state to hold a handle id.
+   */
+  void reserve(const uint32_t id);
+
+public:
+  /**
+   * @brief   Constructor for the estimator.
+   *
+   * @param[in] settings  The smoothing and gap settings.
+   */
+  motion_estimator(const motion_settings &settings = motion_settings());
+
+  /**
+   * @brief   Estimates the motion of a frame's subjects and advances the
+   *          state.
+   *
+   * @note    Needs the frame's handle map and reception time. Allocates
+   *          only when the frame has more subjects than any before.
+   *
+   * @param[in,out] f   The frame, its @p motion is filled.
+   */
+  void update(frame &f);
+
+  /**
+   * @brief   Changes the settings and forgets all subjects.
+   *
+   * @param[in] settings  The smoothing and gap settings.
+   */
+  void reset(const motion_settings &settings);
+};
+
+}  // end libviconstream
+
+#endif
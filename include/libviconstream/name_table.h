@@ -0,0 +1,102 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+
+/* Threading includes. */
+#include <mutex>
+
+#include "frame.h"
+
+#ifndef _VICONSTREAM_NAME_TABLE_H
+#define _VICONSTREAM_NAME_TABLE_H
+
+namespace libviconstream
+{
+/**
+ * @brief   Interns subject, segment and marker names into small integer
+ *          handles.
+ *
+ * @note    A handle is stable for the lifetime of the table, also for names
+ *          which are not (yet) in the stream. Interning takes a lock and is
+ *          meant to be done once, lookups through a frame's @p handle_map
+ *          are plain array accesses.
+ */
+class name_table
+{
+private:
+  typedef std::pair< std::string, std::string > name_pair;
+
+  /** @brief Mutex for the tables. */
+  mutable std::mutex _lock;
+
+  /** @brief Name to handle id. */
+  std::map< std::string, uint32_t > _subjects;
+  std::map< name_pair, uint32_t > _segments;
+  std::map< name_pair, uint32_t > _markers;
+
+  /** @brief Incremented each time a new name is interned. */
+  std::atomic< uint32_t > _generation;
+
+public:
+  name_table();
+
+  /**
+   * @brief   Interns a subject name, thread safe.
+   *
+   * @param[in] subject   Name of the subject.
+   *
+   * @return  The subject's handle.
+   */
+  subject_handle subject(const std::string &subject);
+
+  /**
+   * @brief   Interns a segment name, thread safe.
+   *
+   * @param[in] subject   Name of the subject.
+   * @param[in] segment   Name of the segment.
+   *
+   * @return  The segment's handle.
+   */
+  segment_handle segment(const std::string &subject,
+                         const std::string &segment);
+
+  /**
+   * @brief   Interns a labeled marker name, thread safe.
+   *
+   * @param[in] subject   Name of the subject.
+   * @param[in] marker    Name of the marker.
+   *
+   * @return  The marker's handle.
+   */
+  marker_handle marker(const std::string &subject, const std::string &marker);
+
+  /**
+   * @brief   Gets the generation, changes when a name has been interned.
+   */
+  uint32_t generation() const;
+
+  /**
+   * @brief   Builds the mapping from all interned handles to a frame's data
+   *          arrays.
+   *
+   * @param[in]  f           The frame, whose names define the model.
+   * @param[out] generation  The generation the mapping was built at.
+   *
+   * @return  The mapping.
+   */
+  std::shared_ptr< const handle_map > map(const frame &f,
+                                          uint32_t &generation) const;
+};
+
+}  // end libviconstream
+
+#endif
@@ -0,0 +1,87 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstddef>
+#include <vector>
+
+#include "frame.h"
+
+#ifndef _VICONSTREAM_POINT_CLOUD_H
+#define _VICONSTREAM_POINT_CLOUD_H
+
+namespace libviconstream
+{
+/**
+ * @brief   The unlabeled markers of a frame as a structure of arrays, for
+ *          bulk processing of large clouds.
+ *
+ * @note    Keep one cloud per consumer and @p assign every frame, the
+ *          arrays keep their capacity so steady state processing never
+ *          allocates. Transforms use SSE2, or AVX when the library is
+ *          built with it, and fall back to plain loops elsewhere.
+ */
+class point_cloud
+{
+public:
+  /** @brief Coordinates in millimeters, index aligned. */
+  std::vector< double > x;
+  std::vector< double > y;
+  std::vector< double > z;
+
+  /**
+   * @brief   Gets the number of points.
+   */
+  size_t size() const;
+
+  /**
+   * @brief   Removes all points, keeping the capacity.
+   */
+  void clear();
+
+  /**
+   * @brief   Replaces the cloud with a frame's unlabeled markers.
+   *
+   * @param[in] f   The frame.
+   */
+  void assign(const frame &f);
+
+  /**
+   * @brief   Applies a rigid transform to every point, p' = R p + t.
+   *
+   * @param[in] rotation      Row major rotation matrix.
+   * @param[in] translation   Translation in millimeters.
+   */
+  void transform(const double rotation[9], const double translation[3]);
+
+  /**
+   * @brief   Moves the cloud from a body's frame to the world frame.
+   *
+   * @param[in] body  Global pose of the body.
+   */
+  void transform(const pose &body);
+
+  /**
+   * @brief   Moves the cloud from the world frame to a body's frame, e.g.
+   *          to see the markers relative to a tracked camera.
+   *
+   * @param[in] body  Global pose of the body.
+   */
+  void inverseTransform(const pose &body);
+
+  /**
+   * @brief   Keeps only the points inside an axis aligned box, in order.
+   *
+   * @param[in] min   Lower corner of the box.
+   * @param[in] max   Upper corner of the box.
+   *
+   * @return  The number of points kept.
+   */
+  size_t crop(const double min[3], const double max[3]);
+};
+
+}  // end libviconstream
+
+#endif
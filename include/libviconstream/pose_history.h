@@ -0,0 +1,148 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+#include "frame.h"
+#include "pose_math.h"
+
+#ifndef _VICONSTREAM_POSE_HISTORY_H
+#define _VICONSTREAM_POSE_HISTORY_H
+
+namespace libviconstream
+{
+/** @brief Settings of the pose history. */
+struct history_settings
+{
+  /** @brief Number of subject handles tracked, handles beyond are ignored. */
+  size_t subjects;
+
+  /** @brief Samples kept per subject, rounded up to a power of two. */
+  size_t depth;
+
+  /** @brief Samples further apart than this in seconds are not
+   *         interpolated between, 0 for no limit. */
+  double max_gap;
+
+  /**
+   * @brief   Defaults to 64 subjects, 256 samples and a 100 ms gap.
+   */
+  history_settings();
+};
+
+/**
+ * @brief   Time indexed history of the root pose of every subject.
+ *
+ * @note    Every subject has a preallocated ring of samples, with the times
+ *          and the poses in separate arrays so lookups only touch the
+ *          times. A single writer records frames and any number of readers
+ *          query without locks: a reader validates against the ring's head
+ *          that the writer did not overwrite what it read, and else
+ *          retries. Samples are stamped with the estimated capture time,
+ *          reception time minus the server's reported latency.
+ */
+class pose_history
+{
+private:
+  /** @brief Values of a pose sample in the pose array. */
+  static const size_t stride = 8;
+
+  /** @brief Per subject ring state, padded to its own cache line. */
+  struct ring
+  {
+    /** @brief Number of samples ever written. */
+    std::atomic< uint64_t > head;
+
+    /** @brief Time of the newest sample, only used by the writer. */
+    double last;
+
+    char pad[64 - sizeof(std::atomic< uint64_t >) - sizeof(double)];
+
+    ring() : head(0), last(0)
+    {
+    }
+  };
+
+  /** @brief The settings, with the depth rounded. */
+  history_settings _settings;
+  uint64_t _mask;
+
+  /** @brief Ring state per subject. */
+  std::vector< ring > _rings;
+
+  /** @brief Sample times in seconds, by subject then ring position. */
+  std::vector< std::atomic< double > > _times;
+
+  /** @brief Translation, rotation and occlusion per sample, same order. */
+  std::vector< std::atomic< double > > _poses;
+
+  /**
+   * @brief   Reads a sample's pose.
+   */
+  void load(const size_t slot, pose &p) const;
+
+public:
+  /**
+   * @brief   Constructor, allocates all samples.
+   *
+   * @param[in] settings  Size of the history.
+   */
+  pose_history(const history_settings &settings = history_settings());
+
+  pose_history(const pose_history &) = delete;
+  pose_history &operator=(const pose_history &) = delete;
+
+  /**
+   * @brief   Records the root poses of a frame, from the writer thread only.
+   *
+   * @note    Never allocates. Frames not newer than the previous sample of a
+   *          subject are ignored.
+   *
+   * @param[in] f   The frame, with its handle map.
+   */
+  void record(const frame &f);
+
+  /**
+   * @brief   Gets the pose of a subject's root segment at a host time,
+   *          safe from any thread.
+   *
+   * @param[in]  subject  Handle of the subject.
+   * @param[in]  t        Host time to look up.
+   * @param[out] p        The interpolated pose.
+   * @param[in]  mode     How the orientation is interpolated.
+   *
+   * @return  Return true if @p t is within the history and the samples
+   *          around it are close enough and not occluded.
+   */
+  bool poseAt(const subject_handle subject,
+              const std::chrono::steady_clock::time_point &t, pose &p,
+              const Interpolation::Enum mode = Interpolation::Slerp) const;
+
+  /**
+   * @brief   Gets the time span covered by a subject's history.
+   *
+   * @param[in]  subject  Handle of the subject.
+   * @param[out] oldest   Time of the oldest sample.
+   * @param[out] newest   Time of the newest sample.
+   *
+   * @return  Return true if the subject has samples.
+   */
+  bool span(const subject_handle subject,
+            std::chrono::steady_clock::time_point &oldest,
+            std::chrono::steady_clock::time_point &newest) const;
+
+  /**
+   * @brief   Gets the settings, with the depth as allocated.
+   */
+  const history_settings &settings() const;
+};
+
+}  // end libviconstream
+
+#endif
@@ -0,0 +1,118 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "frame.h"
+
+#ifndef _VICONSTREAM_POSE_MATH_H
+#define _VICONSTREAM_POSE_MATH_H
+
+namespace libviconstream
+{
+namespace Prediction
+{
+  enum Enum
+  {
+    ConstantVelocity,    ///< Linear extrapolation, needs two samples.
+    ConstantAcceleration ///< Quadratic extrapolation, needs three samples.
+  };
+}
+
+namespace Interpolation
+{
+  enum Enum
+  {
+    Linear, ///< Linear translation, normalized linear rotation.
+    Slerp   ///< Linear translation, spherical linear rotation.
+  };
+}
+
+/**
+ * @brief   Multiplies two quaternions, r = a * b, in (x, y, z, w) order.
+ */
+void quatMultiply(const double a[4], const double b[4], double r[4]);
+
+/**
+ * @brief   Normalizes a quaternion in place.
+ */
+void quatNormalize(double q[4]);
+
+/**
+ * @brief   Converts a unit quaternion to a row major rotation matrix.
+ *
+ * @param[in]  q    The quaternion in (x, y, z, w) order.
+ * @param[out] r    The rotation matrix.
+ */
+void quatToMatrix(const double q[4], double r[9]);
+
+/**
+ * @brief   Computes the angular velocity taking q0 to q1 in dt seconds.
+ *
+ * @param[in]  q0   The earlier orientation.
+ * @param[in]  q1   The later orientation.
+ * @param[in]  dt   Time between the orientations in seconds.
+ * @param[out] w    Angular velocity in the world frame in rad/s.
+ */
+void angularVelocity(const double q0[4], const double q1[4], const double dt,
+                     double w[3]);
+
+/**
+ * @brief   Rotates an orientation with a constant angular velocity.
+ *
+ * @param[in]  q    The orientation.
+ * @param[in]  w    Angular velocity in the world frame in rad/s.
+ * @param[in]  dt   Time to integrate over in seconds, may be negative.
+ * @param[out] r    The resulting orientation, may alias @p q.
+ */
+void integrateRotation(const double q[4], const double w[3], const double dt,
+                       double r[4]);
+
+/**
+ * @brief   Spherical linear interpolation between two orientations, taking
+ *          the shorter way around.
+ *
+ * @param[in]  q0     The orientation at @p alpha = 0.
+ * @param[in]  q1     The orientation at @p alpha = 1.
+ * @param[in]  alpha  Interpolation parameter.
+ * @param[out] r      The interpolated orientation.
+ */
+void quatSlerp(const double q0[4], const double q1[4], const double alpha,
+               double r[4]);
+
+/**
+ * @brief   Interpolates between two poses.
+ *
+ * @param[in]  p0     The pose at @p alpha = 0.
+ * @param[in]  p1     The pose at @p alpha = 1.
+ * @param[in]  alpha  Interpolation parameter.
+ * @param[in]  mode   How the orientation is interpolated.
+ * @param[out] p      The interpolated pose, occluded if either pose is.
+ */
+void interpolatePose(const pose &p0, const pose &p1, const double alpha,
+                     const Interpolation::Enum mode, pose &p);
+
+/**
+ * @brief   Extrapolates a pose from its most recent samples.
+ *
+ * @note    Position is extrapolated with a constant velocity or
+ *          acceleration, orientation by integrating the latest angular
+ *          velocity. The model falls back to fewer samples if some are
+ *          missing or occluded.
+ *
+ * @param[in]  samples  Recent poses, newest first.
+ * @param[in]  times    Times of the samples in seconds, newest first.
+ * @param[in]  count    Number of samples, 1 to 3.
+ * @param[in]  t        Time to predict for in seconds.
+ * @param[in]  model    The motion model.
+ * @param[out] p        The predicted pose.
+ *
+ * @return  Returns false if the newest sample is occluded.
+ */
+bool extrapolatePose(const pose *const samples[], const double times[],
+                     const unsigned int count, const double t,
+                     const Prediction::Enum model, pose &p);
+
+}  // end libviconstream
+
+#endif
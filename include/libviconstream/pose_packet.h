@@ -0,0 +1,179 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#ifndef _VICONSTREAM_POSE_PACKET_H
+#define _VICONSTREAM_POSE_PACKET_H
+
+namespace libviconstream
+{
+/*
+ * Wire format of the UDP pose relay, see udp_relay.h. Every datagram is a
+ * header followed by count entries, all fields little endian and floats in
+ * IEEE 754 single precision. Pose packets hold the root segment pose of
+ * subjects, identified by a numeric id. Names packets map the ids to
+ * subject names and are repeated periodically, so a receiver can start at
+ * any time. A frame with more subjects than fit in one datagram is split
+ * into several packets, each decodable on its own.
+ *
+ * This header and pose_packet.cpp only depend on the standard library, so
+ * they build on targets without the Vicon SDK.
+ */
+
+/** @brief Magic number at the start of every packet, "VSPK". */
+const uint32_t pose_packet_magic = 0x4b505356;
+
+/** @brief Version of the wire format. */
+const uint8_t pose_packet_version = 1;
+
+/** @brief Largest packet, fits an Ethernet MTU without fragmentation. */
+const size_t pose_packet_max_size = 1472;
+
+/** @brief Encoded sizes of the header and a pose entry. */
+const size_t pose_packet_header_size = 24;
+const size_t pose_packet_pose_size   = 32;
+
+/** @brief Pose entries per packet. */
+const size_t pose_packet_max_poses =
+    (pose_packet_max_size - pose_packet_header_size) / pose_packet_pose_size;
+
+namespace PacketType
+{
+  enum Enum
+  {
+    Poses = 1, ///< Poses of one frame.
+    Names = 2  ///< Names of the subject ids.
+  };
+}
+
+/** @brief Header of a packet. */
+struct packet_header
+{
+  /** @brief A @p PacketType value. */
+  uint8_t type;
+
+  /** @brief Index of the packet within the frame, and packets in total. */
+  uint8_t fragment;
+  uint8_t fragments;
+
+  /** @brief The Vicon frame number. */
+  uint32_t frame_number;
+
+  /** @brief Time from capture to sending in microseconds. */
+  uint32_t age_us;
+
+  /** @brief The server's frame rate in Hz. */
+  float frame_rate;
+
+  /** @brief Number of entries in the packet. */
+  uint16_t count;
+};
+
+/** @brief Global pose of a subject's root segment. */
+struct packet_pose
+{
+  uint16_t id;
+  bool occluded;
+
+  /** @brief Translation in millimeters. */
+  float translation[3];
+
+  /** @brief Rotation quaternion in (x, y, z, w) order. */
+  float rotation[4];
+};
+
+/** @brief Name of a subject id. */
+struct packet_name
+{
+  uint16_t id;
+  std::string name;
+};
+
+/**
+ * @brief   Encodes a header.
+ *
+ * @param[in]  h    The header.
+ * @param[out] out  Buffer of at least @p pose_packet_header_size bytes.
+ *
+ * @return  The number of bytes written.
+ */
+size_t encodePacketHeader(const packet_header &h, uint8_t *out);
+
+/**
+ * @brief   Encodes a pose entry.
+ *
+ * @param[in]  p    The pose.
+ * @param[out] out  Buffer of at least @p pose_packet_pose_size bytes.
+ *
+ * @return  The number of bytes written.
+ */
+size_t encodePacketPose(const packet_pose &p, uint8_t *out);
+
+/**
+ * @brief   Gets the encoded size of a name entry, names are truncated to
+ *          255 characters.
+ */
+size_t packetNameSize(const std::string &name);
+
+/**
+ * @brief   Encodes a name entry.
+ *
+ * @param[in]  id     The subject id.
+ * @param[in]  name   The subject name.
+ * @param[out] out    Buffer of at least @p packetNameSize bytes.
+ *
+ * @return  The number of bytes written.
+ */
+size_t encodePacketName(const uint16_t id, const std::string &name,
+                        uint8_t *out);
+
+/**
+ * @brief   Decodes and validates the header of a packet.
+ *
+ * @param[in]  data   The packet.
+ * @param[in]  size   Size of the packet in bytes.
+ * @param[out] h      The header.
+ *
+ * @return  Returns false if not a packet of a compatible version.
+ */
+bool decodePacketHeader(const uint8_t *data, const size_t size,
+                        packet_header &h);
+
+/**
+ * @brief   Decodes the entries of a Poses packet.
+ *
+ * @param[in]  data   The packet.
+ * @param[in]  size   Size of the packet in bytes.
+ * @param[in]  h      The packet's decoded header.
+ * @param[out] poses  The poses are appended.
+ *
+ * @return  Returns false if the packet is truncated.
+ */
+bool decodePacketPoses(const uint8_t *data, const size_t size,
+                       const packet_header &h,
+                       std::vector< packet_pose > &poses);
+
+/**
+ * @brief   Decodes the entries of a Names packet.
+ *
+ * @param[in]  data   The packet.
+ * @param[in]  size   Size of the packet in bytes.
+ * @param[in]  h      The packet's decoded header.
+ * @param[out] names  The names are appended.
+ *
+ * @return  Returns false if the packet is truncated.
+ */
+bool decodePacketNames(const uint8_t *data, const size_t size,
+                       const packet_header &h,
+                       std::vector< packet_name > &names);
+
+}  // end libviconstream
+
+#endif
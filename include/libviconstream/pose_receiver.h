@@ -0,0 +1,155 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "pose_packet.h"
+
+#ifndef _VICONSTREAM_POSE_RECEIVER_H
+#define _VICONSTREAM_POSE_RECEIVER_H
+
+namespace libviconstream
+{
+/** @brief A frame of poses received from a @p udp_relay. */
+struct received_frame
+{
+  /** @brief The Vicon frame number. */
+  uint32_t frame_number;
+
+  /** @brief The server's frame rate in Hz. */
+  float frame_rate;
+
+  /** @brief Time from capture to sending in microseconds, the capture
+   *         time is about @p received minus this. */
+  uint32_t age_us;
+
+  /** @brief Host time when the frame's last packet arrived. */
+  std::chrono::steady_clock::time_point received;
+
+  /** @brief Root segment poses of the relayed subjects. */
+  std::vector< packet_pose > poses;
+};
+
+/**
+ * @brief   Receives the pose packets of a @p udp_relay.
+ *
+ * @note    Only depends on the standard library and POSIX sockets, build
+ *          it with pose_packet.cpp on targets without the Vicon SDK (the
+ *          viconstream_receiver library). Not thread safe, use one
+ *          receiver per thread.
+ */
+class pose_receiver
+{
+private:
+  /** @brief The socket, -1 if closed. */
+  int _fd;
+
+  /** @brief Receive buffer of one datagram. */
+  std::vector< uint8_t > _buffer;
+
+  /** @brief Subject names by id, empty if unknown. */
+  std::vector< std::string > _names;
+
+  /** @brief The frame being assembled from its packets. */
+  received_frame _pending;
+  std::vector< uint8_t > _fragments;
+  unsigned int _missing;
+
+  /** @brief Frame number of the last complete frame. */
+  uint32_t _last;
+
+  /** @brief Statistics. */
+  uint64_t _frames;
+  uint64_t _incomplete;
+  uint64_t _rejected;
+
+  /**
+   * @brief   Handles one datagram.
+   *
+   * @return  Returns true if it completed the pending frame.
+   */
+  bool handle(const size_t size);
+
+public:
+  pose_receiver();
+  ~pose_receiver();
+
+  pose_receiver(const pose_receiver &) = delete;
+  pose_receiver &operator=(const pose_receiver &) = delete;
+
+  /**
+   * @brief   Opens the socket, closing any open one.
+   *
+   * @param[in] port        UDP port to receive on.
+   * @param[in] group       Multicast group to join, empty for unicast.
+   * @param[in] interface   Address of the interface to join the group on,
+   *                        empty for the default.
+   *
+   * @return  Returns false if the socket could not be bound.
+   */
+  bool open(const uint16_t port, const std::string &group = "",
+            const std::string &interface = "");
+
+  /**
+   * @brief   Closes the socket.
+   */
+  void close();
+
+  /**
+   * @brief   Checks if the socket is open.
+   */
+  bool isOpen() const;
+
+  /**
+   * @brief   Waits for the next complete frame.
+   *
+   * @param[out] f            The frame.
+   * @param[in]  timeout_ms   Longest time to wait, negative to wait forever.
+   *
+   * @return  Returns false on timeout or error.
+   */
+  bool receive(received_frame &f, const int timeout_ms = -1);
+
+  /**
+   * @brief   Gets the name of a subject id.
+   *
+   * @param[in] id  The subject id.
+   *
+   * @return  The name, empty until the relay has sent it.
+   */
+  const std::string &name(const uint16_t id) const;
+
+  /**
+   * @brief   Finds the id of a subject.
+   *
+   * @param[in] name  Name of the subject.
+   *
+   * @return  The id, or -1 if the name has not been received.
+   */
+  int find(const std::string &name) const;
+
+  /**
+   * @brief   Number of complete frames received.
+   */
+  uint64_t framesReceived() const;
+
+  /**
+   * @brief   Number of frames abandoned with packets missing.
+   */
+  uint64_t framesIncomplete() const;
+
+  /**
+   * @brief   Number of datagrams which were not valid packets.
+   */
+  uint64_t packetsRejected() const;
+};
+
+}  // end libviconstream
+
+#endif
@@ -0,0 +1,106 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#ifndef _VICONSTREAM_REALTIME_H
+#define _VICONSTREAM_REALTIME_H
+
+namespace libviconstream
+{
+namespace SchedPolicy
+{
+  enum Enum
+  {
+    Default,   ///< Leave the thread's scheduling unchanged.
+    Fifo,      ///< SCHED_FIFO, runs until it blocks or is preempted.
+    RoundRobin ///< SCHED_RR, time sliced among equal priorities.
+  };
+}
+
+/**
+ * @brief   Scheduling of one of the arbiter's threads.
+ *
+ * @note    A thread under Fifo or RoundRobin is not preempted by lower
+ *          priorities, so a yield gives them nothing. The frame grabber's
+ *          Adaptive wait therefore only polls for the next frame within
+ *          its guard interval of the expected arrival when it runs
+ *          real-time, and sleeps briefly outside it.
+ */
+struct thread_settings
+{
+  /** @brief CPUs the thread may run on, empty to leave it unchanged. */
+  std::vector< int > cpus;
+
+  /** @brief Scheduling policy, and its priority from 1 to 99. */
+  SchedPolicy::Enum policy;
+  int priority;
+
+  /** @brief Bytes of stack touched when the thread starts, so it does not
+   *         page fault later. Must be well below the thread's stack size,
+   *         0 for none. */
+  size_t stack_prefault;
+
+  /**
+   * @brief   Defaults to leaving the thread unchanged.
+   */
+  thread_settings();
+};
+
+/** @brief Real-time configuration of the arbiter's threads. */
+struct realtime_settings
+{
+  /** @brief The frame grabber, which also runs the inline callbacks. */
+  thread_settings grabber;
+
+  /** @brief The worker threads of async callbacks. */
+  thread_settings dispatch;
+
+  /** @brief Lock all current and future memory of the process with
+   *         mlockall() when the stream is enabled. */
+  bool lock_memory;
+
+  /**
+   * @brief   Defaults to leaving all threads and memory unchanged.
+   */
+  realtime_settings();
+};
+
+/**
+ * @brief   Applies the settings to the calling thread, as far as permitted.
+ *
+ * @note    Each part is applied on its own, a missing privilege only skips
+ *          that part.
+ *
+ * @param[in]  settings   The settings to apply.
+ * @param[out] errors     Description of the parts which failed.
+ *
+ * @return  Returns true if everything was applied.
+ */
+bool applyThreadSettings(const thread_settings &settings,
+                         std::string &errors);
+
+/**
+ * @brief   Checks if the calling thread runs under SCHED_FIFO or SCHED_RR.
+ *
+ * @return  Returns true if the thread is real-time scheduled.
+ */
+bool isRealtimeThread();
+
+/**
+ * @brief   Locks all current and future memory of the process.
+ *
+ * @param[out] errors   Description of the failure.
+ *
+ * @return  Returns true on success.
+ */
+bool lockMemory(std::string &errors);
+
+}  // end libviconstream
+
+#endif
@@ -0,0 +1,297 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include "frame.h"
+
+#ifndef _VICONSTREAM_RECORDING_H
+#define _VICONSTREAM_RECORDING_H
+
+namespace libviconstream
+{
+class arbiter;
+
+/*
+ * File format: a file_header followed by records, each a record_header and
+ * its payload. Frame records hold an encoded frame (see frame_codec.h).
+ * Every index_interval frames an index record lists the offsets of those
+ * frames and links to the previous index record. A cleanly closed file
+ * ends with a footer record pointing at the last index record; files
+ * without a footer are recovered by scanning.
+ */
+
+/** @brief Magic bytes at the start of a recording. */
+const char recording_magic[8] = {'V', 'S', 'R', 'E', 'C', '\0', '\0', '\0'};
+
+/** @brief Version of the recording container. */
+const uint32_t recording_version = 1;
+
+namespace RecordType
+{
+  enum Enum
+  {
+    Frame  = 1,
+    Index  = 2,
+    Footer = 3
+  };
+}
+
+struct file_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t codec_version;
+  uint32_t index_interval;
+  uint32_t reserved;
+};
+
+struct record_header
+{
+  uint32_t type;
+  uint32_t size;
+};
+
+struct index_header
+{
+  uint64_t previous;
+  uint32_t count;
+  uint32_t reserved;
+};
+
+struct index_entry
+{
+  uint32_t frame_number;
+  uint32_t reserved;
+  uint64_t offset;
+};
+
+struct footer
+{
+  uint64_t last_index;
+  uint64_t frame_count;
+};
+
+/**
+ * @brief   Records frames into an append-only binary file.
+ *
+ * @note    Frames are encoded into a large buffer which is written with a
+ *          single write() when full. Attached to an arbiter the recorder
+ *          runs as an async subscriber, so encoding and disk I/O never run
+ *          on the frame grabber thread.
+ */
+class recorder
+{
+private:
+  /** @brief File descriptor of the recording, -1 if closed. */
+  int _fd;
+
+  /** @brief Frames between index records. */
+  const uint32_t _index_interval;
+
+  /** @brief Write buffer and its flush threshold. */
+  std::vector< uint8_t > _buffer;
+  const size_t _buffer_size;
+
+  /** @brief Scratch buffer for encoding a frame. */
+  std::vector< uint8_t > _scratch;
+
+  /** @brief File offset of the next record. */
+  uint64_t _offset;
+
+  /** @brief Offset of the last index record, 0 if none. */
+  uint64_t _last_index;
+
+  /** @brief Frames since the last index record. */
+  std::vector< index_entry > _pending;
+
+  /** @brief The arbiter the recorder is attached to, if any. */
+  arbiter *_arbiter;
+  unsigned int _id;
+
+  /** @brief Statistics. */
+  std::atomic< uint64_t > _frames;
+  std::atomic< uint64_t > _bytes;
+
+  /** @brief Latched on the first failed write, nothing is appended after
+   *         it as the offsets no longer match the file. */
+  std::atomic< bool > _failed;
+
+  /**
+   * @brief   Appends a record to the write buffer, unless failed.
+   */
+  void appendRecord(const RecordType::Enum type, const void *payload,
+                    const size_t size);
+
+  /**
+   * @brief   Appends an index record for the pending frames.
+   */
+  void writeIndex();
+
+  /**
+   * @brief   Writes the buffer to the file, latches @p _failed on errors.
+   *
+   * @return  Returns false on I/O errors.
+   */
+  bool flush();
+
+public:
+  /**
+   * @brief   Constructor for the recorder, creates the file.
+   *
+   * @param[in] path            Path of the recording, truncated if existing.
+   * @param[in] index_interval  Frames between index records.
+   * @param[in] buffer_size     Size of the write buffer in bytes.
+   */
+  recorder(const std::string &path, const uint32_t index_interval = 256,
+           const size_t buffer_size = 1 << 20);
+
+  /**
+   * @brief   Destructor detaches and closes the recording.
+   */
+  ~recorder();
+
+  recorder(const recorder &) = delete;
+  recorder &operator=(const recorder &) = delete;
+
+  /**
+   * @brief   Checks if the file was opened successfully.
+   */
+  bool isOpen() const;
+
+  /**
+   * @brief   Records every frame of an arbiter from an async subscriber.
+   *
+   * @param[in] a           The arbiter to record.
+   * @param[in] queue_size  Frames to buffer before dropping.
+   *
+   * @return  Returns false if not open or already attached.
+   */
+  bool attach(arbiter &a, const size_t queue_size = 1024);
+
+  /**
+   * @brief   Stops recording from the arbiter, queued frames are dropped.
+   */
+  void detach();
+
+  /**
+   * @brief   Records one frame, only call from one thread at a time.
+   *
+   * @param[in] f   The frame to record.
+   */
+  void record(const frame &f);
+
+  /**
+   * @brief   Detaches, writes the index and footer and closes the file.
+   *
+   * @return  Returns false if not open or if any write failed, the
+   *          recording is then incomplete.
+   */
+  bool close();
+
+  /**
+   * @brief   Checks if a write failed, frames are no longer recorded.
+   */
+  bool failed() const;
+
+  /**
+   * @brief   Number of frames recorded.
+   */
+  uint64_t framesRecorded() const;
+
+  /**
+   * @brief   Number of bytes written to the file.
+   */
+  uint64_t bytesWritten() const;
+};
+
+/**
+ * @brief   Random access reader for recordings, memory maps the file.
+ */
+class recording_reader
+{
+private:
+  /** @brief The mapped file. */
+  const uint8_t *_data;
+  size_t _size;
+
+  /** @brief Frame number and offset of every frame, in file order. */
+  std::vector< index_entry > _index;
+
+  /**
+   * @brief   Loads the index by following the index records from the
+   *          footer.
+   *
+   * @return  Returns false if the file has no valid footer or index.
+   */
+  bool loadIndex();
+
+  /**
+   * @brief   Builds the index by scanning all records.
+   */
+  void scanIndex();
+
+public:
+  recording_reader();
+  ~recording_reader();
+
+  recording_reader(const recording_reader &) = delete;
+  recording_reader &operator=(const recording_reader &) = delete;
+
+  /**
+   * @brief   Opens a recording, closing any open one.
+   *
+   * @param[in] path  Path of the recording.
+   *
+   * @return  Returns false if the file could not be opened or is not a
+   *          recording of a compatible version.
+   */
+  bool open(const std::string &path);
+
+  /**
+   * @brief   Closes the recording.
+   */
+  void close();
+
+  /**
+   * @brief   Number of frames in the recording.
+   */
+  size_t frameCount() const;
+
+  /**
+   * @brief   Frame number of the frame at an index.
+   *
+   * @param[in] index   Index of the frame, less than @p frameCount.
+   */
+  unsigned int frameNumber(const size_t index) const;
+
+  /**
+   * @brief   Finds the first frame with a frame number at or after
+   *          @p frame_number.
+   *
+   * @param[in] frame_number  The frame number to seek to.
+   *
+   * @return  Index of the frame, @p frameCount if past the end.
+   */
+  size_t find(const unsigned int frame_number) const;
+
+  /**
+   * @brief   Reads and decodes a frame.
+   *
+   * @param[in]  index  Index of the frame, less than @p frameCount.
+   * @param[out] f      The decoded frame.
+   *
+   * @return  Returns false if the frame is corrupt.
+   */
+  bool read(const size_t index, frame &f) const;
+};
+
+}  // end libviconstream
+
+#endif
@@ -0,0 +1,145 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <string>
+#include <atomic>
+#include <chrono>
+
+#include "frame_source.h"
+#include "recording.h"
+
+#ifndef _VICONSTREAM_REPLAY_SOURCE_H
+#define _VICONSTREAM_REPLAY_SOURCE_H
+
+namespace libviconstream
+{
+namespace ReplayMode
+{
+  enum Enum
+  {
+    RealTime,        ///< Frames are paced as they were recorded.
+    Accelerated,     ///< Frames are paced N times faster than recorded.
+    AsFastAsPossible ///< Frames are delivered as fast as they are consumed.
+  };
+}
+
+/**
+ * @brief   Frame source replaying a recording made by @p recorder.
+ *
+ * @note    Every recorded frame is delivered with its recorded frame number,
+ *          so gaps in the recording are reported as lost frames exactly as
+ *          they were live. After a seek or loop the frame numbers are
+ *          shifted so they keep increasing without a gap at the jump.
+ *          The stream settings are ignored, frames are replayed as recorded.
+ */
+class replay_source : public frame_source
+{
+private:
+  /** @brief The recording. */
+  recording_reader _reader;
+  const std::string _path;
+
+  /** @brief Pacing. */
+  const ReplayMode::Enum _mode;
+  const double _speed;
+  const bool _loop;
+
+  /** @brief Frame rate of the recording. */
+  double _rate;
+
+  /** @brief Connection state. */
+  std::atomic< bool > _connected;
+
+  /** @brief Index of the current frame in the recording. */
+  size_t _index;
+
+  /** @brief Index of the next frame, the recording's size at the end. */
+  size_t _next;
+
+  /** @brief Offset added to recorded frame numbers after seeks. */
+  int64_t _offset;
+
+  /** @brief Last delivered (shifted) frame number. */
+  unsigned int _current;
+
+  /** @brief Host time and frame number the pacing is relative to. */
+  std::chrono::steady_clock::time_point _base_time;
+  unsigned int _base_frame;
+
+  /** @brief Seek requested from another thread, -1 if none. */
+  std::atomic< int64_t > _seek;
+
+  /** @brief Throughput statistics. */
+  std::atomic< uint64_t > _replayed;
+  std::atomic< bool > _finished;
+  std::chrono::steady_clock::time_point _start;
+
+  /** @brief Nanoseconds from connecting to the last delivered frame. */
+  std::atomic< int64_t > _elapsed;
+
+  /**
+   * @brief   Moves to a frame index, shifting frame numbers to stay
+   *          contiguous with the last delivered frame.
+   */
+  void jumpTo(const size_t index);
+
+public:
+  /**
+   * @brief   Constructor for the replay source.
+   *
+   * @param[in] path    Path of the recording.
+   * @param[in] mode    How to pace the frames.
+   * @param[in] speed   Speed up factor in Accelerated mode.
+   * @param[in] loop    Restart from the beginning at the end.
+   */
+  replay_source(const std::string &path,
+                const ReplayMode::Enum mode = ReplayMode::RealTime,
+                const double speed = 1.0, const bool loop = false);
+
+  bool connect() override;
+  void disconnect() override;
+  bool isConnected() override;
+  void configure(const stream_settings &settings) override;
+  bool getFrame() override;
+  unsigned int frameNumber() override;
+  double frameRate() override;
+  void extract(frame &f, const extraction_filter &filter) override;
+  std::string name() const override;
+
+  /**
+   * @brief   Seeks to the first frame at or after a recorded frame number,
+   *          callable from any thread.
+   *
+   * @param[in] frame_number  The recorded frame number.
+   */
+  void seek(const unsigned int frame_number);
+
+  /**
+   * @brief   Number of frames in the recording, 0 before connecting.
+   */
+  size_t frameCount() const;
+
+  /**
+   * @brief   Number of frames delivered since connecting.
+   */
+  uint64_t framesReplayed() const;
+
+  /**
+   * @brief   Average frames per second delivered since connecting. In
+   *          AsFastAsPossible mode this is the consumer's throughput.
+   */
+  double framesPerSecond() const;
+
+  /**
+   * @brief   True when the end was reached and looping is disabled.
+   */
+  bool finished() const;
+};
+
+}  // end libviconstream
+
+#endif
@@ -0,0 +1,206 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "frame.h"
+
+#ifndef _VICONSTREAM_SHM_RING_H
+#define _VICONSTREAM_SHM_RING_H
+
+namespace libviconstream
+{
+class arbiter;
+
+/*
+ * Shared memory layout: an shm_header followed by a ring of slots, each an
+ * shm_slot and its payload of slot_size bytes, 64 byte aligned. Frame n is
+ * encoded (see frame_codec.h) into slot n % slots. A slot's sequence is
+ * 2n + 1 while frame n is written and 2n + 2 once it is complete, so a
+ * reader validates a copy by reading the same even sequence before and
+ * after it. Readers sleep on the header's futex word, which the publisher
+ * bumps with every frame.
+ */
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "Shared memory needs lock free atomics.");
+
+/** @brief Magic bytes at the start of the shared memory. */
+const char shm_magic[8] = {'V', 'S', 'S', 'H', 'M', '\0', '\0', '\0'};
+
+/** @brief Version of the shared memory layout. */
+const uint32_t shm_version = 1;
+
+struct shm_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t codec_version;
+  uint32_t slots;
+  uint32_t slot_size;
+
+  /** @brief Frames published, the next one goes to published % slots. */
+  std::atomic< uint64_t > published;
+
+  /** @brief Bumped with every frame, readers wait on it. */
+  std::atomic< uint32_t > futex;
+
+  /** @brief Readers waiting on the futex, wakes are skipped if none. */
+  std::atomic< uint32_t > waiters;
+
+  /** @brief Set when the publisher closes. */
+  std::atomic< uint32_t > closed;
+};
+
+struct shm_slot
+{
+  std::atomic< uint64_t > sequence;
+  std::atomic< uint32_t > size;
+};
+
+/**
+ * @brief   Gets the size of a shared memory ring.
+ *
+ * @param[in] slots       Number of slots.
+ * @param[in] slot_size   Payload bytes per slot.
+ */
+size_t shmSize(const uint32_t slots, const uint32_t slot_size);
+
+/**
+ * @brief   Gets a slot of a mapped ring.
+ *
+ * @param[in] header  The mapped ring.
+ * @param[in] index   Index of the slot, less than the number of slots.
+ */
+shm_slot *shmSlot(shm_header *header, const uint32_t index);
+
+/**
+ * @brief   Gets the payload of a slot.
+ */
+uint8_t *shmPayload(shm_slot *slot);
+
+/**
+ * @brief   Adds the leading slash POSIX shared memory names need.
+ */
+std::string shmName(const std::string &name);
+
+/**
+ * @brief   Sleeps until a futex word in shared memory changes.
+ *
+ * @param[in] word      The futex word.
+ * @param[in] expected  Value the word had, returns at once if it differs.
+ * @param[in] timeout   Longest time to sleep.
+ */
+void shmWait(std::atomic< uint32_t > &word, const uint32_t expected,
+             const std::chrono::nanoseconds timeout);
+
+/**
+ * @brief   Wakes all processes sleeping on a futex word.
+ */
+void shmWake(std::atomic< uint32_t > &word);
+
+/**
+ * @brief   Publishes frames into a POSIX shared memory ring, so any number
+ *          of local processes can share one connection, see @p shm_source.
+ *
+ * @note    Attached to an arbiter the publisher runs as an inline
+ *          subscriber: a frame is encoded and copied into its slot on the
+ *          frame grabber thread and readers are woken at once. Readers
+ *          never block the publisher, a reader falling more than a ring
+ *          behind loses frames.
+ */
+class shm_publisher
+{
+private:
+  /** @brief Name of the shared memory object. */
+  const std::string _name;
+
+  /** @brief The mapped ring, nullptr if closed. */
+  shm_header *_header;
+  size_t _size;
+
+  /** @brief Scratch buffer for encoding a frame. */
+  std::vector< uint8_t > _scratch;
+
+  /** @brief The arbiter the publisher is attached to, if any. */
+  arbiter *_arbiter;
+  unsigned int _id;
+
+  /** @brief Statistics. */
+  std::atomic< uint64_t > _frames;
+  std::atomic< uint64_t > _oversized;
+
+public:
+  /**
+   * @brief   Constructor for the publisher, creates the shared memory.
+   *
+   * @param[in] name        Name of the shared memory object, e.g. "vicon".
+   *                        An existing object of the name is replaced.
+   * @param[in] slots       Number of frames in the ring.
+   * @param[in] slot_size   Largest encoded frame in bytes.
+   */
+  shm_publisher(const std::string &name, const uint32_t slots = 16,
+                const uint32_t slot_size = 256 << 10);
+
+  /**
+   * @brief   Destructor detaches and removes the shared memory.
+   */
+  ~shm_publisher();
+
+  shm_publisher(const shm_publisher &) = delete;
+  shm_publisher &operator=(const shm_publisher &) = delete;
+
+  /**
+   * @brief   Checks if the shared memory was created successfully.
+   */
+  bool isOpen() const;
+
+  /**
+   * @brief   Publishes every frame of an arbiter from an inline subscriber.
+   *
+   * @param[in] a   The arbiter to publish.
+   *
+   * @return  Returns false if not open or already attached.
+   */
+  bool attach(arbiter &a);
+
+  /**
+   * @brief   Stops publishing from the arbiter.
+   */
+  void detach();
+
+  /**
+   * @brief   Publishes one frame, only call from one thread at a time.
+   *
+   * @param[in] f   The frame to publish.
+   */
+  void publish(const frame &f);
+
+  /**
+   * @brief   Detaches, tells the readers and removes the shared memory.
+   *          Mapped readers keep the memory until they disconnect.
+   */
+  void close();
+
+  /**
+   * @brief   Number of frames published.
+   */
+  uint64_t framesPublished() const;
+
+  /**
+   * @brief   Number of frames skipped for not fitting in a slot.
+   */
+  uint64_t framesOversized() const;
+};
+
+}  // end libviconstream
+
+#endif
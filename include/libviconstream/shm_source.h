@@ -0,0 +1,129 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <string>
+#include <atomic>
+
+#include "frame_source.h"
+#include "latency_histogram.h"
+#include "shm_ring.h"
+
+#ifndef _VICONSTREAM_SHM_SOURCE_H
+#define _VICONSTREAM_SHM_SOURCE_H
+
+namespace libviconstream
+{
+/**
+ * @brief   Frame source reading the shared memory ring of an
+ *          @p shm_publisher in another process. Behind an arbiter it gives
+ *          the reader process the same frames, callbacks and polling as
+ *          the publishing process, without a connection of its own.
+ *
+ * @note    Frames are decoded straight from the mapping and validated by
+ *          the slot's sequence, a frame overwritten while decoding is
+ *          retried. In ServerPush mode @p getFrame returns the newest
+ *          frame, else frames are returned in order and a reader falling
+ *          more than a ring behind skips to the newest. Skipped frames show
+ *          as lost frames. When the publisher restarts the source moves to
+ *          the new ring, frame numbers are shifted to keep increasing.
+ */
+class shm_source : public frame_source
+{
+private:
+  /** @brief Name of the shared memory object. */
+  const std::string _name;
+
+  /** @brief The mapped ring, nullptr if not mapped. */
+  shm_header *_header;
+  size_t _size;
+
+  /** @brief Connection state. */
+  std::atomic< bool > _connected;
+
+  /** @brief Return the newest frame instead of the next one. */
+  bool _newest;
+
+  /** @brief Ring index of the next frame to read. */
+  uint64_t _next;
+
+  /** @brief The current frame, swapped out by @p extract. */
+  frame _current;
+
+  /** @brief Offset added to published frame numbers after a restart. */
+  int64_t _offset;
+
+  /** @brief Last delivered (shifted) frame number. */
+  unsigned int _frame_number;
+
+  /** @brief Frame rate of the stream. */
+  double _rate;
+
+  /** @brief Statistics. */
+  std::atomic< uint64_t > _overruns;
+  latency_histogram _transport;
+
+  /**
+   * @brief   Maps the ring and validates its layout.
+   *
+   * @return  Returns false if there is no compatible ring of the name.
+   */
+  bool map();
+
+  /**
+   * @brief   Unmaps the ring.
+   */
+  void unmap();
+
+  /**
+   * @brief   Decodes the frame at a ring index into @p _current.
+   *
+   * @param[in]  index        The ring index.
+   * @param[out] overwritten  Set if the slot no longer holds the frame.
+   *
+   * @return  Returns false if the frame was overwritten or is corrupt.
+   */
+  bool read(const uint64_t index, bool &overwritten);
+
+public:
+  /**
+   * @brief   Constructor for the shared memory source.
+   *
+   * @param[in] name  Name the publisher was created with.
+   */
+  shm_source(const std::string &name);
+
+  ~shm_source();
+
+  shm_source(const shm_source &) = delete;
+  shm_source &operator=(const shm_source &) = delete;
+
+  bool connect() override;
+  void disconnect() override;
+  bool isConnected() override;
+  void configure(const stream_settings &settings) override;
+  bool getFrame() override;
+  unsigned int frameNumber() override;
+  double frameRate() override;
+  void extract(frame &f, const extraction_filter &filter) override;
+  std::string name() const override;
+
+  /**
+   * @brief   Number of times the reader fell a ring behind and skipped
+   *          frames.
+   */
+  uint64_t overruns() const;
+
+  /**
+   * @brief   Time from dispatch in the publishing process to decoding in
+   *          this one, steady_clock is shared by all local processes.
+   */
+  const latency_histogram &transportLatency() const;
+};
+
+}  // end libviconstream
+
+#endif
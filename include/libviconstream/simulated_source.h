@@ -0,0 +1,169 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+#include "frame_source.h"
+
+#ifndef _VICONSTREAM_SIMULATED_SOURCE_H
+#define _VICONSTREAM_SIMULATED_SOURCE_H
+
+namespace libviconstream
+{
+/** @brief Settings of the simulated Vicon system. */
+struct simulator_settings
+{
+  /** @brief Number of subjects. */
+  unsigned int subjects;
+
+  /** @brief Number of segments per subject. */
+  unsigned int segments;
+
+  /** @brief Number of labeled markers per subject. */
+  unsigned int markers;
+
+  /** @brief Number of unlabeled markers in the volume. */
+  unsigned int unlabeled_markers;
+
+  /** @brief Number of devices, each with one output. */
+  unsigned int devices;
+
+  /** @brief Frame rate in Hz. */
+  double frame_rate;
+
+  /** @brief Server latency to report in seconds. */
+  double latency;
+
+  /** @brief Probability of a frame being lost, deterministic per frame. */
+  double drop_probability;
+
+  /** @brief Number of the first frame. */
+  unsigned int first_frame;
+
+  /** @brief Seed for the frame loss. */
+  uint64_t seed;
+
+  /** @brief Pace frames to the host clock, else as fast as requested. */
+  bool realtime;
+
+  /**
+   * @brief   Defaults to one single segment subject at 100 Hz, no loss.
+   */
+  simulator_settings();
+};
+
+/**
+ * @brief   Deterministic, synthetic Vicon system for load testing and
+ *          benchmarking without hardware.
+ *
+ * @note    Subjects move on circles with a vertical and rolling motion, the
+ *          pose of every frame is a pure function of the frame number so
+ *          the ground truth is available through @p truePose. In
+ *          ServerPush mode @p getFrame blocks until the next frame is due,
+ *          in the pull modes it returns the latest due frame immediately.
+ */
+class simulated_source : public frame_source
+{
+private:
+  /** @brief The simulation's settings. */
+  const simulator_settings _sim;
+
+  /** @brief The applied stream settings, selects what to extract. */
+  stream_settings _settings;
+
+  /** @brief Connection state. */
+  std::atomic< bool > _connected;
+
+  /** @brief Host time of the first frame. */
+  std::chrono::steady_clock::time_point _start;
+
+  /** @brief The current frame number. */
+  unsigned int _current;
+
+  /** @brief Injected frame loss, see @p injectDrop. */
+  std::atomic< unsigned int > _pending_drops;
+  unsigned int _drop_first;
+  unsigned int _drop_last;
+
+  /** @brief Precomputed names. */
+  std::vector< std::string > _subject_names;
+  std::vector< std::string > _segment_names;
+  std::vector< std::string > _marker_names;
+  std::vector< std::string > _device_names;
+
+  /**
+   * @brief   Checks if a frame is lost, randomly or by injection.
+   */
+  bool dropped(const unsigned int frame_number) const;
+
+  /**
+   * @brief   Selects @p n as the new frame, applying injected loss.
+   *
+   * @return  Returns false if the frame was dropped by injection.
+   */
+  bool advanceTo(const unsigned int n);
+
+public:
+  /**
+   * @brief   Constructor for the simulated source.
+   *
+   * @param[in] settings   The simulation's settings.
+   */
+  simulated_source(const simulator_settings &settings = simulator_settings());
+
+  bool connect() override;
+  void disconnect() override;
+  bool isConnected() override;
+  void configure(const stream_settings &settings) override;
+  bool getFrame() override;
+  unsigned int frameNumber() override;
+  double frameRate() override;
+  void extract(frame &f, const extraction_filter &filter) override;
+  std::string name() const override;
+
+  /**
+   * @brief   Loses the next @p count frames, callable from any thread.
+   *
+   * @param[in] count   Number of consecutive frames to lose.
+   */
+  void injectDrop(const unsigned int count);
+
+  /**
+   * @brief   Gets the simulation time of a frame.
+   *
+   * @param[in] frame_number  The frame number.
+   *
+   * @return  Time in seconds since the first frame.
+   */
+  double frameTime(const unsigned int frame_number) const;
+
+  /**
+   * @brief   Gets the host time at which a frame is due in realtime mode.
+   *
+   * @param[in] frame_number  The frame number.
+   */
+  std::chrono::steady_clock::time_point frameDue(
+      const unsigned int frame_number) const;
+
+  /**
+   * @brief   Gets the ground truth pose of a segment, thread safe.
+   *
+   * @param[in]  subject  Subject index.
+   * @param[in]  segment  Segment index within the subject.
+   * @param[in]  t        Simulation time in seconds, see @p frameTime.
+   * @param[out] p        The pose.
+   */
+  void truePose(const unsigned int subject, const unsigned int segment,
+                const double t, pose &p) const;
+};
+
+}  // end libviconstream
+
+#endif
@@ -0,0 +1,243 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <vector>
+#include <atomic>
+#include <functional>
+
+/* Threading includes. */
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "frame.h"
+#include "frame_source.h"
+#include "latency_histogram.h"
+
+#ifndef _VICONSTREAM_SUBSCRIBER_H
+#define _VICONSTREAM_SUBSCRIBER_H
+
+namespace libviconstream
+{
+typedef std::function< void(const frame &) > viconstream_callback;
+
+namespace DispatchMode
+{
+  enum Enum
+  {
+    Inline, ///< Called directly from the frame grabber thread.
+    Async   ///< Called from the subscriber's own worker thread.
+  };
+}
+
+/**
+ * @brief   What to do with a frame when an async subscriber's queue is full.
+ *
+ * @note    Block cannot hold while the subscriber's callback unregisters an
+ *          inline callback, e.g. through recorder::detach() or
+ *          frame_stream::close(), as that waits for the frame grabber.
+ *          Frames not fitting its queue in the meantime are dropped.
+ */
+namespace OverflowPolicy
+{
+  enum Enum
+  {
+    DropOldest, ///< Discard the oldest queued frame to make room.
+    DropNewest, ///< Discard the incoming frame.
+    Block       ///< Make the frame grabber wait for room in the queue.
+  };
+}
+
+/**
+ * @brief   What a subscriber needs from each frame.
+ *
+ * @note    The frame grabber only extracts the union of what all
+ *          subscribers need, and a subscriber is only called for frames
+ *          containing all of its subjects. Segment and marker names apply
+ *          to every subject, the root segment is always extracted.
+ */
+struct subscription
+{
+  /** @brief Names of the subjects, empty for all subjects. */
+  std::vector< std::string > subjects;
+
+  /** @brief Names of the segments, empty for all segments. */
+  std::vector< std::string > segments;
+
+  /** @brief Names of the labeled markers, empty for all markers. */
+  std::vector< std::string > markers;
+
+  /** @brief Combination of @p DataKind flags. */
+  unsigned int kinds;
+
+  /**
+   * @brief   Subscribes to everything.
+   */
+  subscription() : kinds(DataKind::All)
+  {
+  }
+
+  /**
+   * @brief   Subscribes to some data of a set of subjects.
+   *
+   * @param[in] subjects  Names of the subjects.
+   * @param[in] kinds     Combination of @p DataKind flags.
+   */
+  subscription(const std::vector< std::string > &subjects,
+               const unsigned int kinds = DataKind::GlobalPose)
+      : subjects(subjects), kinds(kinds)
+  {
+  }
+};
+
+/** @brief Statistics of a subscriber's delivery. */
+struct subscriber_stats
+{
+  /** @brief Frames currently waiting in the queue. */
+  size_t queue_depth;
+
+  /** @brief Capacity of the queue, 0 for inline subscribers. */
+  size_t queue_capacity;
+
+  /** @brief Frames delivered to the callback. */
+  uint64_t delivered;
+
+  /** @brief Frames dropped due to a full queue. */
+  uint64_t dropped;
+
+  /** @brief Time from frame reception to the start of the callback. */
+  latency_summary callback_start;
+
+  /** @brief Time spent in the callback. */
+  latency_summary callback_duration;
+};
+
+/**
+ * @brief   A registered callback with its (optional) bounded frame queue.
+ */
+class subscriber
+{
+private:
+  /** @brief Mutex for the queue. */
+  std::mutex _lock;
+
+  /** @brief Signals the worker on new data and the grabber on free room. */
+  std::condition_variable _cv_data;
+  std::condition_variable _cv_space;
+
+  /** @brief Ring buffer of queued frames. */
+  std::vector< frame_ptr > _queue;
+  size_t _head;
+  size_t _count;
+
+  /** @brief Stop selector, written under the lock, read by deliver(). */
+  std::atomic< bool > _stop;
+
+  /** @brief Makes a blocked push drop its frame instead, see giveWay(). */
+  bool _give_way;
+
+  /** @brief Statistics, readable without taking the lock. */
+  std::atomic< size_t > _depth;
+  std::atomic< uint64_t > _delivered;
+  std::atomic< uint64_t > _dropped;
+
+public:
+  /** @brief Delivery latency histograms, in nanoseconds. */
+  latency_histogram callback_start;
+  latency_histogram callback_duration;
+
+  /** @brief The user's callback. */
+  const viconstream_callback callback;
+
+  /** @brief How the callback is dispatched. */
+  const DispatchMode::Enum mode;
+
+  /** @brief What to do when the queue is full. */
+  const OverflowPolicy::Enum policy;
+
+  /** @brief What the subscriber needs. */
+  const subscription filter;
+
+  /** @brief Handles of the filter's subjects. */
+  const std::vector< subject_handle > subject_handles;
+
+  /** @brief Worker thread for asynchronous subscribers. */
+  std::thread worker;
+
+  /**
+   * @brief   Constructor for the subscriber.
+   *
+   * @param[in] cb          The user's callback.
+   * @param[in] mode        How the callback is dispatched.
+   * @param[in] queue_size  Capacity of the queue in async mode.
+   * @param[in] policy      What to do when the queue is full.
+   * @param[in] filter      What the subscriber needs.
+   * @param[in] handles     Handles of the filter's subjects.
+   */
+  subscriber(viconstream_callback cb, const DispatchMode::Enum mode,
+             const size_t queue_size, const OverflowPolicy::Enum policy,
+             const subscription &filter,
+             const std::vector< subject_handle > &handles);
+
+  /**
+   * @brief   Checks if a frame contains all of the subscriber's subjects.
+   *
+   * @param[in] f   The frame to check.
+   */
+  bool wants(const frame &f) const;
+
+  /**
+   * @brief   Queues a frame for the worker, applying the overflow policy.
+   *
+   * @param[in] f   The frame to queue.
+   *
+   * @return  Returns false if the frame was dropped.
+   */
+  bool push(const frame_ptr &f);
+
+  /**
+   * @brief   Waits for and removes the next frame from the queue.
+   *
+   * @param[out] f  The next frame.
+   *
+   * @return  Returns false if the subscriber has been stopped.
+   */
+  bool pop(frame_ptr &f);
+
+  /**
+   * @brief   Stops the worker and releases a blocked frame grabber.
+   */
+  void stop();
+
+  /**
+   * @brief   Lets pushes under @p OverflowPolicy::Block drop frames on a
+   *          full queue instead of waiting, and releases a waiting one.
+   *          Used while the worker waits for the frame grabber.
+   *
+   * @param[in] enable  True to drop instead of waiting.
+   */
+  void giveWay(const bool enable);
+
+  /**
+   * @brief   Calls the callback with a frame and records its latency,
+   *          unless the subscriber has been stopped.
+   *
+   * @param[in] f   The frame to deliver.
+   */
+  void deliver(const frame &f);
+
+  /**
+   * @brief   Gets the delivery statistics.
+   *
+   * @return  A snapshot of the statistics.
+   */
+  subscriber_stats stats() const;
+};
+
+}  // end libviconstream
+
+#endif
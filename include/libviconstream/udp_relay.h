@@ -0,0 +1,199 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+
+/* Network includes. */
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "frame.h"
+#include "pose_packet.h"
+
+#ifndef _VICONSTREAM_UDP_RELAY_H
+#define _VICONSTREAM_UDP_RELAY_H
+
+namespace libviconstream
+{
+class arbiter;
+
+/** @brief Settings of a UDP relay. */
+struct relay_settings
+{
+  /** @brief Hops multicast packets may travel, 1 keeps them on the LAN. */
+  int multicast_ttl;
+
+  /** @brief Frames between the Names packets sent to every destination. */
+  unsigned int names_interval;
+
+  /**
+   * @brief   Defaults to a TTL of 1 and names every 100 frames.
+   */
+  relay_settings();
+};
+
+/**
+ * @brief   Relays the root segment poses of every frame as compact UDP
+ *          packets (see pose_packet.h) to unicast or multicast
+ *          destinations, for consumers which cannot link the Vicon SDK.
+ *          Receive them with @p pose_receiver.
+ *
+ * @note    Subject ids are the arbiter's subject handle ids. All packets of
+ *          a frame, for all destinations, are sent with one sendmmsg() on
+ *          a non-blocking socket, a full socket buffer drops packets
+ *          instead of stalling the frame grabber.
+ */
+class udp_relay
+{
+private:
+  /** @brief A destination and its subject filter. */
+  struct destination
+  {
+    sockaddr_in address;
+
+    /** @brief Sorted subject names, empty for all subjects. */
+    std::vector< std::string > subjects;
+
+    /** @brief Relay the subject of a frame index, for the current model. */
+    std::vector< uint8_t > wanted;
+
+    /** @brief Frames until the next Names packet. */
+    unsigned int names_countdown;
+  };
+
+  const relay_settings _settings;
+
+  /** @brief The socket, -1 if closed. */
+  int _fd;
+
+  std::vector< destination > _destinations;
+
+  /** @brief The handle map the subject ids and filters were built for. */
+  std::shared_ptr< const handle_map > _handles;
+
+  /** @brief Subject id of every subject index of the current model, -1 if
+   *         it has none. */
+  std::vector< int32_t > _ids;
+
+  /** @brief Packet buffers and their destinations, reused every frame. */
+  std::vector< uint8_t > _packets;
+  std::vector< size_t > _sizes;
+  std::vector< size_t > _targets;
+  std::vector< mmsghdr > _messages;
+  std::vector< iovec > _iov;
+
+  /** @brief The arbiter the relay is attached to, if any. */
+  arbiter *_arbiter;
+  unsigned int _id;
+
+  /** @brief Statistics. */
+  std::atomic< uint64_t > _frames;
+  std::atomic< uint64_t > _sent;
+  std::atomic< uint64_t > _dropped;
+
+  /**
+   * @brief   Rebuilds the subject ids and filters for a new model.
+   */
+  void updateModel(const frame &f);
+
+  /**
+   * @brief   Gets a cleared packet buffer for a destination.
+   */
+  uint8_t *addPacket(const size_t target);
+
+  /**
+   * @brief   Appends the Names packets of a destination.
+   */
+  void addNames(const frame &f, const size_t target);
+
+  /**
+   * @brief   Appends the Poses packets of a destination.
+   */
+  void addPoses(const frame &f, const size_t target, const uint32_t age_us);
+
+  /**
+   * @brief   Sends all packets.
+   */
+  void send();
+
+public:
+  /**
+   * @brief   Constructor for the relay, opens the socket.
+   *
+   * @param[in] settings  The relay settings.
+   */
+  udp_relay(const relay_settings &settings = relay_settings());
+
+  /**
+   * @brief   Destructor detaches and closes the socket.
+   */
+  ~udp_relay();
+
+  udp_relay(const udp_relay &) = delete;
+  udp_relay &operator=(const udp_relay &) = delete;
+
+  /**
+   * @brief   Checks if the socket was opened successfully.
+   */
+  bool isOpen() const;
+
+  /**
+   * @brief   Adds a destination, only while detached.
+   *
+   * @param[in] address   IPv4 unicast or multicast address.
+   * @param[in] port      UDP port.
+   * @param[in] subjects  Names of the subjects to relay, empty for all.
+   *
+   * @return  Returns false if the address is invalid or attached.
+   */
+  bool addDestination(const std::string &address, const uint16_t port,
+                      const std::vector< std::string > &subjects =
+                          std::vector< std::string >());
+
+  /**
+   * @brief   Relays every frame of an arbiter from an inline subscriber.
+   *
+   * @param[in] a   The arbiter to relay.
+   *
+   * @return  Returns false if not open or already attached.
+   */
+  bool attach(arbiter &a);
+
+  /**
+   * @brief   Stops relaying from the arbiter.
+   */
+  void detach();
+
+  /**
+   * @brief   Relays one frame, only call from one thread at a time.
+   *
+   * @param[in] f   The frame to relay.
+   */
+  void relay(const frame &f);
+
+  /**
+   * @brief   Number of frames relayed.
+   */
+  uint64_t framesRelayed() const;
+
+  /**
+   * @brief   Number of packets sent.
+   */
+  uint64_t packetsSent() const;
+
+  /**
+   * @brief   Number of packets the socket did not accept.
+   */
+  uint64_t packetsDropped() const;
+};
+
+}  // end libviconstream
+
+#endif
@@ -0,0 +1,54 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+/* Data includes. */
+#include <string>
+
+/* Vicon include. */
+#include "Client.h"
+#include "frame_source.h"
+
+#ifndef _VICONSTREAM_VICON_SOURCE_H
+#define _VICONSTREAM_VICON_SOURCE_H
+
+namespace libviconstream
+{
+/**
+ * @brief   Frame source backed by a Vicon DataStream SDK client.
+ */
+class vicon_source : public frame_source
+{
+private:
+  /** @brief Vicon client object. */
+  Client _client;
+
+  /** @brief The vicon server's address. */
+  std::string _host_name;
+
+  /** @brief The applied settings, selects what to extract. */
+  stream_settings _settings;
+
+public:
+  /**
+   * @brief   Constructor for the Vicon source.
+   *
+   * @param[in] hostname   Address to the Vicon server.
+   */
+  vicon_source(std::string hostname);
+
+  bool connect() override;
+  void disconnect() override;
+  bool isConnected() override;
+  void configure(const stream_settings &settings) override;
+  bool getFrame() override;
+  unsigned int frameNumber() override;
+  double frameRate() override;
+  void extract(frame &f, const extraction_filter &filter) override;
+  std::string name() const override;
+};
+
+}  // end libviconstream
+
+#endif
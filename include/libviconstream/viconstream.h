@@ -6,15 +6,31 @@
 /* Data includes. */
 #include <string>
 #include <map>
+#include <vector>
+#include <memory>
 #include <functional>
+#include <atomic>
 
 /* Threading includes. */
+#include <chrono>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 
 /* Vicon include. */
 #include "Client.h"
+#include "frame.h"
+#include "frame_source.h"
+#include "subscriber.h"
+#include "latest_buffer.h"
+#include "name_table.h"
+#include "pose_math.h"
+#include "pose_history.h"
+#include "motion_estimator.h"
+#include "frame_counters.h"
+#include "arrival_tracker.h"
+#include "async_log.h"
+#include "realtime.h"
 
 #ifndef _VICONSTREAM_H
 #define _VICONSTREAM_H
@@ -23,57 +39,330 @@ using namespace ViconDataStreamSDK::CPP;
 
 namespace libviconstream
 {
-typedef std::function< void(const Client &) > viconstream_callback;
+/** @brief Latency of each stage of frame delivery. */
+struct latency_stats
+{
+  /** @brief Latency reported by the Vicon server. */
+  latency_summary server;
+
+  /** @brief Time from reception to the start of dispatch. */
+  latency_summary extraction;
+
+  /** @brief Time from reception to callback start, all callbacks. */
+  latency_summary callback_start;
+
+  /** @brief Time spent in callbacks, all callbacks. */
+  latency_summary callback_duration;
+};
+
+namespace GrabWait
+{
+  enum Enum
+  {
+    FixedSleep, ///< Sleep 1 ms when no new frame is available.
+    Blocking,   ///< Rely on GetFrame() blocking until the next frame.
+    Adaptive    ///< Sleep until shortly before the next expected frame.
+  };
+}
+
+namespace ConnectionState
+{
+  enum Enum
+  {
+    Disconnected, ///< The stream is disabled.
+    Connecting,   ///< First connection attempts of an enable.
+    Connected,    ///< Connected, configured and grabbing frames.
+    Reconnecting, ///< The connection was lost, retrying with backoff.
+    Failed        ///< The first connection attempts were used up.
+  };
+}
+
+/** @brief Called by the connection manager on every state change. */
+typedef std::function< void(const ConnectionState::Enum) >
+    connection_callback;
+
+/** @brief Settings of the connection manager. */
+struct connection_settings
+{
+  /** @brief Attempts of the first connection before giving up, 0 to retry
+   *         forever. A lost connection is always retried. */
+  unsigned int connect_attempts;
+
+  /** @brief Wait after the first failed attempt, doubled after every
+   *         further failure up to @p max_backoff. */
+  std::chrono::milliseconds initial_backoff;
+  std::chrono::milliseconds max_backoff;
+
+  /** @brief Time without a new frame after which a connection is treated
+   *         as lost, 0 to only rely on the source's connection state. */
+  std::chrono::milliseconds stall_timeout;
+
+  /**
+   * @brief   Defaults to 3 attempts, backoff from 500 ms to 8 s and no
+   *          stall timeout.
+   */
+  connection_settings();
+};
 
 class arbiter
 {
 private:
-  /** @brief Mutex for the ID counter and the callback list. */
+  /** @brief Immutable snapshot of the registered callbacks. */
+  struct registry
+  {
+    /** @brief The registered callbacks by ID. */
+    std::map< unsigned int, std::shared_ptr< subscriber > > callbacks;
+
+    /** @brief Union of the subscriptions. */
+    extraction_filter filter;
+
+    /** @brief The pose history, kept alive for readers of this registry. */
+    std::shared_ptr< pose_history > history;
+  };
+
+  /** @brief Mutex serializing the ID counter and changes of the registry. */
   std::mutex _id_cblock;
 
   /** @brief ID counter for the removal of subscriptions. */
   unsigned int _id;
 
-  /** @brief Vector holding the registered callbacks. */
-  std::map< unsigned int, viconstream_callback > callbacks;
+  /**
+   * @brief   The registered callbacks, copied and swapped atomically on
+   *          every change so the frame grabber reads it without locking.
+   */
+  std::shared_ptr< const registry > _registry;
 
-  /** @brief Vicon client object. */
-  Client _vicon_client;
+  /** @brief Incremented after each swap of the registry. */
+  std::atomic< uint64_t > _registry_version;
 
-  /** @brief The vicon server's address. */
-  std::string _host_name;
+  /** @brief Odd while the frame grabber extracts and dispatches a frame. */
+  std::atomic< uint64_t > _dispatch_seq;
 
-  /** @brief Time since the arbiter object was created. */
-  std::chrono::high_resolution_clock::time_point _tp_start;
+  /** @brief ID of the frame grabber thread, while it runs. */
+  std::atomic< std::thread::id > _grabber_id;
 
-  /** @brief Reference to the output stream for logging. */
-  std::ostream &_log;
+  /** @brief The source of frames, normally a Vicon client. */
+  std::unique_ptr< frame_source > _source;
 
-  /** @brief Mutex for accessing the log. */
-  std::mutex _log_lock;
+  /** @brief The vicon server's address. */
+  std::string _host_name;
+
+  /** @brief The log, written to the output stream by its own thread. */
+  async_log _log;
 
   /** @brief Thread object for the frame grabber. */
   std::thread _frame_grabber;
 
   /** @brief Shutdown selector for the frame grabber and callback worksers. */
-  volatile bool _shutdown;
+  std::atomic< bool > _shutdown;
+
+  /** @brief The connection manager's thread, it owns the source while the
+   *         frame grabber is not running. Replaced under
+   *         @p _connection_lock. */
+  std::thread _connection;
+  connection_settings _connection_settings;
+
+  /** @brief ID of the last connection manager thread. */
+  std::atomic< std::thread::id > _connection_id;
+
+  /** @brief Protects the state, the grabber's exit flag and the state
+   *         callbacks, the condition wakes the manager and waiters. */
+  std::mutex _connection_lock;
+  std::condition_variable _connection_cv;
+  std::atomic< ConnectionState::Enum > _state;
+  bool _grabber_exited;
+  std::map< unsigned int, connection_callback > _state_callbacks;
+  unsigned int _state_id;
+
+  /** @brief Connections re-established after a loss. */
+  std::atomic< uint64_t > _reconnects;
+
+  /** @brief The settings applied after every (re)connection. */
+  stream_settings _stream_settings;
+
+  /** @brief How the frame grabber waits for the next frame. */
+  GrabWait::Enum _grab_wait;
+
+  /** @brief Scheduling of the frame grabber and the async dispatchers. */
+  realtime_settings _realtime;
+
+  /** @brief Frames owned by the frame grabber, reused when not retained. */
+  std::vector< std::shared_ptr< frame > > _frame_pool;
+
+  /** @brief The latest frame, for polling readers. */
+  latest_buffer< frame_ptr > _latest;
+
+  /** @brief The most recent frames, newest first, for pose prediction. */
+  struct recent_frames
+  {
+    /** @brief Frames kept, more than the three samples fitted as merged
+     *         streams repeat a subject's sample until its source delivers. */
+    static const unsigned int depth = 12;
+
+    frame_ptr frames[depth];
+  };
+
+  latest_buffer< recent_frames > _recent;
+
+  /** @brief Time indexed root poses, only while enabled. Changed under
+   *         @p _id_cblock and read through the registry. */
+  std::shared_ptr< pose_history > _history;
+
+  /** @brief Velocity estimation of the subjects, run by the frame grabber. */
+  motion_estimator _motion;
+
+  /** @brief Latency histograms of the frame grabber's stages. */
+  latency_histogram _server_latency;
+  latency_histogram _extraction_latency;
+
+  /** @brief Delivered and lost frame counters of the frame grabber. */
+  frame_counters _frame_counters;
+
+  /** @brief Frame intervals and rate of the frame grabber. */
+  arrival_tracker _arrivals;
+
+  /** @brief Interned names, and the handle mapping of the current model. */
+  name_table _names;
+  std::shared_ptr< const handle_map > _handles;
+  uint32_t _handles_generation;
+
+  /** @brief Names of the current model, to detect model changes. */
+  std::vector< std::string > _model_subjects;
+  std::vector< std::string > _model_segments;
+  std::vector< std::string > _model_markers;
 
   /**
-   * @brief   Logs a string to the log output stream.
+   * @brief   Sets the handle mapping of a frame, rebuilt only when the
+   *          subject model changed or new names were interned.
    *
-   * @param[in] log   The string to be logged.
+   * @param[in/out] f   The extracted frame.
    */
-  void logString(const std::string &log);
+  void updateHandles(frame &f);
 
   /**
-   * @brief   The frame grabber's worker function.
+   * @brief   Computes the union of the subscriptions and swaps in a new
+   *          registry, must be called with @p _id_cblock held.
+   *
+   * @param[in] reg   The new registry.
+   */
+  void publishRegistry(std::shared_ptr< registry > reg);
+
+  /**
+   * @brief   Waits for the frame grabber to finish the frame it is
+   *          dispatching, after which it only sees the current registry.
+   */
+  void waitForDispatch();
+
+  /**
+   * @brief   Gets a frame from the pool which no subscriber retains, or
+   *          allocates a new one if all are in use.
+   *
+   * @return  A cleared frame owned by the frame grabber.
+   */
+  std::shared_ptr< frame > acquireFrame();
+
+  /**
+   * @brief   Logs a string to the log output stream, without blocking.
+   *
+   * @param[in] log     The string to be logged.
+   * @param[in] level   Severity of the string.
+   */
+  void logString(const char *log,
+                 const LogLevel::Enum level = LogLevel::Info);
+  void logString(const std::string &log,
+                 const LogLevel::Enum level = LogLevel::Info);
+
+  /**
+   * @brief   The frame grabber's worker function, returns when the
+   *          connection is lost or on shutdown.
    */
   void frameGrabberWorker();
 
   /**
-   * @brief   The callback sender's worker function.
+   * @brief   The connection manager's worker function. Connects with
+   *          backoff, applies the stream settings, runs the frame grabber
+   *          until the connection is lost and starts over.
+   */
+  void connectionWorker();
+
+  /**
+   * @brief   Connects, applies the stream settings and waits for the first
+   *          frames, from the connection manager.
+   *
+   * @return  Returns false if any step failed, disconnected again.
+   */
+  bool establishConnection();
+
+  /**
+   * @brief   Sets the connection state and notifies the state callbacks.
+   *
+   * @param[in] state   The new state.
+   */
+  void setState(const ConnectionState::Enum state);
+
+  /**
+   * @brief   Waits on the connection condition, woken early by shutdown.
+   *
+   * @param[in] time  Longest time to wait.
+   *
+   * @return  Returns false if woken by shutdown.
    */
-  void callbackWorker();
+  bool connectionSleep(const std::chrono::milliseconds time);
+
+  /**
+   * @brief   Joins the connection manager's thread if any, or detaches it
+   *          when called from that thread.
+   */
+  void reapConnection();
+
+  /**
+   * @brief   Stores and logs the stream settings and starts the connection
+   *          manager, common part of the enables.
+   *
+   * @return  Returns false if the stream is already enabled.
+   */
+  bool startStream(const bool enableSegmentData, const bool enableMarkerData,
+                   const bool enableUnlabeledMarkerData,
+                   const bool enableDeviceData,
+                   const StreamMode::Enum streamMode,
+                   const GrabWait::Enum grabWait);
+
+  /**
+   * @brief   Waits before polling for a new frame again, according to the
+   *          selected @p GrabWait mode.
+   *
+   * @param[in] last_frame  Host time when the last new frame arrived.
+   * @param[in] period      The expected frame period in seconds, 0 if
+   *                        unknown.
+   * @param[in] success     True if the last GetFrame() succeeded.
+   * @param[in] realtime    True if the frame grabber is real-time scheduled.
+   */
+  void waitForFrame(
+      const std::chrono::steady_clock::time_point &last_frame,
+      const double period, const bool success, const bool realtime);
+
+  /**
+   * @brief   Applies thread settings to the calling thread, logging what
+   *          could not be applied.
+   *
+   * @param[in] settings  The settings to apply.
+   * @param[in] thread    Name of the thread, for the log.
+   */
+  void applyRealtime(const thread_settings &settings, const char *thread);
+
+  /**
+   * @brief   The callback sender's worker function for async subscribers.
+   *
+   * @param[in] sub   The subscriber to serve.
+   */
+  void callbackWorker(std::shared_ptr< subscriber > sub);
+
+  /**
+   * @brief   Stops a subscriber's worker thread, if any.
+   *
+   * @param[in] sub   The subscriber to stop.
+   */
+  void stopSubscriber(const std::shared_ptr< subscriber > &sub);
 
 public:
   /**
@@ -81,8 +370,20 @@ public:
    *
    * @param[in] hostname   Address to the Vicon server.
    * @param[in] log_output Reference to the log output stream.
+   * @param[in] log        Severity, rate limit and buffering of the log.
+   */
+  arbiter(std::string hostname, std::ostream &log_output,
+          const log_settings &log = log_settings());
+
+  /**
+   * @brief   Constructor for the arbiter with a custom frame source.
+   *
+   * @param[in] source     The source of frames, e.g. a simulated_source.
+   * @param[in] log_output Reference to the log output stream.
+   * @param[in] log        Severity, rate limit and buffering of the log.
    */
-  arbiter(std::string hostname, std::ostream &log_output);
+  arbiter(std::unique_ptr< frame_source > source, std::ostream &log_output,
+          const log_settings &log = log_settings());
 
   /**
    * @brief   Destructor handles the graceful exit of the arbiter.
@@ -90,12 +391,18 @@ public:
   ~arbiter();
 
   /**
-   * @brief   Enables the Vicon stream and starts receiving data.
+   * @brief   Enables the Vicon stream and starts receiving data, blocks
+   *          until connected or the first connection attempts failed.
+   *
+   * @note    Once connected, a lost connection is re-established in the
+   *          background with the same settings, see @p connectionState.
    *
    * @param[in] enableSegmentData         Request segment data.
    * @param[in] enableMarkerData          Request marker data.
    * @param[in] enableUnlabeledMarkerData Request unlabeled marker data.
    * @param[in] enableDeviceData          Request device data.
+   * @param[in] streamMode                The SDK's stream mode.
+   * @param[in] grabWait                  How to wait for new frames.
    *
    * @return  Returns true if the stream was started correctly.
    */
@@ -103,31 +410,417 @@ public:
                     const bool enableMarkerData          = false,
                     const bool enableUnlabeledMarkerData = false,
                     const bool enableDeviceData          = false,
-                    const StreamMode::Enum streamMode = StreamMode::ServerPush);
+                    const StreamMode::Enum streamMode = StreamMode::ServerPush,
+                    const GrabWait::Enum grabWait     = GrabWait::Adaptive);
+
+  /**
+   * @brief   Enables the Vicon stream without waiting for the connection,
+   *          which the connection manager establishes in the background.
+   *
+   * @note    If the first connection attempts fail the state becomes
+   *          Failed and the stream is disabled, it may be enabled again.
+   *
+   * @param[in] enableSegmentData         Request segment data.
+   * @param[in] enableMarkerData          Request marker data.
+   * @param[in] enableUnlabeledMarkerData Request unlabeled marker data.
+   * @param[in] enableDeviceData          Request device data.
+   * @param[in] streamMode                The SDK's stream mode.
+   * @param[in] grabWait                  How to wait for new frames.
+   *
+   * @return  Returns false if the stream is already enabled.
+   */
+  bool enableStreamAsync(
+      const bool enableSegmentData         = true,
+      const bool enableMarkerData          = false,
+      const bool enableUnlabeledMarkerData = false,
+      const bool enableDeviceData          = false,
+      const StreamMode::Enum streamMode    = StreamMode::ServerPush,
+      const GrabWait::Enum grabWait        = GrabWait::Adaptive);
 
   /**
    * @brief   Disabled the vicon stream.
    */
   void disableStream();
 
+  /**
+   * @brief   Configure the connection attempts and backoff. Only while the
+   *          stream is disabled.
+   *
+   * @param[in] settings  The connection settings.
+   *
+   * @return  Return false if the stream is enabled.
+   */
+  bool setConnectionSettings(const connection_settings &settings);
+
+  /**
+   * @brief   Configure CPU affinity, real-time priority, stack prefaulting
+   *          and memory locking of the frame grabber and async dispatch
+   *          threads. Only while the stream is disabled.
+   *
+   * @note    Applied when the threads start, async subscribers registered
+   *          before this keep their scheduling. Settings which need
+   *          privileges the process lacks are logged and skipped.
+   *
+   * @param[in] settings  The thread settings.
+   *
+   * @return  Return false if the stream is enabled.
+   */
+  bool setRealtimeSettings(const realtime_settings &settings);
+
+  /**
+   * @brief   Gets the state of the connection manager.
+   */
+  ConnectionState::Enum connectionState() const;
+
+  /**
+   * @brief   Register a callback for changes of the connection state.
+   *
+   * @note    Called from the connection manager's thread, never from the
+   *          frame grabber, so it may block briefly or call back into the
+   *          arbiter, except for @p disableStream. Disconnected is notified
+   *          from @p disableStream.
+   *
+   * @param[in] callback  Function called with the new state.
+   *
+   * @return  The ID of the callback, for removal.
+   */
+  unsigned int registerConnectionCallback(connection_callback callback);
+
+  /**
+   * @brief   Unregister a connection state callback.
+   *
+   * @note    A notification already in progress may still reach it.
+   *
+   * @param[in] id  The ID of the callback.
+   *
+   * @return  Return true if the callback was removed.
+   */
+  bool unregisterConnectionCallback(const unsigned int id);
+
+  /**
+   * @brief   Number of connections re-established after a loss.
+   */
+  uint64_t reconnects() const;
+
   /**
    * @brief   Register a callback for data received.
    *
-   * @param[in] callback  The function to register.
-   * @note    Shall be of the form void(const Output_GetFrame).
+   * @param[in] callback    The function to register.
+   * @param[in] mode        Call from the frame grabber (Inline) or from a
+   *                        dedicated worker thread (Async).
+   * @param[in] queue_size  Number of frames to buffer in Async mode.
+   * @param[in] policy      What to do when the Async queue is full.
+   * @note    Shall be of the form void(const frame &). The frame is only
+   *          valid during the call, use shared_from_this() to retain it.
+   *          Callbacks may register and unregister callbacks, including
+   *          themselves, and registration never stalls the frame grabber.
    *
    * @return  Return the ID of the callback, is used for unregistration.
    */
-  unsigned int registerCallback(viconstream_callback callback);
+  unsigned int registerCallback(
+      viconstream_callback callback,
+      const DispatchMode::Enum mode     = DispatchMode::Inline,
+      const size_t queue_size           = 16,
+      const OverflowPolicy::Enum policy = OverflowPolicy::DropOldest);
+
+  /**
+   * @brief   Register a callback for a subset of the data.
+   *
+   * @note    Only the union of all subscriptions is extracted from the
+   *          stream, and the callback is only called for frames which
+   *          contain all of its subjects. The frame may contain more than
+   *          subscribed to, due to other subscriptions.
+   *
+   * @param[in] filter      The subjects and kinds of data needed.
+   * @param[in] callback    The function to register.
+   * @param[in] mode        Call from the frame grabber (Inline) or from a
+   *                        dedicated worker thread (Async).
+   * @param[in] queue_size  Number of frames to buffer in Async mode.
+   * @param[in] policy      What to do when the Async queue is full.
+   *
+   * @return  Return the ID of the callback, is used for unregistration.
+   */
+  unsigned int registerCallback(
+      const subscription &filter, viconstream_callback callback,
+      const DispatchMode::Enum mode     = DispatchMode::Inline,
+      const size_t queue_size           = 16,
+      const OverflowPolicy::Enum policy = OverflowPolicy::DropOldest);
 
   /**
    * @brief   Unregister a callback from the queue.
    *
+   * @note    The callback is not called after this returns, an ongoing call
+   *          from another thread is waited for. Safe to call from within
+   *          the callback itself.
+   *
    * @param[in] id  The ID supplied from @p registerCallback.
    *
    * @return  Return true if the ID was deleted.
    */
   bool unregisterCallback(const unsigned int id);
+
+  /**
+   * @brief   Get the delivery statistics of a callback.
+   *
+   * @param[in]  id     The ID supplied from @p registerCallback.
+   * @param[out] stats  Queue depth and delivered/dropped frame counts.
+   *
+   * @return  Return true if the ID was found.
+   */
+  bool callbackStats(const unsigned int id, subscriber_stats &stats);
+
+  /**
+   * @brief   Get the latency distribution of each stage of frame delivery,
+   *          since the stream was enabled or the last reset.
+   *
+   * @param[out] stats  Percentiles of each stage in seconds.
+   */
+  void latencyStats(latency_stats &stats);
+
+  /**
+   * @brief   Reset all latency histograms, starts a new measurement window.
+   */
+  void resetLatencyStats();
+
+  /**
+   * @brief   Get the frame delivery and loss statistics, since the arbiter
+   *          was created or the last reset.
+   *
+   * @note    Non-advancing fetches are duplicates in ServerPush mode, in
+   *          the pull modes they also count polls between frames.
+   *
+   * @param[out] stats  Frame, loss and gap counters.
+   */
+  void frameStats(frame_stats &stats);
+
+  /**
+   * @brief   Reset the frame counters, starts a new measurement window.
+   */
+  void resetFrameStats();
+
+  /**
+   * @brief   Get the frame arrival timing on the host, since the arbiter
+   *          was created, the last rate change or the last reset.
+   *
+   * @note    The jitter is the intervals' deviation from the frame period,
+   *          so it includes the network and the host, not only the server.
+   *
+   * @param[out] stats  Rates, interval statistics and rate changes.
+   */
+  void arrivalStats(arrival_stats &stats);
+
+  /**
+   * @brief   Reset the arrival statistics with the next frame.
+   */
+  void resetArrivalStats();
+
+  /**
+   * @brief   Get the latest frame without registering a callback.
+   *
+   * @note    Never blocks and is safe to call from any thread. With only
+   *          filtered callbacks registered, the frame only contains what
+   *          they subscribe to.
+   *
+   * @return  The latest frame, or nullptr if no frame has been received.
+   */
+  frame_ptr latestFrame();
+
+  /**
+   * @brief   Get the latest pose of a subject's root segment.
+   *
+   * @note    Never blocks and is safe to call from any thread.
+   *
+   * @param[in]  subject  Name of the subject.
+   * @param[out] p        The subject's pose.
+   *
+   * @return  Return true if the subject was in the latest frame.
+   */
+  bool latestPose(const std::string &subject, pose &p);
+
+  /**
+   * @brief   Get the latest pose of a segment.
+   *
+   * @note    Never blocks and is safe to call from any thread.
+   *
+   * @param[in]  subject  Name of the subject.
+   * @param[in]  segment  Name of the segment.
+   * @param[out] p        The segment's pose.
+   *
+   * @return  Return true if the segment was in the latest frame.
+   */
+  bool latestPose(const std::string &subject, const std::string &segment,
+                  pose &p);
+
+  /**
+   * @brief   Get the handle of a subject, for lookups without strings.
+   *
+   * @note    Resolve handles once, not on every frame. A handle stays valid
+   *          if the subject leaves and returns to the stream.
+   *
+   * @param[in] subject   Name of the subject.
+   *
+   * @return  The subject's handle.
+   */
+  subject_handle subjectHandle(const std::string &subject);
+
+  /**
+   * @brief   Get the handle of a segment, for lookups without strings.
+   *
+   * @param[in] subject   Name of the subject.
+   * @param[in] segment   Name of the segment.
+   *
+   * @return  The segment's handle.
+   */
+  segment_handle segmentHandle(const std::string &subject,
+                               const std::string &segment);
+
+  /**
+   * @brief   Get the handle of a labeled marker, for lookups without strings.
+   *
+   * @param[in] subject   Name of the subject.
+   * @param[in] marker    Name of the marker.
+   *
+   * @return  The marker's handle.
+   */
+  marker_handle markerHandle(const std::string &subject,
+                             const std::string &marker);
+
+  /**
+   * @brief   Get the latest pose of a subject's root segment by handle.
+   *
+   * @note    Never blocks and is safe to call from any thread.
+   *
+   * @param[in]  subject  Handle of the subject.
+   * @param[out] p        The subject's pose.
+   *
+   * @return  Return true if the subject was in the latest frame.
+   */
+  bool latestPose(const subject_handle subject, pose &p);
+
+  /**
+   * @brief   Get the latest pose of a segment by handle.
+   *
+   * @note    Never blocks and is safe to call from any thread.
+   *
+   * @param[in]  segment  Handle of the segment.
+   * @param[out] p        The segment's pose.
+   *
+   * @return  Return true if the segment was in the latest frame.
+   */
+  bool latestPose(const segment_handle segment, pose &p);
+
+  /**
+   * @brief   Predict the pose of a subject's root segment at a host time.
+   *
+   * @note    Extrapolates from the subject's most recent distinct samples,
+   *          spaced by its own source's frame numbers and skipping samples
+   *          repeated by merged streams. Capture times are estimated as
+   *          reception time minus the source's reported latency, so
+   *          predicting for "now" compensates the latency of the Vicon
+   *          system. Never blocks and is safe to call from any thread.
+   *
+   * @param[in]  subject  Handle of the subject.
+   * @param[in]  t        Host time to predict the pose for.
+   * @param[out] p        The predicted pose.
+   * @param[in]  model    The motion model.
+   *
+   * @return  Return true if the subject was visible in the latest frame.
+   */
+  bool predictPose(
+      const subject_handle subject,
+      const std::chrono::steady_clock::time_point &t, pose &p,
+      const Prediction::Enum model = Prediction::ConstantVelocity);
+
+  /**
+   * @brief   Predict the pose of a segment at a host time.
+   *
+   * @param[in]  segment  Handle of the segment.
+   * @param[in]  t        Host time to predict the pose for.
+   * @param[out] p        The predicted pose.
+   * @param[in]  model    The motion model.
+   *
+   * @return  Return true if the segment was visible in the latest frame.
+   */
+  bool predictPose(
+      const segment_handle segment,
+      const std::chrono::steady_clock::time_point &t, pose &p,
+      const Prediction::Enum model = Prediction::ConstantVelocity);
+
+  /**
+   * @brief   Predict the pose of a subject's root segment at a host time.
+   *
+   * @note    Resolves the name on every call, prefer the handle version
+   *          when predicting at high rates.
+   *
+   * @param[in]  subject  Name of the subject.
+   * @param[in]  t        Host time to predict the pose for.
+   * @param[out] p        The predicted pose.
+   * @param[in]  model    The motion model.
+   *
+   * @return  Return true if the subject was visible in the latest frame.
+   */
+  bool predictPose(
+      const std::string &subject,
+      const std::chrono::steady_clock::time_point &t, pose &p,
+      const Prediction::Enum model = Prediction::ConstantVelocity);
+
+  /**
+   * @brief   Configure the velocity and acceleration estimates in
+   *          @p frame::motion. Only while the stream is disabled.
+   *
+   * @param[in] settings  Smoothing and gap settings.
+   *
+   * @return  Return false if the stream is enabled.
+   */
+  bool setMotionSettings(const motion_settings &settings);
+
+  /**
+   * @brief   Keep a time indexed history of the root pose of every subject,
+   *          for @p poseAt. Only while the stream is disabled.
+   *
+   * @note    All memory is allocated here. While enabled, global poses of
+   *          all subjects are extracted regardless of the subscriptions.
+   *
+   * @param[in] settings  Number of subjects and samples per subject.
+   *
+   * @return  Return false if the stream is enabled.
+   */
+  bool enablePoseHistory(const history_settings &settings = history_settings());
+
+  /**
+   * @brief   Get the pose of a subject's root segment at a host time,
+   *          interpolated from the history.
+   *
+   * @note    Never blocks and is safe to call from any thread. Times are
+   *          the frames' estimated capture times, reception time minus the
+   *          server's reported latency.
+   *
+   * @param[in]  subject  Handle of the subject.
+   * @param[in]  t        Host time to look up.
+   * @param[out] p        The interpolated pose.
+   * @param[in]  mode     How the orientation is interpolated.
+   *
+   * @return  Return true if @p t is covered by visible samples.
+   */
+  bool poseAt(const subject_handle subject,
+              const std::chrono::steady_clock::time_point &t, pose &p,
+              const Interpolation::Enum mode = Interpolation::Slerp);
+
+  /**
+   * @brief   Get the pose of a subject's root segment at a host time.
+   *
+   * @note    Resolves the name under a lock, prefer the handle version.
+   *
+   * @param[in]  subject  Name of the subject.
+   * @param[in]  t        Host time to look up.
+   * @param[out] p        The interpolated pose.
+   * @param[in]  mode     How the orientation is interpolated.
+   *
+   * @return  Return true if @p t is covered by visible samples.
+   */
+  bool poseAt(const std::string &subject,
+              const std::chrono::steady_clock::time_point &t, pose &p,
+              const Interpolation::Enum mode = Interpolation::Slerp);
 };
 
 }  // end libviconstream
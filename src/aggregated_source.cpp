@@ -0,0 +1,379 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cmath>
+#include <limits>
+#include "libviconstream/aggregated_source.h"
+
+namespace libviconstream
+{
+namespace
+{
+/* Frames kept per source for timestamp matching. */
+const size_t match_depth = 16;
+
+std::string qualify(const std::string &ns, const std::string &name)
+{
+  return ns.empty() ? name : ns + "/" + name;
+}
+}
+
+aggregation_settings::aggregation_settings()
+    : alignment(Alignment::LatestOfEach), tolerance(0.002), max_age(0.1)
+{
+}
+
+/*********************************
+ * Private members
+ ********************************/
+
+std::chrono::steady_clock::time_point aggregated_source::captureTime(
+    const frame &f)
+{
+  return f.latency.received -
+         std::chrono::duration_cast< std::chrono::steady_clock::duration >(
+             std::chrono::duration< double >(f.latency.server_total));
+}
+
+bool aggregated_source::match(const size_t source)
+{
+  const auto t = captureTime(*_inputs[source].frames.back());
+  std::vector< size_t > picks(_inputs.size());
+
+  /* The closest frame of every other source must be within tolerance. */
+  for (size_t i = 0; i < _inputs.size(); i++)
+  {
+    if (i == source)
+    {
+      picks[i] = _inputs[i].frames.size() - 1;
+      continue;
+    }
+
+    const std::deque< frame_ptr > &frames = _inputs[i].frames;
+    double best = std::numeric_limits< double >::infinity();
+
+    for (size_t j = 0; j < frames.size(); j++)
+    {
+      const double dt = std::abs(
+          std::chrono::duration< double >(captureTime(*frames[j]) - t)
+              .count());
+
+      if (dt < best)
+      {
+        best     = dt;
+        picks[i] = j;
+      }
+    }
+
+    if (best > _settings.tolerance)
+      return false;
+  }
+
+  /* Matched frames, and everything older, are never matched again. */
+  for (size_t i = 0; i < _inputs.size(); i++)
+  {
+    std::deque< frame_ptr > &frames = _inputs[i].frames;
+
+    _ready[i] = frames[picks[i]];
+    frames.erase(frames.begin(), frames.begin() + picks[i] + 1);
+  }
+
+  return true;
+}
+
+void aggregated_source::append(frame &f, input &in, const frame &part,
+                               const extraction_filter &filter)
+{
+  /* Qualified names are only rebuilt when the source's model changes. */
+  if (in.raw_names != part.subject_names)
+  {
+    in.raw_names = part.subject_names;
+    in.names.clear();
+
+    for (auto &n : in.raw_names)
+      in.names.push_back(qualify(in.ns, n));
+  }
+
+  const bool segments = filter.wants(DataKind::GlobalPose) ||
+                        filter.wants(DataKind::LocalPose);
+  const bool markers = filter.wants(DataKind::Markers);
+
+  for (size_t s = 0; s < part.subjects.size(); s++)
+  {
+    if (!filter.wantsSubject(in.names[s]))
+      continue;
+
+    const subject_data &src = part.subjects[s];
+    const uint32_t sidx     = static_cast< uint32_t >(f.subjects.size());
+
+    /* The sample keeps the timing of its source, it repeats in merges
+       triggered by the other sources. */
+    subject_data sd;
+    sd.first_segment = static_cast< uint32_t >(f.segments.size());
+    sd.root_segment  = sd.first_segment;
+    sd.first_marker  = static_cast< uint32_t >(f.markers.size());
+    sd.source_frame  = src.source_frame;
+    sd.source_rate   = src.source_rate;
+    sd.source_delay =
+        src.source_delay +
+        std::chrono::duration< double >(_current_received -
+                                        part.latency.received)
+            .count();
+
+    for (uint32_t i = 0; segments && i < src.segment_count; i++)
+    {
+      const uint32_t j = src.first_segment + i;
+
+      if (j == src.root_segment)
+        sd.root_segment = static_cast< uint32_t >(f.segments.size());
+      else if (!filter.wantsSegment(part.segment_names[j]))
+        continue;
+
+      segment_data sg = part.segments[j];
+      sg.subject      = sidx;
+
+      f.segments.push_back(sg);
+      f.segment_names.push_back(part.segment_names[j]);
+    }
+
+    for (uint32_t i = 0; markers && i < src.marker_count; i++)
+    {
+      const uint32_t j = src.first_marker + i;
+
+      if (!filter.wantsMarker(part.marker_names[j]))
+        continue;
+
+      marker_data md = part.markers[j];
+      md.subject     = sidx;
+
+      f.markers.push_back(md);
+      f.marker_names.push_back(part.marker_names[j]);
+    }
+
+    sd.segment_count =
+        static_cast< uint32_t >(f.segments.size()) - sd.first_segment;
+    sd.marker_count =
+        static_cast< uint32_t >(f.markers.size()) - sd.first_marker;
+
+    f.subjects.push_back(sd);
+    f.subject_names.push_back(in.names[s]);
+  }
+
+  if (filter.wants(DataKind::UnlabeledMarkers))
+    f.unlabeled_markers.insert(f.unlabeled_markers.end(),
+                               part.unlabeled_markers.begin(),
+                               part.unlabeled_markers.end());
+
+  if (filter.wants(DataKind::Devices))
+  {
+    const uint32_t device_offset = static_cast< uint32_t >(f.devices.size());
+    const uint32_t output_offset =
+        static_cast< uint32_t >(f.device_outputs.size());
+
+    for (size_t i = 0; i < part.devices.size(); i++)
+    {
+      device_data dd = part.devices[i];
+      dd.first_output += output_offset;
+
+      f.devices.push_back(dd);
+      f.device_names.push_back(qualify(in.ns, part.device_names[i]));
+    }
+
+    for (size_t i = 0; i < part.device_outputs.size(); i++)
+    {
+      device_output_data od = part.device_outputs[i];
+      od.device += device_offset;
+
+      f.device_outputs.push_back(od);
+      f.device_output_names.push_back(part.device_output_names[i]);
+    }
+  }
+
+  for (size_t i = 0; i < part.latency_samples.size(); i++)
+  {
+    f.latency_samples.push_back(part.latency_samples[i]);
+    f.latency_sample_names.push_back(
+        qualify(in.ns, part.latency_sample_names[i]));
+  }
+}
+
+/*********************************
+ * Public members
+ ********************************/
+
+aggregated_source::aggregated_source(const aggregation_settings &settings)
+    : _settings(settings),
+      _fresh(false),
+      _current_number(0),
+      _connected(false)
+{
+}
+
+size_t aggregated_source::addInput(const std::string &ns)
+{
+  std::lock_guard< std::mutex > locker(_lock);
+
+  input in;
+  in.ns         = ns;
+  in.frame_rate = 0;
+
+  _inputs.push_back(in);
+  _ready.resize(_inputs.size());
+
+  return _inputs.size() - 1;
+}
+
+void aggregated_source::push(const size_t source, const frame_ptr &f)
+{
+  std::lock_guard< std::mutex > locker(_lock);
+
+  input &in     = _inputs[source];
+  in.frame_rate = f->frame_rate;
+  in.frames.push_back(f);
+
+  if (_settings.alignment == Alignment::LatestOfEach)
+  {
+    if (in.frames.size() > 1)
+      in.frames.pop_front();
+
+    /* Merge with the latest frame of every source which is recent. */
+    const auto t = captureTime(*f);
+
+    for (size_t i = 0; i < _inputs.size(); i++)
+    {
+      const std::deque< frame_ptr > &frames = _inputs[i].frames;
+      _ready[i] = frames.empty() ? nullptr : frames.back();
+
+      if (_ready[i] && i != source && _settings.max_age > 0)
+      {
+        const double age =
+            std::chrono::duration< double >(t - captureTime(*_ready[i]))
+                .count();
+
+        if (age > _settings.max_age)
+          _ready[i] = nullptr;
+      }
+    }
+  }
+  else
+  {
+    if (in.frames.size() > match_depth)
+      in.frames.pop_front();
+
+    if (!match(source))
+      return;
+  }
+
+  _fresh = true;
+  _cv.notify_one();
+}
+
+bool aggregated_source::connect()
+{
+  _connected = true;
+
+  return !_inputs.empty();
+}
+
+void aggregated_source::disconnect()
+{
+  {
+    std::lock_guard< std::mutex > locker(_lock);
+    _connected = false;
+  }
+
+  _cv.notify_all();
+}
+
+bool aggregated_source::isConnected()
+{
+  return _connected;
+}
+
+void aggregated_source::configure(const stream_settings &)
+{
+  /* The upstream sources are configured by their own arbiters. */
+}
+
+bool aggregated_source::getFrame()
+{
+  std::unique_lock< std::mutex > locker(_lock);
+
+  /* Time out now and then so the frame grabber can shut down. */
+  const bool ready =
+      _cv.wait_for(locker, std::chrono::milliseconds(100), [this]() {
+        return !_connected || _fresh;
+      });
+
+  if (!ready || !_connected)
+    return false;
+
+  _current          = _ready;
+  _current_received = std::chrono::steady_clock::now();
+  _fresh            = false;
+  _current_number++;
+
+  return true;
+}
+
+unsigned int aggregated_source::frameNumber()
+{
+  return _current_number;
+}
+
+double aggregated_source::frameRate()
+{
+  std::lock_guard< std::mutex > locker(_lock);
+
+  double rate = 0;
+
+  /* Every frame of every source yields a merge, else the slowest rules. */
+  for (auto &in : _inputs)
+  {
+    if (_settings.alignment == Alignment::LatestOfEach)
+      rate += in.frame_rate;
+    else if (in.frame_rate > 0 && (rate == 0 || in.frame_rate < rate))
+      rate = in.frame_rate;
+  }
+
+  return rate;
+}
+
+void aggregated_source::extract(frame &f, const extraction_filter &filter)
+{
+  f.frame_number = _current_number;
+  f.frame_rate   = frameRate();
+
+  /* Timecode and server latency of the newest part. */
+  const frame *newest = nullptr;
+
+  for (size_t i = 0; i < _current.size(); i++)
+  {
+    if (!_current[i])
+      continue;
+
+    if (!newest || _current[i]->latency.received > newest->latency.received)
+      newest = _current[i].get();
+
+    append(f, _inputs[i], *_current[i], filter);
+  }
+
+  if (newest)
+  {
+    f.tc                   = newest->tc;
+    f.latency.server_total = newest->latency.server_total;
+  }
+
+  /* Release the parts to their pools. */
+  for (auto &p : _current)
+    p.reset();
+}
+
+std::string aggregated_source::name() const
+{
+  return "aggregate";
+}
+
+}  // end libviconstream
@@ -0,0 +1,100 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "libviconstream/aggregator.h"
+#include "libviconstream/vicon_source.h"
+
+namespace libviconstream
+{
+aggregator::aggregator(std::ostream &log_output,
+                       const aggregation_settings &settings)
+    : _log(log_output),
+      _merge(new aggregated_source(settings)),
+      _stream(std::unique_ptr< frame_source >(_merge), log_output)
+{
+}
+
+aggregator::~aggregator()
+{
+  disableStream();
+}
+
+size_t aggregator::addSource(std::unique_ptr< frame_source > source,
+                             const std::string &ns)
+{
+  const size_t index = _merge->addInput(ns);
+  aggregated_source *merge = _merge;
+
+  _sources.emplace_back(new arbiter(std::move(source), _log));
+
+  /* Feed the merge straight from the source's frame grabber. */
+  _sources.back()->registerCallback([merge, index](const frame &f) {
+    merge->push(index, f.shared_from_this());
+  });
+
+  return index;
+}
+
+size_t aggregator::addSource(const std::string &hostname,
+                             const std::string &ns)
+{
+  return addSource(
+      std::unique_ptr< frame_source >(new vicon_source(hostname)), ns);
+}
+
+bool aggregator::enableStream(const bool enableSegmentData,
+                              const bool enableMarkerData,
+                              const bool enableUnlabeledMarkerData,
+                              const bool enableDeviceData,
+                              const StreamMode::Enum streamMode,
+                              const GrabWait::Enum grabWait)
+{
+  /* Start the sources first, the merged stream needs their frames. */
+  for (auto &s : _sources)
+  {
+    if (!s->enableStream(enableSegmentData, enableMarkerData,
+                         enableUnlabeledMarkerData, enableDeviceData,
+                         streamMode, grabWait))
+    {
+      disableStream();
+      return false;
+    }
+  }
+
+  /* The merge blocks until frames arrive, like ServerPush. */
+  if (!_stream.enableStream(true, true, true, true, StreamMode::ServerPush,
+                            GrabWait::Blocking))
+  {
+    disableStream();
+    return false;
+  }
+
+  return true;
+}
+
+void aggregator::disableStream()
+{
+  _stream.disableStream();
+
+  for (auto &s : _sources)
+    s->disableStream();
+}
+
+arbiter &aggregator::stream()
+{
+  return _stream;
+}
+
+arbiter &aggregator::source(const size_t index)
+{
+  return *_sources[index];
+}
+
+size_t aggregator::sourceCount() const
+{
+  return _sources.size();
+}
+
+}  // end libviconstream
@@ -0,0 +1,212 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cmath>
+#include <algorithm>
+#include "libviconstream/arrival_tracker.h"
+
+namespace libviconstream
+{
+/*********************************
+ * Private members
+ ********************************/
+
+void arrival_tracker::changeRate(
+    const double rate, const std::chrono::steady_clock::time_point t)
+{
+  _previous_rate.store(_rate, std::memory_order_relaxed);
+  _rate_changes.fetch_add(1, std::memory_order_relaxed);
+  _change_time.store(std::chrono::duration_cast< std::chrono::nanoseconds >(
+                         t.time_since_epoch())
+                         .count(),
+                     std::memory_order_relaxed);
+
+  _rate        = rate;
+  _off_windows = 0;
+
+  /* Intervals of the old period would bias the new statistics. */
+  clearIntervals();
+}
+
+void arrival_tracker::clearIntervals()
+{
+  _count.store(0, std::memory_order_relaxed);
+  _sum.store(0, std::memory_order_relaxed);
+  _sum_sq.store(0, std::memory_order_relaxed);
+  _jitter.reset();
+}
+
+/*********************************
+ * Public members
+ ********************************/
+
+arrival_settings::arrival_settings() : window(500), rate_tolerance(0.1)
+{
+}
+
+arrival_tracker::arrival_tracker(const arrival_settings &settings)
+    : _settings(settings),
+      _last_number(0),
+      _started(false),
+      _window_number(0),
+      _reported(0),
+      _rate(0),
+      _off_windows(0),
+      _reset(false),
+      _nominal(0),
+      _effective(0),
+      _count(0),
+      _sum(0),
+      _sum_sq(0),
+      _rate_changes(0),
+      _previous_rate(0),
+      _change_time(0)
+{
+}
+
+bool arrival_tracker::record(
+    const std::chrono::steady_clock::time_point received,
+    const unsigned int frame_number, const double nominal_rate)
+{
+  using namespace std::chrono;
+
+  if (_reset.exchange(false, std::memory_order_relaxed))
+  {
+    clearIntervals();
+    _rate_changes.store(0, std::memory_order_relaxed);
+    _change_time.store(0, std::memory_order_relaxed);
+  }
+
+  _nominal.store(nominal_rate, std::memory_order_relaxed);
+
+  if (!_started || frame_number <= _last_number)
+  {
+    _started       = true;
+    _last_time     = received;
+    _last_number   = frame_number;
+    _window_start  = received;
+    _window_number = frame_number;
+    _off_windows   = 0;
+
+    return false;
+  }
+
+  bool changed = false;
+
+  /* A newly reported rate takes effect at once. The first one is not a
+     change, nor one confirming a change the effective rate detected. */
+  if (nominal_rate > 0 && nominal_rate != _reported)
+  {
+    if (_rate > 0 &&
+        std::fabs(nominal_rate - _rate) > _settings.rate_tolerance * _rate)
+    {
+      changeRate(nominal_rate, received);
+      changed = true;
+    }
+
+    _reported = nominal_rate;
+    _rate     = nominal_rate;
+  }
+
+  const double interval =
+      duration< double >(received - _last_time).count();
+
+  if (frame_number - _last_number == 1 && !changed)
+  {
+    const uint64_t count = _count.load(std::memory_order_relaxed);
+    _sum.store(_sum.load(std::memory_order_relaxed) + interval,
+               std::memory_order_relaxed);
+    _sum_sq.store(_sum_sq.load(std::memory_order_relaxed) +
+                      interval * interval,
+                  std::memory_order_relaxed);
+    _count.store(count + 1, std::memory_order_relaxed);
+
+    if (_rate > 0)
+      _jitter.record(
+          static_cast< int64_t >(std::fabs(interval - 1 / _rate) * 1e9));
+  }
+
+  _last_time   = received;
+  _last_number = frame_number;
+
+  const auto elapsed = received - _window_start;
+
+  if (elapsed < _settings.window)
+    return changed;
+
+  /* A window stretched by a stall does not measure the rate. */
+  if (elapsed <= 2 * _settings.window)
+  {
+    const double effective = (frame_number - _window_number) /
+                             duration< double >(elapsed).count();
+    _effective.store(effective, std::memory_order_relaxed);
+
+    if (_rate <= 0)
+      _rate = effective;
+    else if (std::fabs(effective - _rate) > _settings.rate_tolerance * _rate)
+    {
+      if (++_off_windows >= 2 && !changed)
+      {
+        changeRate(effective, received);
+        changed = true;
+      }
+    }
+    else
+      _off_windows = 0;
+  }
+
+  _window_start  = received;
+  _window_number = frame_number;
+
+  return changed;
+}
+
+double arrival_tracker::rate() const
+{
+  return _rate;
+}
+
+void arrival_tracker::reset()
+{
+  _reset.store(true, std::memory_order_relaxed);
+}
+
+arrival_stats arrival_tracker::summary() const
+{
+  arrival_stats s;
+  s.nominal_rate   = _nominal.load(std::memory_order_relaxed);
+  s.effective_rate = _effective.load(std::memory_order_relaxed);
+  s.intervals      = _count.load(std::memory_order_relaxed);
+
+  const double sum    = _sum.load(std::memory_order_relaxed);
+  const double sum_sq = _sum_sq.load(std::memory_order_relaxed);
+
+  if (s.intervals > 0)
+  {
+    s.mean_interval = sum / s.intervals;
+    s.stddev        = std::sqrt(std::max(
+        sum_sq / s.intervals - s.mean_interval * s.mean_interval, 0.0));
+  }
+  else
+  {
+    s.mean_interval = 0;
+    s.stddev        = 0;
+  }
+
+  s.jitter        = _jitter.summary();
+  s.rate_changes  = _rate_changes.load(std::memory_order_relaxed);
+  s.previous_rate = _previous_rate.load(std::memory_order_relaxed);
+
+  const int64_t change = _change_time.load(std::memory_order_relaxed);
+  const int64_t now = std::chrono::duration_cast< std::chrono::nanoseconds >(
+                          std::chrono::steady_clock::now().time_since_epoch())
+                          .count();
+
+  s.since_rate_change = change == 0 ? -1 : 1e-9 * (now - change);
+
+  return s;
+}
+
+}  // end libviconstream
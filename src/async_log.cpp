@@ -0,0 +1,263 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <algorithm>
+#include "libviconstream/async_log.h"
+
+namespace libviconstream
+{
+namespace
+{
+size_t roundCapacity(const size_t capacity)
+{
+  size_t n = 2;
+
+  while (n < capacity)
+    n <<= 1;
+
+  return n;
+}
+
+int64_t nanoseconds(const std::chrono::steady_clock::duration d)
+{
+  return std::chrono::duration_cast< std::chrono::nanoseconds >(d).count();
+}
+
+/* Characters snprintf stored in a buffer, it returns the untruncated
+   length and reserves the last byte for the terminator. */
+size_t printed(const int n, const size_t size)
+{
+  return n < 0 ? 0 : std::min(static_cast< size_t >(n), size - 1);
+}
+}
+
+const size_t async_log::text_size;
+std::mutex async_log::_out_lock;
+
+/*********************************
+ * Private members
+ ********************************/
+
+async_log::record *async_log::claim(const LogLevel::Enum level,
+                                    uint64_t &index)
+{
+  const int64_t now =
+      nanoseconds(std::chrono::steady_clock::now() - _start);
+
+  /* Count the records of the current second, a racing window change at
+     worst lets a few more through. */
+  if (level < LogLevel::Error && _settings.rate_limit > 0)
+  {
+    const int64_t window = now / 1000000000;
+
+    if (_window.load(std::memory_order_relaxed) != window)
+    {
+      _window.store(window, std::memory_order_relaxed);
+      _window_count.store(0, std::memory_order_relaxed);
+    }
+
+    if (_window_count.fetch_add(1, std::memory_order_relaxed) >=
+        _settings.rate_limit)
+    {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+  }
+
+  /* Bounded multi-producer ring, a producer owns a record once it has
+     moved the head past it. */
+  uint64_t pos = _head.load(std::memory_order_relaxed);
+
+  while (true)
+  {
+    record *r          = &_ring[pos & _mask];
+    const uint64_t seq = r->sequence.load(std::memory_order_acquire);
+    const int64_t diff =
+        static_cast< int64_t >(seq) - static_cast< int64_t >(pos);
+
+    if (diff == 0)
+    {
+      if (_head.compare_exchange_weak(pos, pos + 1,
+                                      std::memory_order_relaxed))
+      {
+        r->time  = now;
+        r->level = static_cast< uint8_t >(level);
+        index    = pos;
+
+        return r;
+      }
+    }
+    else if (diff < 0)
+    {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    else
+      pos = _head.load(std::memory_order_relaxed);
+  }
+}
+
+void async_log::commit(record *r, const uint64_t index)
+{
+  r->sequence.store(index + 1, std::memory_order_release);
+}
+
+void async_log::drain()
+{
+  std::lock_guard< std::mutex > locker(_drain_lock);
+
+  char line[64];
+  _batch.clear();
+
+  while (true)
+  {
+    record *r = &_ring[_tail & _mask];
+
+    if (r->sequence.load(std::memory_order_acquire) != _tail + 1)
+      break;
+
+    const int n = std::snprintf(line, sizeof(line), "[%.6f] ViconLog: ",
+                                1e-9 * r->time);
+    _batch.append(line, printed(n, sizeof(line)));
+    _batch.append(r->text, r->length);
+    _batch.push_back('\n');
+
+    r->sequence.store(_tail + _mask + 1, std::memory_order_release);
+    _tail++;
+  }
+
+  const uint64_t dropped = _dropped.load(std::memory_order_relaxed);
+
+  if (dropped != _reported)
+  {
+    const int n = std::snprintf(
+        line, sizeof(line), "[%.6f] ViconLog: %llu log records dropped.",
+        1e-9 * nanoseconds(std::chrono::steady_clock::now() - _start),
+        static_cast< unsigned long long >(dropped - _reported));
+    _batch.append(line, printed(n, sizeof(line)));
+    _batch.push_back('\n');
+    _reported = dropped;
+  }
+
+  if (_batch.empty())
+    return;
+
+  /* One write and flush per batch instead of one per line. */
+  std::lock_guard< std::mutex > out_locker(_out_lock);
+  _out.write(_batch.data(), _batch.size());
+  _out.flush();
+}
+
+void async_log::writerWorker()
+{
+  while (_running.load())
+  {
+    drain();
+    std::this_thread::sleep_for(_settings.interval);
+  }
+
+  drain();
+}
+
+/*********************************
+ * Public members
+ ********************************/
+
+log_settings::log_settings()
+    : capacity(1024),
+      level(LogLevel::Info),
+      rate_limit(200),
+      interval(10)
+{
+}
+
+async_log::async_log(std::ostream &out, const log_settings &settings)
+    : _out(out),
+      _settings(settings),
+      _ring(roundCapacity(settings.capacity)),
+      _mask(_ring.size() - 1),
+      _head(0),
+      _tail(0),
+      _start(std::chrono::steady_clock::now()),
+      _window(0),
+      _window_count(0),
+      _dropped(0),
+      _reported(0),
+      _running(true)
+{
+  for (size_t i = 0; i < _ring.size(); i++)
+    _ring[i].sequence.store(i, std::memory_order_relaxed);
+
+  _writer = std::thread(&async_log::writerWorker, this);
+}
+
+async_log::~async_log()
+{
+  _running = false;
+
+  if (_writer.joinable())
+    _writer.join();
+}
+
+bool async_log::log(const LogLevel::Enum level, const char *text,
+                    const size_t length)
+{
+  if (level < _settings.level)
+    return true;
+
+  uint64_t index;
+  record *r = claim(level, index);
+
+  if (r == nullptr)
+    return false;
+
+  r->length = static_cast< uint16_t >(std::min(length, text_size));
+  std::memcpy(r->text, text, r->length);
+
+  commit(r, index);
+  return true;
+}
+
+bool async_log::log(const LogLevel::Enum level, const std::string &text)
+{
+  return log(level, text.data(), text.size());
+}
+
+bool async_log::logf(const LogLevel::Enum level, const char *format, ...)
+{
+  if (level < _settings.level)
+    return true;
+
+  uint64_t index;
+  record *r = claim(level, index);
+
+  if (r == nullptr)
+    return false;
+
+  va_list args;
+  va_start(args, format);
+  const int n = std::vsnprintf(r->text, text_size, format, args);
+  va_end(args);
+
+  r->length = static_cast< uint16_t >(printed(n, text_size));
+
+  commit(r, index);
+  return true;
+}
+
+void async_log::flush()
+{
+  drain();
+}
+
+uint64_t async_log::dropped() const
+{
+  return _dropped.load(std::memory_order_relaxed);
+}
+
+}  // end libviconstream
@@ -0,0 +1,168 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <utility>
+#include "libviconstream/frame.h"
+
+namespace libviconstream
+{
+frame::frame() : frame_number(0), frame_rate(0), tc(), latency()
+{
+}
+
+void frame::clear()
+{
+  frame_number = 0;
+  frame_rate   = 0;
+  tc           = timecode();
+  latency      = frame_latency();
+
+  /* clear() keeps the capacity, so a reused frame does not allocate. */
+  subjects.clear();
+  segments.clear();
+  markers.clear();
+  unlabeled_markers.clear();
+  devices.clear();
+  device_outputs.clear();
+  latency_samples.clear();
+
+  subject_names.clear();
+  segment_names.clear();
+  marker_names.clear();
+  device_names.clear();
+  device_output_names.clear();
+  latency_sample_names.clear();
+
+  for (int i = 0; i < 3; i++)
+  {
+    motion.velocity[i].clear();
+    motion.angular_velocity[i].clear();
+    motion.acceleration[i].clear();
+  }
+
+  motion.order.clear();
+
+  handles.reset();
+}
+
+void frame::swap(frame &other)
+{
+  std::swap(frame_number, other.frame_number);
+  std::swap(frame_rate, other.frame_rate);
+  std::swap(tc, other.tc);
+  std::swap(latency, other.latency);
+
+  latency_samples.swap(other.latency_samples);
+  subjects.swap(other.subjects);
+  segments.swap(other.segments);
+  markers.swap(other.markers);
+  unlabeled_markers.swap(other.unlabeled_markers);
+  devices.swap(other.devices);
+  device_outputs.swap(other.device_outputs);
+
+  subject_names.swap(other.subject_names);
+  segment_names.swap(other.segment_names);
+  marker_names.swap(other.marker_names);
+  device_names.swap(other.device_names);
+  device_output_names.swap(other.device_output_names);
+  latency_sample_names.swap(other.latency_sample_names);
+
+  for (int i = 0; i < 3; i++)
+  {
+    motion.velocity[i].swap(other.motion.velocity[i]);
+    motion.angular_velocity[i].swap(other.motion.angular_velocity[i]);
+    motion.acceleration[i].swap(other.motion.acceleration[i]);
+  }
+
+  motion.order.swap(other.motion.order);
+  handles.swap(other.handles);
+}
+
+int frame::findSubject(const std::string &subject) const
+{
+  for (size_t i = 0; i < subject_names.size(); i++)
+  {
+    if (subject_names[i] == subject)
+      return static_cast< int >(i);
+  }
+
+  return -1;
+}
+
+int frame::findSegment(const std::string &subject,
+                       const std::string &segment) const
+{
+  const int s = findSubject(subject);
+
+  if (s < 0)
+    return -1;
+
+  const subject_data &sd = subjects[s];
+
+  for (uint32_t i = sd.first_segment; i < sd.first_segment + sd.segment_count;
+       i++)
+  {
+    if (segment_names[i] == segment)
+      return static_cast< int >(i);
+  }
+
+  return -1;
+}
+
+const pose *frame::subjectPose(const std::string &subject) const
+{
+  const int s = findSubject(subject);
+
+  if (s < 0 || subjects[s].segment_count == 0)
+    return nullptr;
+
+  return &segments[subjects[s].root_segment].global;
+}
+
+int frame::findSubject(const subject_handle subject) const
+{
+  if (!handles || subject.id >= handles->subjects.size())
+    return -1;
+
+  return handles->subjects[subject.id];
+}
+
+int frame::findSegment(const segment_handle segment) const
+{
+  if (!handles || segment.id >= handles->segments.size())
+    return -1;
+
+  return handles->segments[segment.id];
+}
+
+int frame::findMarker(const marker_handle marker) const
+{
+  if (!handles || marker.id >= handles->markers.size())
+    return -1;
+
+  return handles->markers[marker.id];
+}
+
+const pose *frame::subjectPose(const subject_handle subject) const
+{
+  const int s = findSubject(subject);
+
+  if (s < 0 || subjects[s].segment_count == 0)
+    return nullptr;
+
+  return &segments[subjects[s].root_segment].global;
+}
+
+const pose *frame::segmentPose(const segment_handle segment) const
+{
+  const int s = findSegment(segment);
+
+  if (s < 0)
+    return nullptr;
+
+  return &segments[s].global;
+}
+
+}  // end libviconstream
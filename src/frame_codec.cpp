@@ -0,0 +1,210 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstring>
+#include "libviconstream/frame_codec.h"
+
+namespace libviconstream
+{
+namespace
+{
+/*
+ * Encoding helpers.
+ */
+
+void put(std::vector< uint8_t > &out, const void *data, const size_t size)
+{
+  const uint8_t *p = static_cast< const uint8_t * >(data);
+  out.insert(out.end(), p, p + size);
+}
+
+template < typename T >
+void putValue(std::vector< uint8_t > &out, const T &value)
+{
+  put(out, &value, sizeof(T));
+}
+
+template < typename T >
+void putArray(std::vector< uint8_t > &out, const std::vector< T > &v)
+{
+  if (!v.empty())
+    put(out, v.data(), v.size() * sizeof(T));
+}
+
+void putNames(std::vector< uint8_t > &out,
+              const std::vector< std::string > &names)
+{
+  for (const auto &name : names)
+  {
+    const uint16_t len = static_cast< uint16_t >(name.size());
+    putValue(out, len);
+    put(out, name.data(), len);
+  }
+}
+
+/*
+ * Decoding helpers, all fail on truncated data.
+ */
+
+class reader
+{
+private:
+  const uint8_t *_p;
+  const uint8_t *_end;
+
+public:
+  reader(const uint8_t *data, const size_t size) : _p(data), _end(data + size)
+  {
+  }
+
+  bool get(void *data, const size_t size)
+  {
+    if (static_cast< size_t >(_end - _p) < size)
+      return false;
+
+    std::memcpy(data, _p, size);
+    _p += size;
+
+    return true;
+  }
+
+  template < typename T >
+  bool getValue(T &value)
+  {
+    return get(&value, sizeof(T));
+  }
+
+  template < typename T >
+  bool getArray(std::vector< T > &v, const uint32_t count)
+  {
+    if (static_cast< size_t >(_end - _p) / sizeof(T) < count)
+      return false;
+
+    v.resize(count);
+
+    return count == 0 || get(v.data(), count * sizeof(T));
+  }
+
+  bool getNames(std::vector< std::string > &names, const size_t count)
+  {
+    names.resize(count);
+
+    for (auto &name : names)
+    {
+      uint16_t len;
+
+      if (!getValue(len) || static_cast< size_t >(_end - _p) < len)
+        return false;
+
+      name.assign(reinterpret_cast< const char * >(_p), len);
+      _p += len;
+    }
+
+    return true;
+  }
+};
+}
+
+void encodeFrame(const frame &f, std::vector< uint8_t > &out)
+{
+  putValue(out, f.frame_number);
+  putValue(out, f.frame_rate);
+  putValue(out, f.tc);
+  putValue(out, f.latency);
+
+  const uint32_t counts[7] = {
+      static_cast< uint32_t >(f.subjects.size()),
+      static_cast< uint32_t >(f.segments.size()),
+      static_cast< uint32_t >(f.markers.size()),
+      static_cast< uint32_t >(f.unlabeled_markers.size()),
+      static_cast< uint32_t >(f.devices.size()),
+      static_cast< uint32_t >(f.device_outputs.size()),
+      static_cast< uint32_t >(f.latency_samples.size())};
+
+  putValue(out, counts);
+
+  putArray(out, f.subjects);
+  putArray(out, f.segments);
+  putArray(out, f.markers);
+  putArray(out, f.unlabeled_markers);
+  putArray(out, f.devices);
+  putArray(out, f.device_outputs);
+  putArray(out, f.latency_samples);
+
+  putNames(out, f.subject_names);
+  putNames(out, f.segment_names);
+  putNames(out, f.marker_names);
+  putNames(out, f.device_names);
+  putNames(out, f.device_output_names);
+  putNames(out, f.latency_sample_names);
+}
+
+bool decodeFrame(const uint8_t *data, const size_t size, frame &f)
+{
+  reader r(data, size);
+  uint32_t counts[7];
+
+  f.clear();
+
+  const bool ok = r.getValue(f.frame_number) && r.getValue(f.frame_rate) &&
+                  r.getValue(f.tc) && r.getValue(f.latency) &&
+                  r.getValue(counts) &&
+                  r.getArray(f.subjects, counts[0]) &&
+                  r.getArray(f.segments, counts[1]) &&
+                  r.getArray(f.markers, counts[2]) &&
+                  r.getArray(f.unlabeled_markers, counts[3]) &&
+                  r.getArray(f.devices, counts[4]) &&
+                  r.getArray(f.device_outputs, counts[5]) &&
+                  r.getArray(f.latency_samples, counts[6]) &&
+                  r.getNames(f.subject_names, counts[0]) &&
+                  r.getNames(f.segment_names, counts[1]) &&
+                  r.getNames(f.marker_names, counts[2]) &&
+                  r.getNames(f.device_names, counts[4]) &&
+                  r.getNames(f.device_output_names, counts[5]) &&
+                  r.getNames(f.latency_sample_names, counts[6]);
+
+  if (!ok)
+    return false;
+
+  /* The indexes must stay inside the arrays for the lookups to be safe,
+     also when decoding a slot torn by a concurrent writer. */
+  for (const auto &sd : f.subjects)
+  {
+    if (uint64_t(sd.first_segment) + sd.segment_count > f.segments.size() ||
+        uint64_t(sd.first_marker) + sd.marker_count > f.markers.size() ||
+        (sd.segment_count > 0 &&
+         (sd.root_segment < sd.first_segment ||
+          sd.root_segment - sd.first_segment >= sd.segment_count)))
+      return false;
+  }
+
+  for (const auto &sd : f.segments)
+  {
+    if (sd.subject >= f.subjects.size())
+      return false;
+  }
+
+  for (const auto &md : f.markers)
+  {
+    if (md.subject >= f.subjects.size())
+      return false;
+  }
+
+  for (const auto &dd : f.devices)
+  {
+    if (uint64_t(dd.first_output) + dd.output_count > f.device_outputs.size())
+      return false;
+  }
+
+  for (const auto &od : f.device_outputs)
+  {
+    if (od.device >= f.devices.size())
+      return false;
+  }
+
+  return true;
+}
+
+}  // end libviconstream
@@ -0,0 +1,80 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "libviconstream/frame_counters.h"
+
+namespace libviconstream
+{
+frame_counters::frame_counters()
+    : _frames(0), _lost(0), _gaps(0), _longest_gap(0), _stale(0), _last(0)
+{
+  for (auto &b : _histogram)
+    b.store(0, std::memory_order_relaxed);
+}
+
+void frame_counters::recordFrame(
+    const std::chrono::steady_clock::time_point received)
+{
+  _frames.fetch_add(1, std::memory_order_relaxed);
+  _last.store(std::chrono::duration_cast< std::chrono::nanoseconds >(
+                  received.time_since_epoch())
+                  .count(),
+              std::memory_order_relaxed);
+}
+
+void frame_counters::recordGap(const uint64_t lost)
+{
+  const unsigned int msb    = 63 - __builtin_clzll(lost | 1);
+  const unsigned int bucket = msb < gap_buckets ? msb : gap_buckets - 1;
+
+  _histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+  _lost.fetch_add(lost, std::memory_order_relaxed);
+  _gaps.fetch_add(1, std::memory_order_relaxed);
+
+  /* Only the frame grabber records, a plain compare suffices. */
+  if (lost > _longest_gap.load(std::memory_order_relaxed))
+    _longest_gap.store(lost, std::memory_order_relaxed);
+}
+
+void frame_counters::recordStale()
+{
+  _stale.fetch_add(1, std::memory_order_relaxed);
+}
+
+void frame_counters::reset()
+{
+  _frames.store(0, std::memory_order_relaxed);
+  _lost.store(0, std::memory_order_relaxed);
+  _gaps.store(0, std::memory_order_relaxed);
+  _longest_gap.store(0, std::memory_order_relaxed);
+  _stale.store(0, std::memory_order_relaxed);
+
+  for (auto &b : _histogram)
+    b.store(0, std::memory_order_relaxed);
+}
+
+frame_stats frame_counters::summary() const
+{
+  frame_stats s;
+  s.frames      = _frames.load(std::memory_order_relaxed);
+  s.lost        = _lost.load(std::memory_order_relaxed);
+  s.gaps        = _gaps.load(std::memory_order_relaxed);
+  s.longest_gap = _longest_gap.load(std::memory_order_relaxed);
+  s.stale       = _stale.load(std::memory_order_relaxed);
+
+  for (unsigned int i = 0; i < gap_buckets; i++)
+    s.gap_histogram[i] = _histogram[i].load(std::memory_order_relaxed);
+
+  const int64_t last = _last.load(std::memory_order_relaxed);
+  const int64_t now  = std::chrono::duration_cast< std::chrono::nanoseconds >(
+                          std::chrono::steady_clock::now().time_since_epoch())
+                          .count();
+
+  s.since_last = last == 0 ? -1 : 1e-9 * (now - last);
+
+  return s;
+}
+
+}  // end libviconstream
@@ -0,0 +1,188 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include "libviconstream/frame_stream.h"
+#include "libviconstream/viconstream.h"
+
+namespace libviconstream
+{
+/*********************************
+ * Private members
+ ********************************/
+
+void frame_stream::push(const frame &f)
+{
+  _received.fetch_add(1, std::memory_order_relaxed);
+
+  std::coroutine_handle<> waiter;
+
+  {
+    std::lock_guard< std::mutex > locker(_lock);
+
+    if (_closed)
+      return;
+
+    /* A waiting coroutine gets the frame directly, the buffer is empty. */
+    if (_waiter)
+    {
+      _waiting->_frame = f.shared_from_this();
+      _waiting         = nullptr;
+      waiter           = std::exchange(_waiter, nullptr);
+    }
+    else
+    {
+      if (_count == _buffer.size())
+      {
+        _buffer[_head].reset();
+        _head = (_head + 1) % _buffer.size();
+        _count--;
+        _skipped.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      _buffer[(_head + _count) % _buffer.size()] = f.shared_from_this();
+      _count++;
+    }
+  }
+
+  if (waiter)
+    resume(waiter);
+}
+
+frame_ptr frame_stream::pop()
+{
+  frame_ptr f;
+
+  if (_options.skip_to_latest)
+  {
+    f = std::move(_buffer[(_head + _count - 1) % _buffer.size()]);
+
+    /* Release the skipped frames to the pool. */
+    for (size_t i = 0; i + 1 < _count; i++)
+      _buffer[(_head + i) % _buffer.size()].reset();
+
+    _skipped.fetch_add(_count - 1, std::memory_order_relaxed);
+    _head  = 0;
+    _count = 0;
+  }
+  else
+  {
+    f     = std::move(_buffer[_head]);
+    _head = (_head + 1) % _buffer.size();
+    _count--;
+  }
+
+  return f;
+}
+
+void frame_stream::resume(std::coroutine_handle<> h)
+{
+  if (_options.resumer)
+    _options.resumer(h);
+  else
+    h.resume();
+}
+
+bool frame_stream::next_awaiter::await_suspend(std::coroutine_handle<> h)
+{
+  std::lock_guard< std::mutex > locker(_stream._lock);
+
+  if (_stream._count > 0)
+  {
+    _frame = _stream.pop();
+    return false;
+  }
+
+  /* Closed, or another coroutine already waits: returns nullptr. */
+  if (_stream._closed || _stream._waiter)
+    return false;
+
+  _stream._waiter  = h;
+  _stream._waiting = this;
+
+  return true;
+}
+
+/*********************************
+ * Public members
+ ********************************/
+
+stream_options::stream_options() : buffer(1), skip_to_latest(true)
+{
+}
+
+frame_stream::frame_stream(arbiter &a, const stream_options &options)
+    : _options(options),
+      _arbiter(&a),
+      _id(0),
+      _buffer(std::max< size_t >(options.buffer, 1)),
+      _head(0),
+      _count(0),
+      _waiting(nullptr),
+      _closed(false),
+      _received(0),
+      _skipped(0)
+{
+  _id = a.registerCallback(_options.filter,
+                           [this](const frame &f) { push(f); },
+                           DispatchMode::Inline);
+}
+
+frame_stream::~frame_stream()
+{
+  close();
+}
+
+frame_stream::next_awaiter frame_stream::next()
+{
+  return next_awaiter(*this);
+}
+
+frame_generator frame_stream::frames()
+{
+  while (frame_ptr f = co_await next())
+    co_yield std::move(f);
+}
+
+void frame_stream::close()
+{
+  /* Waits for dispatch, no push() is running after this. */
+  if (_arbiter != nullptr)
+  {
+    _arbiter->unregisterCallback(_id);
+    _arbiter = nullptr;
+  }
+
+  std::coroutine_handle<> waiter;
+
+  {
+    std::lock_guard< std::mutex > locker(_lock);
+
+    _closed = true;
+
+    for (auto &f : _buffer)
+      f.reset();
+
+    _count   = 0;
+    _waiting = nullptr;
+    waiter   = std::exchange(_waiter, nullptr);
+  }
+
+  /* The waiting coroutine sees the end of the stream. */
+  if (waiter)
+    resume(waiter);
+}
+
+uint64_t frame_stream::framesReceived() const
+{
+  return _received.load(std::memory_order_relaxed);
+}
+
+uint64_t frame_stream::framesSkipped() const
+{
+  return _skipped.load(std::memory_order_relaxed);
+}
+
+}  // end libviconstream
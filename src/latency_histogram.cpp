@@ -0,0 +1,152 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cmath>
+#include "libviconstream/latency_histogram.h"
+
+namespace libviconstream
+{
+/*********************************
+ * Private members
+ ********************************/
+
+unsigned int latency_histogram::bucketOf(uint64_t ns)
+{
+  if (ns < 64)
+    return static_cast< unsigned int >(ns);
+
+  /* Shift the value so the top 6 bits select the sub-bucket. */
+  const unsigned int msb   = 63 - __builtin_clzll(ns);
+  const unsigned int shift = msb - 5;
+  unsigned int bucket      = 64 + (shift - 1) * 32 + ((ns >> shift) - 32);
+
+  if (bucket >= bucket_count)
+    bucket = bucket_count - 1;
+
+  return bucket;
+}
+
+uint64_t latency_histogram::valueOf(const unsigned int bucket)
+{
+  if (bucket < 64)
+    return bucket;
+
+  const unsigned int shift = (bucket - 64) / 32 + 1;
+  const uint64_t sub       = (bucket - 64) % 32 + 32;
+
+  return ((sub + 1) << shift) - 1;
+}
+
+/*********************************
+ * Public members
+ ********************************/
+
+latency_histogram::latency_histogram() : _count(0), _sum(0), _max(0)
+{
+  for (auto &b : _buckets)
+    b.store(0, std::memory_order_relaxed);
+}
+
+void latency_histogram::record(const int64_t ns)
+{
+  const uint64_t v = ns > 0 ? static_cast< uint64_t >(ns) : 0;
+
+  _buckets[bucketOf(v)].fetch_add(1, std::memory_order_relaxed);
+  _count.fetch_add(1, std::memory_order_relaxed);
+  _sum.fetch_add(v, std::memory_order_relaxed);
+
+  uint64_t max = _max.load(std::memory_order_relaxed);
+  while (v > max &&
+         !_max.compare_exchange_weak(max, v, std::memory_order_relaxed))
+  {
+  }
+}
+
+void latency_histogram::add(const latency_histogram &other)
+{
+  for (unsigned int i = 0; i < bucket_count; i++)
+  {
+    const uint64_t n = other._buckets[i].load(std::memory_order_relaxed);
+
+    if (n > 0)
+      _buckets[i].fetch_add(n, std::memory_order_relaxed);
+  }
+
+  _count.fetch_add(other._count.load(std::memory_order_relaxed),
+                   std::memory_order_relaxed);
+  _sum.fetch_add(other._sum.load(std::memory_order_relaxed),
+                 std::memory_order_relaxed);
+
+  const uint64_t v = other._max.load(std::memory_order_relaxed);
+  uint64_t max     = _max.load(std::memory_order_relaxed);
+  while (v > max &&
+         !_max.compare_exchange_weak(max, v, std::memory_order_relaxed))
+  {
+  }
+}
+
+void latency_histogram::reset()
+{
+  for (auto &b : _buckets)
+    b.store(0, std::memory_order_relaxed);
+
+  _count.store(0, std::memory_order_relaxed);
+  _sum.store(0, std::memory_order_relaxed);
+  _max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t latency_histogram::count() const
+{
+  return _count.load(std::memory_order_relaxed);
+}
+
+uint64_t latency_histogram::percentile(const double p) const
+{
+  /* Sum the buckets, the count may lag behind concurrent records. */
+  uint64_t total = 0;
+
+  for (const auto &b : _buckets)
+    total += b.load(std::memory_order_relaxed);
+
+  if (total == 0)
+    return 0;
+
+  const uint64_t rank = static_cast< uint64_t >(
+      std::ceil(p / 100.0 * static_cast< double >(total)));
+  uint64_t seen = 0;
+
+  for (unsigned int i = 0; i < bucket_count; i++)
+  {
+    seen += _buckets[i].load(std::memory_order_relaxed);
+
+    if (seen >= rank && seen > 0)
+    {
+      /* The bucket's upper bound, but never above the true max. */
+      const uint64_t v   = valueOf(i);
+      const uint64_t max = _max.load(std::memory_order_relaxed);
+
+      return v < max ? v : max;
+    }
+  }
+
+  return _max.load(std::memory_order_relaxed);
+}
+
+latency_summary latency_histogram::summary() const
+{
+  latency_summary s;
+  s.count = count();
+  s.mean  = s.count > 0 ? 1e-9 * _sum.load(std::memory_order_relaxed) /
+                             static_cast< double >(s.count)
+                       : 0;
+  s.p50  = 1e-9 * percentile(50);
+  s.p99  = 1e-9 * percentile(99);
+  s.p999 = 1e-9 * percentile(99.9);
+  s.max  = 1e-9 * _max.load(std::memory_order_relaxed);
+
+  return s;
+}
+
+}  // end libviconstream
@@ -0,0 +1,303 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <chrono>
+#include "libviconstream/motion_estimator.h"
+
+namespace libviconstream
+{
+namespace
+{
+const uint32_t no_handle = std::numeric_limits< uint32_t >::max();
+
+/* Velocity and acceleration along one axis, vectorized by the compiler. */
+void estimateLinear(const double *__restrict c, const double *__restrict p,
+                    const double *__restrict pv, const double *__restrict pa,
+                    const double *__restrict inv_dt,
+                    const double *__restrict gain_v,
+                    const double *__restrict gain_a,
+                    const double *__restrict has_v, double *__restrict v,
+                    double *__restrict a, const size_t n)
+{
+  for (size_t j = 0; j < n; j++)
+  {
+    const double v_raw = (c[j] - p[j]) * inv_dt[j];
+    const double v_new = pv[j] + gain_v[j] * (v_raw - pv[j]);
+    const double a_raw = (v_new - pv[j]) * inv_dt[j] * has_v[j];
+
+    v[j] = v_new;
+    a[j] = pa[j] + gain_a[j] * (a_raw - pa[j]);
+  }
+}
+
+/* Angular velocity from consecutive orientations, vectorized by the
+ * compiler, which needs every array as its own restrict parameter. */
+void estimateAngular(const double *__restrict qx, const double *__restrict qy,
+                     const double *__restrict qz, const double *__restrict qw,
+                     const double *__restrict px, const double *__restrict py,
+                     const double *__restrict pz, const double *__restrict pw,
+                     const double *__restrict ox, const double *__restrict oy,
+                     const double *__restrict oz,
+                     const double *__restrict inv_dt,
+                     const double *__restrict gain, double *__restrict wx,
+                     double *__restrict wy, double *__restrict wz,
+                     const size_t n)
+{
+  for (size_t j = 0; j < n; j++)
+  {
+    /* dq = q * conj(q_prev), the rotation since the last sample. */
+    const double rx =
+        -qw[j] * px[j] + qx[j] * pw[j] - qy[j] * pz[j] + qz[j] * py[j];
+    const double ry =
+        -qw[j] * py[j] + qx[j] * pz[j] + qy[j] * pw[j] - qz[j] * px[j];
+    const double rz =
+        -qw[j] * pz[j] - qx[j] * py[j] + qy[j] * px[j] + qz[j] * pw[j];
+    const double rw =
+        qw[j] * pw[j] + qx[j] * px[j] + qy[j] * py[j] + qz[j] * pz[j];
+
+    /* The angle over the axis, 2 asin(s) / s, to fourth order in s, on the
+     * shorter way around. */
+    const double s2 = rx * rx + ry * ry + rz * rz;
+    const double k  = std::copysign(2.0, rw) *
+                     (1 + s2 * (1.0 / 6 + s2 * (3.0 / 40))) * inv_dt[j];
+
+    wx[j] = ox[j] + gain[j] * (rx * k - ox[j]);
+    wy[j] = oy[j] + gain[j] * (ry * k - oy[j]);
+    wz[j] = oz[j] + gain[j] * (rz * k - oz[j]);
+  }
+}
+}
+
+motion_settings::motion_settings() : smoothing(0), max_gap(0.1)
+{
+}
+
+/*********************************
+ * Private members
+ ********************************/
+
+void motion_estimator::reserve(const uint32_t id)
+{
+  if (id < _samples.size())
+    return;
+
+  const size_t n = id + 1;
+
+  for (int i = 0; i < 3; i++)
+  {
+    _position[i].resize(n, 0);
+    _velocity[i].resize(n, 0);
+    _angular[i].resize(n, 0);
+    _acceleration[i].resize(n, 0);
+  }
+
+  for (int i = 0; i < 4; i++)
+    _rotation[i].resize(n, 0);
+
+  _frame.resize(n, 0);
+  _time.resize(n, 0);
+  _samples.resize(n, 0);
+}
+
+/*********************************
+ * Public members
+ ********************************/
+
+motion_estimator::motion_estimator(const motion_settings &settings)
+    : _settings(settings)
+{
+}
+
+void motion_estimator::update(frame &f)
+{
+  const size_t n = f.subjects.size();
+  motion_data &m = f.motion;
+
+  for (int i = 0; i < 3; i++)
+  {
+    m.velocity[i].resize(n);
+    m.angular_velocity[i].resize(n);
+    m.acceleration[i].resize(n);
+
+    _cur_position[i].resize(n);
+    _prev_position[i].resize(n);
+    _prev_velocity[i].resize(n);
+    _prev_angular[i].resize(n);
+    _prev_acceleration[i].resize(n);
+  }
+
+  for (int i = 0; i < 4; i++)
+  {
+    _cur_rotation[i].resize(n);
+    _prev_rotation[i].resize(n);
+  }
+
+  m.order.resize(n);
+  _ids.assign(n, no_handle);
+  _next.resize(n);
+  _inv_dt.resize(n);
+  _gain_v.resize(n);
+  _gain_a.resize(n);
+  _has_v.resize(n);
+
+  if (f.handles)
+  {
+    const std::vector< int32_t > &map = f.handles->subjects;
+
+    for (size_t k = 0; k < map.size(); k++)
+    {
+      if (map[k] >= 0 && static_cast< size_t >(map[k]) < n)
+        _ids[map[k]] = static_cast< uint32_t >(k);
+    }
+  }
+
+  const double received =
+      std::chrono::duration< double >(f.latency.received.time_since_epoch())
+          .count();
+
+  /* Gather: the current and previous samples into contiguous arrays. */
+  for (size_t j = 0; j < n; j++)
+  {
+    const subject_data &sd = f.subjects[j];
+    const uint32_t id      = _ids[j];
+    const pose *p =
+        sd.segment_count > 0 ? &f.segments[sd.root_segment].global : nullptr;
+
+    const bool present = id != no_handle && p != nullptr && !p->occluded;
+    const double t     = received - sd.source_delay;
+    unsigned int samples = 0;
+    double dt            = 0;
+    bool repeat          = false;
+
+    if (present)
+    {
+      reserve(id);
+      samples = _samples[id];
+
+      /* A merge triggered by another source repeats the sample, it is no
+         new information and keeps the estimates. */
+      repeat = samples > 0 && sd.source_frame == _frame[id];
+
+      if (samples > 0 && !repeat)
+      {
+        if (sd.source_rate > 0)
+          dt = (static_cast< double >(sd.source_frame) - _frame[id]) /
+               sd.source_rate;
+        else
+          dt = t - _time[id];
+
+        if (dt <= 0 || (_settings.max_gap > 0 && dt > _settings.max_gap))
+          samples = 0;
+      }
+
+      for (int i = 0; i < 3; i++)
+      {
+        _cur_position[i][j]      = p->translation[i];
+        _prev_position[i][j]     = _position[i][id];
+        _prev_velocity[i][j]     = samples > 1 ? _velocity[i][id] : 0;
+        _prev_angular[i][j]      = samples > 1 ? _angular[i][id] : 0;
+        _prev_acceleration[i][j] = samples > 2 ? _acceleration[i][id] : 0;
+      }
+
+      for (int i = 0; i < 4; i++)
+      {
+        _cur_rotation[i][j]  = p->rotation[i];
+        _prev_rotation[i][j] = samples > 0 ? _rotation[i][id] : p->rotation[i];
+      }
+    }
+    else
+    {
+      for (int i = 0; i < 3; i++)
+      {
+        _cur_position[i][j]      = 0;
+        _prev_position[i][j]     = 0;
+        _prev_velocity[i][j]     = 0;
+        _prev_angular[i][j]      = 0;
+        _prev_acceleration[i][j] = 0;
+      }
+
+      for (int i = 0; i < 4; i++)
+      {
+        _cur_rotation[i][j]  = 0;
+        _prev_rotation[i][j] = 0;
+      }
+    }
+
+    /* A first-order low-pass, exact for any time step. A new estimate
+     * starts from its raw value. */
+    const double gain =
+        dt > 0 ? dt / (_settings.smoothing + dt) : 1;
+
+    _inv_dt[j] = samples > 0 && !repeat ? 1 / dt : 0;
+    _gain_v[j] = repeat ? 0 : samples > 1 ? gain : 1;
+    _gain_a[j] = repeat ? 0 : samples > 2 ? gain : 1;
+    _has_v[j]  = samples > 1 ? 1 : 0;
+    _next[j]   = 0;
+
+    if (present)
+      _next[j] = static_cast< uint8_t >(
+          repeat ? samples : std::min(samples + 1, 3u));
+
+    m.order[j] = _next[j] > 1 ? _next[j] - 1 : 0;
+  }
+
+  /* Estimate: branch free passes over all subjects. */
+  for (int i = 0; i < 3; i++)
+    estimateLinear(_cur_position[i].data(), _prev_position[i].data(),
+                   _prev_velocity[i].data(), _prev_acceleration[i].data(),
+                   _inv_dt.data(), _gain_v.data(), _gain_a.data(),
+                   _has_v.data(), m.velocity[i].data(),
+                   m.acceleration[i].data(), n);
+
+  estimateAngular(_cur_rotation[0].data(), _cur_rotation[1].data(),
+                  _cur_rotation[2].data(), _cur_rotation[3].data(),
+                  _prev_rotation[0].data(), _prev_rotation[1].data(),
+                  _prev_rotation[2].data(), _prev_rotation[3].data(),
+                  _prev_angular[0].data(), _prev_angular[1].data(),
+                  _prev_angular[2].data(), _inv_dt.data(), _gain_v.data(),
+                  m.angular_velocity[0].data(), m.angular_velocity[1].data(),
+                  m.angular_velocity[2].data(), n);
+
+  /* Scatter: advance the state of the subjects in the frame. */
+  for (size_t j = 0; j < n; j++)
+  {
+    const uint32_t id = _ids[j];
+
+    if (id == no_handle || id >= _samples.size())
+      continue;
+
+    _samples[id] = _next[j];
+
+    if (_next[j] == 0)
+      continue;
+
+    for (int i = 0; i < 3; i++)
+    {
+      _position[i][id]     = _cur_position[i][j];
+      _velocity[i][id]     = m.velocity[i][j];
+      _angular[i][id]      = m.angular_velocity[i][j];
+      _acceleration[i][id] = m.acceleration[i][j];
+    }
+
+    for (int i = 0; i < 4; i++)
+      _rotation[i][id] = _cur_rotation[i][j];
+
+    _frame[id] = f.subjects[j].source_frame;
+    _time[id]  = received - f.subjects[j].source_delay;
+  }
+}
+
+void motion_estimator::reset(const motion_settings &settings)
+{
+  _settings = settings;
+
+  for (auto &s : _samples)
+    s = 0;
+}
+
+}  // end libviconstream
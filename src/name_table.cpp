@@ -0,0 +1,123 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include "libviconstream/name_table.h"
+
+namespace libviconstream
+{
+name_table::name_table() : _generation(0)
+{
+}
+
+subject_handle name_table::subject(const std::string &subject)
+{
+  std::lock_guard< std::mutex > locker(_lock);
+
+  auto it = _subjects.find(subject);
+
+  if (it == _subjects.end())
+  {
+    it = _subjects.emplace(subject, _subjects.size()).first;
+    _generation.fetch_add(1, std::memory_order_release);
+  }
+
+  subject_handle h;
+  h.id = it->second;
+
+  return h;
+}
+
+segment_handle name_table::segment(const std::string &subject,
+                                   const std::string &segment)
+{
+  std::lock_guard< std::mutex > locker(_lock);
+
+  const name_pair key(subject, segment);
+  auto it = _segments.find(key);
+
+  if (it == _segments.end())
+  {
+    it = _segments.emplace(key, _segments.size()).first;
+    _generation.fetch_add(1, std::memory_order_release);
+  }
+
+  segment_handle h;
+  h.id = it->second;
+
+  return h;
+}
+
+marker_handle name_table::marker(const std::string &subject,
+                                 const std::string &marker)
+{
+  std::lock_guard< std::mutex > locker(_lock);
+
+  const name_pair key(subject, marker);
+  auto it = _markers.find(key);
+
+  if (it == _markers.end())
+  {
+    it = _markers.emplace(key, _markers.size()).first;
+    _generation.fetch_add(1, std::memory_order_release);
+  }
+
+  marker_handle h;
+  h.id = it->second;
+
+  return h;
+}
+
+uint32_t name_table::generation() const
+{
+  return _generation.load(std::memory_order_acquire);
+}
+
+std::shared_ptr< const handle_map > name_table::map(const frame &f,
+                                                    uint32_t &generation) const
+{
+  std::shared_ptr< handle_map > m = std::make_shared< handle_map >();
+
+  std::lock_guard< std::mutex > locker(_lock);
+
+  generation = _generation.load(std::memory_order_relaxed);
+
+  m->subjects.assign(_subjects.size(), -1);
+  m->segments.assign(_segments.size(), -1);
+  m->markers.assign(_markers.size(), -1);
+
+  /* Walk the frame's model and look up each name once. */
+  for (size_t s = 0; s < f.subjects.size(); s++)
+  {
+    const std::string &name = f.subject_names[s];
+    const subject_data &sd  = f.subjects[s];
+
+    auto sit = _subjects.find(name);
+
+    if (sit != _subjects.end())
+      m->subjects[sit->second] = static_cast< int32_t >(s);
+
+    for (uint32_t i = sd.first_segment; i < sd.first_segment + sd.segment_count;
+         i++)
+    {
+      auto it = _segments.find(name_pair(name, f.segment_names[i]));
+
+      if (it != _segments.end())
+        m->segments[it->second] = static_cast< int32_t >(i);
+    }
+
+    for (uint32_t i = sd.first_marker; i < sd.first_marker + sd.marker_count;
+         i++)
+    {
+      auto it = _markers.find(name_pair(name, f.marker_names[i]));
+
+      if (it != _markers.end())
+        m->markers[it->second] = static_cast< int32_t >(i);
+    }
+  }
+
+  return m;
+}
+
+}  // end libviconstream
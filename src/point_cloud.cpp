@@ -0,0 +1,180 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "libviconstream/point_cloud.h"
+#include "libviconstream/pose_math.h"
+
+namespace libviconstream
+{
+namespace
+{
+/* p' = R p + t over the arrays, in registers as wide as the target has. */
+void transformArrays(double *x, double *y, double *z, const size_t n,
+                     const double r[9], const double t[3])
+{
+  size_t i = 0;
+
+#if defined(__AVX__)
+  const __m256d r0 = _mm256_set1_pd(r[0]), r1 = _mm256_set1_pd(r[1]),
+                r2 = _mm256_set1_pd(r[2]), r3 = _mm256_set1_pd(r[3]),
+                r4 = _mm256_set1_pd(r[4]), r5 = _mm256_set1_pd(r[5]),
+                r6 = _mm256_set1_pd(r[6]), r7 = _mm256_set1_pd(r[7]),
+                r8 = _mm256_set1_pd(r[8]);
+  const __m256d t0 = _mm256_set1_pd(t[0]), t1 = _mm256_set1_pd(t[1]),
+                t2 = _mm256_set1_pd(t[2]);
+
+  for (; i + 4 <= n; i += 4)
+  {
+    const __m256d px = _mm256_loadu_pd(x + i);
+    const __m256d py = _mm256_loadu_pd(y + i);
+    const __m256d pz = _mm256_loadu_pd(z + i);
+
+    _mm256_storeu_pd(
+        x + i, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(r0, px),
+                                           _mm256_mul_pd(r1, py)),
+                             _mm256_add_pd(_mm256_mul_pd(r2, pz), t0)));
+    _mm256_storeu_pd(
+        y + i, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(r3, px),
+                                           _mm256_mul_pd(r4, py)),
+                             _mm256_add_pd(_mm256_mul_pd(r5, pz), t1)));
+    _mm256_storeu_pd(
+        z + i, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(r6, px),
+                                           _mm256_mul_pd(r7, py)),
+                             _mm256_add_pd(_mm256_mul_pd(r8, pz), t2)));
+  }
+#elif defined(__SSE2__)
+  const __m128d r0 = _mm_set1_pd(r[0]), r1 = _mm_set1_pd(r[1]),
+                r2 = _mm_set1_pd(r[2]), r3 = _mm_set1_pd(r[3]),
+                r4 = _mm_set1_pd(r[4]), r5 = _mm_set1_pd(r[5]),
+                r6 = _mm_set1_pd(r[6]), r7 = _mm_set1_pd(r[7]),
+                r8 = _mm_set1_pd(r[8]);
+  const __m128d t0 = _mm_set1_pd(t[0]), t1 = _mm_set1_pd(t[1]),
+                t2 = _mm_set1_pd(t[2]);
+
+  for (; i + 2 <= n; i += 2)
+  {
+    const __m128d px = _mm_loadu_pd(x + i);
+    const __m128d py = _mm_loadu_pd(y + i);
+    const __m128d pz = _mm_loadu_pd(z + i);
+
+    _mm_storeu_pd(x + i,
+                  _mm_add_pd(_mm_add_pd(_mm_mul_pd(r0, px), _mm_mul_pd(r1, py)),
+                             _mm_add_pd(_mm_mul_pd(r2, pz), t0)));
+    _mm_storeu_pd(y + i,
+                  _mm_add_pd(_mm_add_pd(_mm_mul_pd(r3, px), _mm_mul_pd(r4, py)),
+                             _mm_add_pd(_mm_mul_pd(r5, pz), t1)));
+    _mm_storeu_pd(z + i,
+                  _mm_add_pd(_mm_add_pd(_mm_mul_pd(r6, px), _mm_mul_pd(r7, py)),
+                             _mm_add_pd(_mm_mul_pd(r8, pz), t2)));
+  }
+#endif
+
+  for (; i < n; i++)
+  {
+    const double px = x[i], py = y[i], pz = z[i];
+
+    x[i] = r[0] * px + r[1] * py + r[2] * pz + t[0];
+    y[i] = r[3] * px + r[4] * py + r[5] * pz + t[1];
+    z[i] = r[6] * px + r[7] * py + r[8] * pz + t[2];
+  }
+}
+}
+
+size_t point_cloud::size() const
+{
+  return x.size();
+}
+
+void point_cloud::clear()
+{
+  x.clear();
+  y.clear();
+  z.clear();
+}
+
+void point_cloud::assign(const frame &f)
+{
+  const size_t n = f.unlabeled_markers.size();
+
+  /* resize() keeps the capacity, so only a larger cloud allocates. */
+  x.resize(n);
+  y.resize(n);
+  z.resize(n);
+
+  const unlabeled_marker_data *src = f.unlabeled_markers.data();
+  double *px = x.data(), *py = y.data(), *pz = z.data();
+
+  for (size_t i = 0; i < n; i++)
+  {
+    px[i] = src[i].translation[0];
+    py[i] = src[i].translation[1];
+    pz[i] = src[i].translation[2];
+  }
+}
+
+void point_cloud::transform(const double rotation[9],
+                            const double translation[3])
+{
+  transformArrays(x.data(), y.data(), z.data(), size(), rotation,
+                  translation);
+}
+
+void point_cloud::transform(const pose &body)
+{
+  double r[9];
+  quatToMatrix(body.rotation, r);
+
+  transform(r, body.translation);
+}
+
+void point_cloud::inverseTransform(const pose &body)
+{
+  double r[9];
+  quatToMatrix(body.rotation, r);
+
+  /* p_body = R^T (p - t) = R^T p - R^T t */
+  const double rt[9] = {r[0], r[3], r[6], r[1], r[4], r[7], r[2], r[5], r[8]};
+  const double *t    = body.translation;
+  const double tt[3] = {-(rt[0] * t[0] + rt[1] * t[1] + rt[2] * t[2]),
+                        -(rt[3] * t[0] + rt[4] * t[1] + rt[5] * t[2]),
+                        -(rt[6] * t[0] + rt[7] * t[1] + rt[8] * t[2])};
+
+  transform(rt, tt);
+}
+
+size_t point_cloud::crop(const double min[3], const double max[3])
+{
+  const size_t n = size();
+  double *px = x.data(), *py = y.data(), *pz = z.data();
+  size_t kept = 0;
+
+  /* Every point is written and the output only advances for the ones
+   * inside, no branch to mispredict on noisy clouds. */
+  for (size_t i = 0; i < n; i++)
+  {
+    const double cx = px[i], cy = py[i], cz = pz[i];
+    const bool inside = (cx >= min[0]) & (cx <= max[0]) & (cy >= min[1]) &
+                        (cy <= max[1]) & (cz >= min[2]) & (cz <= max[2]);
+
+    px[kept] = cx;
+    py[kept] = cy;
+    pz[kept] = cz;
+    kept += inside;
+  }
+
+  x.resize(kept);
+  y.resize(kept);
+  z.resize(kept);
+
+  return kept;
+}
+
+}  // end libviconstream
@@ -0,0 +1,226 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include "libviconstream/pose_history.h"
+
+namespace libviconstream
+{
+namespace
+{
+/* Times are kept as seconds of the steady clock. */
+double seconds(const std::chrono::steady_clock::time_point &t)
+{
+  return std::chrono::duration< double >(t.time_since_epoch()).count();
+}
+
+std::chrono::steady_clock::time_point timePoint(const double t)
+{
+  return std::chrono::steady_clock::time_point(
+      std::chrono::duration_cast< std::chrono::steady_clock::duration >(
+          std::chrono::duration< double >(t)));
+}
+
+/* Readers retry this many times if the writer laps them. */
+const int read_attempts = 4;
+}
+
+history_settings::history_settings() : subjects(64), depth(256), max_gap(0.1)
+{
+}
+
+/*********************************
+ * Private members
+ ********************************/
+
+void pose_history::load(const size_t slot, pose &p) const
+{
+  const std::atomic< double > *v = &_poses[slot * stride];
+
+  for (int i = 0; i < 3; i++)
+    p.translation[i] = v[i].load(std::memory_order_relaxed);
+
+  for (int i = 0; i < 4; i++)
+    p.rotation[i] = v[3 + i].load(std::memory_order_relaxed);
+
+  p.occluded = v[7].load(std::memory_order_relaxed) != 0;
+}
+
+/*********************************
+ * Public members
+ ********************************/
+
+pose_history::pose_history(const history_settings &settings)
+    : _settings(settings)
+{
+  size_t depth = 2;
+  while (depth < _settings.depth)
+    depth *= 2;
+
+  _settings.depth = depth;
+  _mask           = depth - 1;
+
+  _rings  = std::vector< ring >(_settings.subjects);
+  _times  = std::vector< std::atomic< double > >(_settings.subjects * depth);
+  _poses  = std::vector< std::atomic< double > >(_settings.subjects * depth *
+                                                 stride);
+}
+
+void pose_history::record(const frame &f)
+{
+  if (!f.handles)
+    return;
+
+  const double t = seconds(f.latency.received) - f.latency.server_total;
+  const size_t n = std::min(f.handles->subjects.size(), _rings.size());
+
+  for (size_t id = 0; id < n; id++)
+  {
+    const subject_handle h = {static_cast< uint32_t >(id)};
+    const pose *sp         = f.subjectPose(h);
+    ring &r                = _rings[id];
+
+    /* Lookups need strictly increasing times. */
+    if (sp == nullptr || (r.head.load(std::memory_order_relaxed) > 0 &&
+                          t <= r.last))
+      continue;
+
+    const uint64_t k  = r.head.load(std::memory_order_relaxed);
+    const size_t slot = id * _settings.depth + (k & _mask);
+
+    /* Readers who see any of the new values also see that the slot's old
+     * sample is gone. */
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::atomic< double > *v = &_poses[slot * stride];
+
+    for (int i = 0; i < 3; i++)
+      v[i].store(sp->translation[i], std::memory_order_relaxed);
+
+    for (int i = 0; i < 4; i++)
+      v[3 + i].store(sp->rotation[i], std::memory_order_relaxed);
+
+    v[7].store(sp->occluded ? 1 : 0, std::memory_order_relaxed);
+    _times[slot].store(t, std::memory_order_relaxed);
+
+    r.last = t;
+    r.head.store(k + 1, std::memory_order_release);
+  }
+}
+
+bool pose_history::poseAt(const subject_handle subject,
+                          const std::chrono::steady_clock::time_point &t,
+                          pose &p, const Interpolation::Enum mode) const
+{
+  if (subject.id >= _rings.size())
+    return false;
+
+  const size_t base = subject.id * _settings.depth;
+  const double tq   = seconds(t);
+
+  for (int attempt = 0; attempt < read_attempts; attempt++)
+  {
+    const uint64_t h = _rings[subject.id].head.load(std::memory_order_acquire);
+
+    if (h == 0)
+      return false;
+
+    /* The slot after the newest may be being overwritten. */
+    const uint64_t lo = h >= _settings.depth ? h - _settings.depth + 1 : 0;
+    uint64_t l = lo, r = h - 1;
+
+    const double t_lo =
+        _times[base + (l & _mask)].load(std::memory_order_relaxed);
+    const double t_hi =
+        _times[base + (r & _mask)].load(std::memory_order_relaxed);
+    const bool inside = tq >= t_lo && tq <= t_hi;
+
+    double t0 = t_lo, t1 = t_hi;
+    pose p0, p1;
+
+    if (inside)
+    {
+      /* Find neighbours with t0 <= tq <= t1. */
+      while (r - l > 1)
+      {
+        const uint64_t m = l + (r - l) / 2;
+
+        if (_times[base + (m & _mask)].load(std::memory_order_relaxed) <= tq)
+          l = m;
+        else
+          r = m;
+      }
+
+      t0 = _times[base + (l & _mask)].load(std::memory_order_relaxed);
+      t1 = _times[base + (r & _mask)].load(std::memory_order_relaxed);
+      load(base + (l & _mask), p0);
+      load(base + (r & _mask), p1);
+    }
+
+    /* Retry if the writer lapped the oldest sample read. */
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t h2 = _rings[subject.id].head.load(std::memory_order_relaxed);
+
+    if (h2 >= _settings.depth && lo < h2 - _settings.depth + 1)
+      continue;
+
+    if (!inside)
+      return false;
+
+    if (_settings.max_gap > 0 && t1 - t0 > _settings.max_gap)
+      return false;
+
+    const double alpha = t1 > t0 ? (tq - t0) / (t1 - t0) : 0;
+    interpolatePose(p0, p1, alpha, mode, p);
+
+    return !p.occluded;
+  }
+
+  return false;
+}
+
+bool pose_history::span(const subject_handle subject,
+                        std::chrono::steady_clock::time_point &oldest,
+                        std::chrono::steady_clock::time_point &newest) const
+{
+  if (subject.id >= _rings.size())
+    return false;
+
+  const size_t base = subject.id * _settings.depth;
+
+  for (int attempt = 0; attempt < read_attempts; attempt++)
+  {
+    const uint64_t h = _rings[subject.id].head.load(std::memory_order_acquire);
+
+    if (h == 0)
+      return false;
+
+    const uint64_t lo = h >= _settings.depth ? h - _settings.depth + 1 : 0;
+    const double t_lo =
+        _times[base + (lo & _mask)].load(std::memory_order_relaxed);
+    const double t_hi =
+        _times[base + ((h - 1) & _mask)].load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t h2 = _rings[subject.id].head.load(std::memory_order_relaxed);
+
+    if (h2 >= _settings.depth && lo < h2 - _settings.depth + 1)
+      continue;
+
+    oldest = timePoint(t_lo);
+    newest = timePoint(t_hi);
+
+    return true;
+  }
+
+  return false;
+}
+
+const history_settings &pose_history::settings() const
+{
+  return _settings;
+}
+
+}  // end libviconstream
@@ -0,0 +1,212 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cmath>
+#include "libviconstream/pose_math.h"
+
+namespace libviconstream
+{
+void quatMultiply(const double a[4], const double b[4], double r[4])
+{
+  const double x = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+  const double y = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+  const double z = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+  const double w = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+
+  r[0] = x;
+  r[1] = y;
+  r[2] = z;
+  r[3] = w;
+}
+
+void quatNormalize(double q[4])
+{
+  const double n = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] +
+                             q[3] * q[3]);
+
+  if (n > 0)
+  {
+    for (int i = 0; i < 4; i++)
+      q[i] /= n;
+  }
+}
+
+void quatToMatrix(const double q[4], double r[9])
+{
+  const double x = q[0], y = q[1], z = q[2], w = q[3];
+
+  r[0] = 1 - 2 * (y * y + z * z);
+  r[1] = 2 * (x * y - z * w);
+  r[2] = 2 * (x * z + y * w);
+  r[3] = 2 * (x * y + z * w);
+  r[4] = 1 - 2 * (x * x + z * z);
+  r[5] = 2 * (y * z - x * w);
+  r[6] = 2 * (x * z - y * w);
+  r[7] = 2 * (y * z + x * w);
+  r[8] = 1 - 2 * (x * x + y * y);
+}
+
+void angularVelocity(const double q0[4], const double q1[4], const double dt,
+                     double w[3])
+{
+  /* dq = q1 * conj(q0) is the rotation from q0 to q1 in the world frame. */
+  const double q0c[4] = {-q0[0], -q0[1], -q0[2], q0[3]};
+  double dq[4];
+  quatMultiply(q1, q0c, dq);
+
+  /* Take the short way around. */
+  if (dq[3] < 0)
+  {
+    for (int i = 0; i < 4; i++)
+      dq[i] = -dq[i];
+  }
+
+  const double s = std::sqrt(dq[0] * dq[0] + dq[1] * dq[1] + dq[2] * dq[2]);
+
+  if (s < 1e-12 || dt <= 0)
+  {
+    w[0] = w[1] = w[2] = 0;
+    return;
+  }
+
+  const double angle = 2 * std::atan2(s, dq[3]);
+
+  for (int i = 0; i < 3; i++)
+    w[i] = dq[i] / s * angle / dt;
+}
+
+void integrateRotation(const double q[4], const double w[3], const double dt,
+                       double r[4])
+{
+  const double rate = std::sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+  const double half = 0.5 * rate * dt;
+
+  if (rate < 1e-12)
+  {
+    for (int i = 0; i < 4; i++)
+      r[i] = q[i];
+
+    return;
+  }
+
+  const double s     = std::sin(half) / rate;
+  const double dq[4] = {w[0] * s, w[1] * s, w[2] * s, std::cos(half)};
+
+  quatMultiply(dq, q, r);
+  quatNormalize(r);
+}
+
+void quatSlerp(const double q0[4], const double q1[4], const double alpha,
+               double r[4])
+{
+  double dot = q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3];
+  double sign = 1;
+
+  if (dot < 0)
+  {
+    dot  = -dot;
+    sign = -1;
+  }
+
+  double w0 = 1 - alpha, w1 = alpha;
+
+  /* Close orientations interpolate linearly, avoiding the division. */
+  if (dot < 0.9995)
+  {
+    const double theta = std::acos(dot);
+    const double s     = std::sin(theta);
+
+    w0 = std::sin((1 - alpha) * theta) / s;
+    w1 = std::sin(alpha * theta) / s;
+  }
+
+  for (int i = 0; i < 4; i++)
+    r[i] = w0 * q0[i] + sign * w1 * q1[i];
+
+  quatNormalize(r);
+}
+
+void interpolatePose(const pose &p0, const pose &p1, const double alpha,
+                     const Interpolation::Enum mode, pose &p)
+{
+  for (int i = 0; i < 3; i++)
+    p.translation[i] =
+        p0.translation[i] + alpha * (p1.translation[i] - p0.translation[i]);
+
+  if (mode == Interpolation::Slerp)
+    quatSlerp(p0.rotation, p1.rotation, alpha, p.rotation);
+  else
+  {
+    const double dot = p0.rotation[0] * p1.rotation[0] +
+                       p0.rotation[1] * p1.rotation[1] +
+                       p0.rotation[2] * p1.rotation[2] +
+                       p0.rotation[3] * p1.rotation[3];
+    const double sign = dot < 0 ? -1 : 1;
+
+    for (int i = 0; i < 4; i++)
+      p.rotation[i] = (1 - alpha) * p0.rotation[i] +
+                      sign * alpha * p1.rotation[i];
+
+    quatNormalize(p.rotation);
+  }
+
+  p.occluded = p0.occluded || p1.occluded;
+}
+
+bool extrapolatePose(const pose *const samples[], const double times[],
+                     const unsigned int count, const double t,
+                     const Prediction::Enum model, pose &p)
+{
+  if (count == 0 || samples[0]->occluded)
+    return false;
+
+  /* Use the usable prefix of the samples. */
+  unsigned int n = 1;
+  while (n < count && !samples[n]->occluded && times[n] < times[n - 1])
+    n++;
+
+  if (model == Prediction::ConstantVelocity && n > 2)
+    n = 2;
+
+  const pose &p0 = *samples[0];
+  const double h = t - times[0];
+
+  p = p0;
+
+  if (n == 1)
+    return true;
+
+  const pose &p1   = *samples[1];
+  const double dt1 = times[0] - times[1];
+
+  for (int i = 0; i < 3; i++)
+  {
+    const double v1 = (p0.translation[i] - p1.translation[i]) / dt1;
+
+    if (n == 3)
+    {
+      /* Velocities at the interval midpoints give the acceleration. */
+      const pose &p2   = *samples[2];
+      const double dt2 = times[1] - times[2];
+      const double v2  = (p1.translation[i] - p2.translation[i]) / dt2;
+      const double a   = (v1 - v2) / (0.5 * (dt1 + dt2));
+
+      /* v1 is the velocity half an interval back, advance it to now. */
+      const double v0 = v1 + a * 0.5 * dt1;
+
+      p.translation[i] = p0.translation[i] + v0 * h + 0.5 * a * h * h;
+    }
+    else
+      p.translation[i] = p0.translation[i] + v1 * h;
+  }
+
+  double w[3];
+  angularVelocity(p1.rotation, p0.rotation, dt1, w);
+  integrateRotation(p0.rotation, w, h, p.rotation);
+
+  return true;
+}
+
+}  // end libviconstream
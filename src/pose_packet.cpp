@@ -0,0 +1,175 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstring>
+#include <algorithm>
+#include "libviconstream/pose_packet.h"
+
+namespace libviconstream
+{
+namespace
+{
+/* Explicit little endian, independent of the host's byte order. */
+void put16(uint8_t *out, const uint16_t v)
+{
+  out[0] = static_cast< uint8_t >(v);
+  out[1] = static_cast< uint8_t >(v >> 8);
+}
+
+void put32(uint8_t *out, const uint32_t v)
+{
+  out[0] = static_cast< uint8_t >(v);
+  out[1] = static_cast< uint8_t >(v >> 8);
+  out[2] = static_cast< uint8_t >(v >> 16);
+  out[3] = static_cast< uint8_t >(v >> 24);
+}
+
+void putFloat(uint8_t *out, const float v)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  put32(out, bits);
+}
+
+uint16_t get16(const uint8_t *in)
+{
+  return static_cast< uint16_t >(in[0] | (in[1] << 8));
+}
+
+uint32_t get32(const uint8_t *in)
+{
+  return static_cast< uint32_t >(in[0]) |
+         (static_cast< uint32_t >(in[1]) << 8) |
+         (static_cast< uint32_t >(in[2]) << 16) |
+         (static_cast< uint32_t >(in[3]) << 24);
+}
+
+float getFloat(const uint8_t *in)
+{
+  const uint32_t bits = get32(in);
+  float v;
+  std::memcpy(&v, &bits, sizeof(v));
+
+  return v;
+}
+}
+
+size_t encodePacketHeader(const packet_header &h, uint8_t *out)
+{
+  put32(out, pose_packet_magic);
+  out[4] = pose_packet_version;
+  out[5] = h.type;
+  out[6] = h.fragment;
+  out[7] = h.fragments;
+  put32(out + 8, h.frame_number);
+  put32(out + 12, h.age_us);
+  putFloat(out + 16, h.frame_rate);
+  put16(out + 20, h.count);
+  put16(out + 22, 0);
+
+  return pose_packet_header_size;
+}
+
+size_t encodePacketPose(const packet_pose &p, uint8_t *out)
+{
+  put16(out, p.id);
+  out[2] = p.occluded ? 1 : 0;
+  out[3] = 0;
+
+  for (int i = 0; i < 3; i++)
+    putFloat(out + 4 + 4 * i, p.translation[i]);
+
+  for (int i = 0; i < 4; i++)
+    putFloat(out + 16 + 4 * i, p.rotation[i]);
+
+  return pose_packet_pose_size;
+}
+
+size_t packetNameSize(const std::string &name)
+{
+  return 3 + std::min< size_t >(name.size(), 255);
+}
+
+size_t encodePacketName(const uint16_t id, const std::string &name,
+                        uint8_t *out)
+{
+  const size_t length = std::min< size_t >(name.size(), 255);
+
+  put16(out, id);
+  out[2] = static_cast< uint8_t >(length);
+  std::memcpy(out + 3, name.data(), length);
+
+  return 3 + length;
+}
+
+bool decodePacketHeader(const uint8_t *data, const size_t size,
+                        packet_header &h)
+{
+  if (size < pose_packet_header_size || get32(data) != pose_packet_magic ||
+      data[4] != pose_packet_version)
+    return false;
+
+  h.type         = data[5];
+  h.fragment     = data[6];
+  h.fragments    = data[7];
+  h.frame_number = get32(data + 8);
+  h.age_us       = get32(data + 12);
+  h.frame_rate   = getFloat(data + 16);
+  h.count        = get16(data + 20);
+
+  return h.fragment < h.fragments;
+}
+
+bool decodePacketPoses(const uint8_t *data, const size_t size,
+                       const packet_header &h,
+                       std::vector< packet_pose > &poses)
+{
+  if (size < pose_packet_header_size + h.count * pose_packet_pose_size)
+    return false;
+
+  const uint8_t *in = data + pose_packet_header_size;
+
+  for (unsigned int i = 0; i < h.count; i++, in += pose_packet_pose_size)
+  {
+    packet_pose p;
+    p.id       = get16(in);
+    p.occluded = in[2] != 0;
+
+    for (int j = 0; j < 3; j++)
+      p.translation[j] = getFloat(in + 4 + 4 * j);
+
+    for (int j = 0; j < 4; j++)
+      p.rotation[j] = getFloat(in + 16 + 4 * j);
+
+    poses.push_back(p);
+  }
+
+  return true;
+}
+
+bool decodePacketNames(const uint8_t *data, const size_t size,
+                       const packet_header &h,
+                       std::vector< packet_name > &names)
+{
+  size_t offset = pose_packet_header_size;
+
+  for (unsigned int i = 0; i < h.count; i++)
+  {
+    if (offset + 3 > size || offset + 3 + data[offset + 2] > size)
+      return false;
+
+    packet_name n;
+    n.id = get16(data + offset);
+    n.name.assign(reinterpret_cast< const char * >(data + offset + 3),
+                  data[offset + 2]);
+    names.push_back(n);
+
+    offset += 3 + data[offset + 2];
+  }
+
+  return true;
+}
+
+}  // end libviconstream
@@ -0,0 +1,282 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+/* POSIX sockets. */
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "libviconstream/pose_receiver.h"
+
+namespace libviconstream
+{
+namespace
+{
+const std::string no_name;
+
+/* Frames further back than this are from a restarted server, not late. */
+const uint32_t restart_frames = 1000;
+
+/* Checks if a frame number is a late or duplicate one of the newest. */
+bool isStale(const uint32_t frame_number, const uint32_t newest)
+{
+  return frame_number <= newest && newest - frame_number < restart_frames;
+}
+}
+
+/*********************************
+ * Private members
+ ********************************/
+
+bool pose_receiver::handle(const size_t size)
+{
+  packet_header h;
+
+  if (!decodePacketHeader(_buffer.data(), size, h))
+  {
+    _rejected++;
+    return false;
+  }
+
+  if (h.type == PacketType::Names)
+  {
+    std::vector< packet_name > names;
+
+    if (!decodePacketNames(_buffer.data(), size, h, names))
+    {
+      _rejected++;
+      return false;
+    }
+
+    for (const auto &n : names)
+    {
+      if (n.id >= _names.size())
+        _names.resize(n.id + 1);
+
+      _names[n.id] = n.name;
+    }
+
+    return false;
+  }
+
+  if (h.type != PacketType::Poses)
+  {
+    _rejected++;
+    return false;
+  }
+
+  /* A packet of a newer frame abandons the pending one, late packets of
+     older frames are ignored. */
+  if (_missing == 0 && _frames > 0 && isStale(h.frame_number, _last))
+    return false;
+
+  if (_missing == 0 || h.frame_number != _pending.frame_number)
+  {
+    if (_missing > 0 && isStale(h.frame_number, _pending.frame_number))
+      return false;
+
+    if (_missing > 0)
+      _incomplete++;
+
+    _pending.frame_number = h.frame_number;
+    _pending.frame_rate   = h.frame_rate;
+    _pending.age_us       = h.age_us;
+    _pending.poses.clear();
+    _fragments.assign(h.fragments, 0);
+    _missing = h.fragments;
+  }
+
+  if (h.fragment >= _fragments.size() || _fragments[h.fragment])
+    return false;
+
+  if (!decodePacketPoses(_buffer.data(), size, h, _pending.poses))
+  {
+    _rejected++;
+    return false;
+  }
+
+  _fragments[h.fragment] = 1;
+
+  if (--_missing > 0)
+    return false;
+
+  _pending.received = std::chrono::steady_clock::now();
+  _last             = _pending.frame_number;
+  _frames++;
+
+  return true;
+}
+
+/*********************************
+ * Public members
+ ********************************/
+
+pose_receiver::pose_receiver()
+    : _fd(-1),
+      _buffer(pose_packet_max_size),
+      _missing(0),
+      _last(0),
+      _frames(0),
+      _incomplete(0),
+      _rejected(0)
+{
+}
+
+pose_receiver::~pose_receiver()
+{
+  close();
+}
+
+bool pose_receiver::open(const uint16_t port, const std::string &group,
+                         const std::string &interface)
+{
+  close();
+
+  _fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+
+  if (_fd < 0)
+    return false;
+
+  /* Several receivers on one host can share a multicast port. */
+  const int on = 1;
+  ::setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family      = AF_INET;
+  addr.sin_port        = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+  if (::bind(_fd, reinterpret_cast< sockaddr * >(&addr), sizeof(addr)) != 0)
+  {
+    close();
+    return false;
+  }
+
+  if (!group.empty())
+  {
+    ip_mreq mreq;
+    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+
+    if (::inet_pton(AF_INET, group.c_str(), &mreq.imr_multiaddr) != 1 ||
+        (!interface.empty() &&
+         ::inet_pton(AF_INET, interface.c_str(), &mreq.imr_interface) != 1) ||
+        ::setsockopt(_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq,
+                     sizeof(mreq)) != 0)
+    {
+      close();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void pose_receiver::close()
+{
+  if (_fd >= 0)
+    ::close(_fd);
+
+  _fd      = -1;
+  _missing = 0;
+}
+
+bool pose_receiver::isOpen() const
+{
+  return _fd >= 0;
+}
+
+bool pose_receiver::receive(received_frame &f, const int timeout_ms)
+{
+  if (!isOpen())
+    return false;
+
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(timeout_ms);
+
+  while (true)
+  {
+    const ssize_t n =
+        ::recv(_fd, _buffer.data(), _buffer.size(), MSG_DONTWAIT);
+
+    if (n >= 0)
+    {
+      if (handle(static_cast< size_t >(n)))
+      {
+        std::swap(f, _pending);
+        return true;
+      }
+
+      continue;
+    }
+
+    if (errno == EINTR)
+      continue;
+
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+      return false;
+
+    int wait = -1;
+
+    if (timeout_ms >= 0)
+    {
+      const auto left =
+          std::chrono::duration_cast< std::chrono::milliseconds >(
+              deadline - std::chrono::steady_clock::now())
+              .count();
+
+      if (left <= 0)
+        return false;
+
+      wait = static_cast< int >(left);
+    }
+
+    pollfd p;
+    p.fd     = _fd;
+    p.events = POLLIN;
+
+    if (::poll(&p, 1, wait) < 0 && errno != EINTR)
+      return false;
+  }
+}
+
+const std::string &pose_receiver::name(const uint16_t id) const
+{
+  return id < _names.size() ? _names[id] : no_name;
+}
+
+int pose_receiver::find(const std::string &name) const
+{
+  for (size_t i = 0; i < _names.size(); i++)
+  {
+    if (_names[i] == name)
+      return static_cast< int >(i);
+  }
+
+  return -1;
+}
+
+uint64_t pose_receiver::framesReceived() const
+{
+  return _frames;
+}
+
+uint64_t pose_receiver::framesIncomplete() const
+{
+  return _incomplete;
+}
+
+uint64_t pose_receiver::packetsRejected() const
+{
+  return _rejected;
+}
+
+}  // end libviconstream
@@ -0,0 +1,129 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cerrno>
+#include <cstring>
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "libviconstream/realtime.h"
+
+namespace libviconstream
+{
+namespace
+{
+const size_t page_size = 4096;
+
+/* Appends a failure and its cause, with the privilege it usually lacks. */
+void appendError(std::string &errors, const std::string &what,
+                 const int error, const char *privilege)
+{
+  if (!errors.empty())
+    errors += ", ";
+
+  errors += what + ": " + std::strerror(error);
+
+  if (error == EPERM || error == ENOMEM)
+    errors += std::string(" (needs ") + privilege + ")";
+}
+
+/* The stack is released on return, its pages stay mapped. */
+__attribute__((noinline)) void prefaultStack(const size_t size)
+{
+  volatile char *stack = static_cast< volatile char * >(alloca(size));
+
+  for (size_t i = 0; i < size; i += page_size)
+    stack[i] = 0;
+}
+}
+
+/*********************************
+ * Public members
+ ********************************/
+
+thread_settings::thread_settings()
+    : policy(SchedPolicy::Default), priority(0), stack_prefault(0)
+{
+}
+
+realtime_settings::realtime_settings() : lock_memory(false)
+{
+}
+
+bool applyThreadSettings(const thread_settings &settings,
+                         std::string &errors)
+{
+  errors.clear();
+
+  if (!settings.cpus.empty())
+  {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    for (const int cpu : settings.cpus)
+    {
+      if (cpu >= 0 && cpu < CPU_SETSIZE)
+        CPU_SET(cpu, &set);
+    }
+
+    const int r =
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+
+    if (r != 0)
+      appendError(errors, "CPU affinity", r, "CAP_SYS_NICE");
+  }
+
+  if (settings.policy != SchedPolicy::Default)
+  {
+    const int policy =
+        settings.policy == SchedPolicy::Fifo ? SCHED_FIFO : SCHED_RR;
+
+    sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    param.sched_priority = settings.priority;
+
+    const int r = pthread_setschedparam(pthread_self(), policy, &param);
+
+    if (r != 0)
+      appendError(errors,
+                  std::string(policy == SCHED_FIFO ? "SCHED_FIFO"
+                                                   : "SCHED_RR") +
+                      " priority " + std::to_string(settings.priority),
+                  r, "CAP_SYS_NICE or an rtprio limit");
+  }
+
+  if (settings.stack_prefault > 0)
+    prefaultStack(settings.stack_prefault);
+
+  return errors.empty();
+}
+
+bool isRealtimeThread()
+{
+  int policy;
+  sched_param param;
+
+  if (pthread_getschedparam(pthread_self(), &policy, &param) != 0)
+    return false;
+
+  return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
+bool lockMemory(std::string &errors)
+{
+  errors.clear();
+
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+  {
+    appendError(errors, "mlockall", errno,
+                "CAP_IPC_LOCK or a memlock limit");
+    return false;
+  }
+
+  return true;
+}
+
+}  // end libviconstream
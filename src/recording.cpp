@@ -0,0 +1,436 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+/* POSIX file and memory mapping. */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libviconstream/recording.h"
+#include "libviconstream/frame_codec.h"
+#include "libviconstream/viconstream.h"
+
+namespace libviconstream
+{
+/*********************************
+ * Recorder private members
+ ********************************/
+
+void recorder::appendRecord(const RecordType::Enum type, const void *payload,
+                            const size_t size)
+{
+  /* The offsets of later records would not match the file. */
+  if (failed())
+    return;
+
+  record_header h;
+  h.type = type;
+  h.size = static_cast< uint32_t >(size);
+
+  const uint8_t *hp = reinterpret_cast< const uint8_t * >(&h);
+  const uint8_t *pp = static_cast< const uint8_t * >(payload);
+
+  _buffer.insert(_buffer.end(), hp, hp + sizeof(h));
+  _buffer.insert(_buffer.end(), pp, pp + size);
+
+  _offset += sizeof(h) + size;
+
+  if (_buffer.size() >= _buffer_size)
+    flush();
+}
+
+void recorder::writeIndex()
+{
+  if (_pending.empty())
+    return;
+
+  index_header ih;
+  ih.previous = _last_index;
+  ih.count    = static_cast< uint32_t >(_pending.size());
+  ih.reserved = 0;
+
+  _scratch.clear();
+  _scratch.insert(_scratch.end(), reinterpret_cast< const uint8_t * >(&ih),
+                  reinterpret_cast< const uint8_t * >(&ih + 1));
+  _scratch.insert(
+      _scratch.end(), reinterpret_cast< const uint8_t * >(_pending.data()),
+      reinterpret_cast< const uint8_t * >(_pending.data() + _pending.size()));
+
+  _last_index = _offset;
+  _pending.clear();
+
+  appendRecord(RecordType::Index, _scratch.data(), _scratch.size());
+}
+
+bool recorder::flush()
+{
+  size_t written = 0;
+
+  while (written < _buffer.size())
+  {
+    const ssize_t n =
+        ::write(_fd, _buffer.data() + written, _buffer.size() - written);
+
+    if (n < 0 && errno == EINTR)
+      continue;
+
+    /* What was written is lost from the offsets, the file is corrupt. */
+    if (n <= 0)
+    {
+      _bytes.fetch_add(written, std::memory_order_relaxed);
+      _failed.store(true, std::memory_order_relaxed);
+      _buffer.clear();
+      return false;
+    }
+
+    written += n;
+  }
+
+  _bytes.fetch_add(written, std::memory_order_relaxed);
+  _buffer.clear();
+
+  return true;
+}
+
+/*********************************
+ * Recorder public members
+ ********************************/
+
+recorder::recorder(const std::string &path, const uint32_t index_interval,
+                   const size_t buffer_size)
+    : _fd(-1),
+      _index_interval(std::max< uint32_t >(index_interval, 1)),
+      _buffer_size(buffer_size),
+      _offset(0),
+      _last_index(0),
+      _arbiter(nullptr),
+      _id(0),
+      _frames(0),
+      _bytes(0),
+      _failed(false)
+{
+  _fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+  if (_fd < 0)
+    return;
+
+  _buffer.reserve(buffer_size + (64 << 10));
+  _pending.reserve(_index_interval);
+
+  file_header fh;
+  std::memcpy(fh.magic, recording_magic, sizeof(fh.magic));
+  fh.version        = recording_version;
+  fh.codec_version  = frame_codec_version;
+  fh.index_interval = _index_interval;
+  fh.reserved       = 0;
+
+  const uint8_t *p = reinterpret_cast< const uint8_t * >(&fh);
+  _buffer.insert(_buffer.end(), p, p + sizeof(fh));
+  _offset = sizeof(fh);
+}
+
+recorder::~recorder()
+{
+  close();
+}
+
+bool recorder::isOpen() const
+{
+  return _fd >= 0;
+}
+
+bool recorder::attach(arbiter &a, const size_t queue_size)
+{
+  if (!isOpen() || _arbiter != nullptr)
+    return false;
+
+  _arbiter = &a;
+  _id      = a.registerCallback([this](const frame &f) { record(f); },
+                                DispatchMode::Async, queue_size,
+                                OverflowPolicy::DropNewest);
+
+  return true;
+}
+
+void recorder::detach()
+{
+  if (_arbiter == nullptr)
+    return;
+
+  /* Joins the worker, no record() is running after this. */
+  _arbiter->unregisterCallback(_id);
+  _arbiter = nullptr;
+}
+
+void recorder::record(const frame &f)
+{
+  if (!isOpen() || failed())
+    return;
+
+  index_entry e;
+  e.frame_number = f.frame_number;
+  e.reserved     = 0;
+  e.offset       = _offset;
+  _pending.push_back(e);
+
+  _scratch.clear();
+  encodeFrame(f, _scratch);
+  appendRecord(RecordType::Frame, _scratch.data(), _scratch.size());
+
+  _frames.fetch_add(1, std::memory_order_relaxed);
+
+  if (_pending.size() >= _index_interval)
+    writeIndex();
+}
+
+bool recorder::close()
+{
+  detach();
+
+  if (!isOpen())
+    return false;
+
+  /* A failed recording gets no footer, readers recover it by scanning up
+     to the failure. */
+  if (!failed())
+  {
+    writeIndex();
+
+    footer ft;
+    ft.last_index  = _last_index;
+    ft.frame_count = _frames.load();
+    appendRecord(RecordType::Footer, &ft, sizeof(ft));
+
+    flush();
+  }
+
+  if (::close(_fd) != 0)
+    _failed.store(true, std::memory_order_relaxed);
+
+  _fd = -1;
+
+  return !failed();
+}
+
+bool recorder::failed() const
+{
+  return _failed.load(std::memory_order_relaxed);
+}
+
+uint64_t recorder::framesRecorded() const
+{
+  return _frames.load(std::memory_order_relaxed);
+}
+
+uint64_t recorder::bytesWritten() const
+{
+  return _bytes.load(std::memory_order_relaxed);
+}
+
+/*********************************
+ * Reader private members
+ ********************************/
+
+bool recording_reader::loadIndex()
+{
+  const size_t footer_size = sizeof(record_header) + sizeof(footer);
+
+  if (_size < sizeof(file_header) + footer_size)
+    return false;
+
+  record_header rh;
+  footer ft;
+  std::memcpy(&rh, _data + _size - footer_size, sizeof(rh));
+  std::memcpy(&ft, _data + _size - sizeof(ft), sizeof(ft));
+
+  if (rh.type != RecordType::Footer || rh.size != sizeof(footer))
+    return false;
+
+  /* Walk the chain of index records backwards. */
+  std::vector< std::vector< index_entry > > chunks;
+  uint64_t offset = ft.last_index;
+  uint64_t total  = 0;
+
+  while (offset != 0)
+  {
+    index_header ih;
+
+    if (offset + sizeof(rh) + sizeof(ih) > _size)
+      return false;
+
+    std::memcpy(&rh, _data + offset, sizeof(rh));
+    std::memcpy(&ih, _data + offset + sizeof(rh), sizeof(ih));
+
+    if (rh.type != RecordType::Index || ih.previous >= offset ||
+        rh.size != sizeof(ih) + uint64_t(ih.count) * sizeof(index_entry) ||
+        offset + sizeof(rh) + rh.size > _size)
+      return false;
+
+    const uint8_t *entries = _data + offset + sizeof(rh) + sizeof(ih);
+    chunks.emplace_back(ih.count);
+    std::memcpy(chunks.back().data(), entries,
+                ih.count * sizeof(index_entry));
+
+    total += ih.count;
+    offset = ih.previous;
+  }
+
+  if (total != ft.frame_count)
+    return false;
+
+  _index.reserve(total);
+
+  for (auto it = chunks.rbegin(); it != chunks.rend(); ++it)
+    _index.insert(_index.end(), it->begin(), it->end());
+
+  return true;
+}
+
+void recording_reader::scanIndex()
+{
+  uint64_t offset = sizeof(file_header);
+
+  while (offset + sizeof(record_header) <= _size)
+  {
+    record_header rh;
+    std::memcpy(&rh, _data + offset, sizeof(rh));
+
+    /* A truncated last record is the end of the recording. */
+    if (offset + sizeof(rh) + rh.size > _size)
+      break;
+
+    if (rh.type == RecordType::Frame && rh.size >= sizeof(uint32_t))
+    {
+      index_entry e;
+      std::memcpy(&e.frame_number, _data + offset + sizeof(rh),
+                  sizeof(e.frame_number));
+      e.reserved = 0;
+      e.offset   = offset;
+      _index.push_back(e);
+    }
+
+    offset += sizeof(rh) + rh.size;
+  }
+}
+
+/*********************************
+ * Reader public members
+ ********************************/
+
+recording_reader::recording_reader() : _data(nullptr), _size(0)
+{
+}
+
+recording_reader::~recording_reader()
+{
+  close();
+}
+
+bool recording_reader::open(const std::string &path)
+{
+  close();
+
+  const int fd = ::open(path.c_str(), O_RDONLY);
+
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+
+  if (::fstat(fd, &st) != 0 ||
+      static_cast< size_t >(st.st_size) < sizeof(file_header))
+  {
+    ::close(fd);
+    return false;
+  }
+
+  void *p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+
+  if (p == MAP_FAILED)
+    return false;
+
+  _data = static_cast< const uint8_t * >(p);
+  _size = st.st_size;
+
+  file_header fh;
+  std::memcpy(&fh, _data, sizeof(fh));
+
+  if (std::memcmp(fh.magic, recording_magic, sizeof(fh.magic)) != 0 ||
+      fh.version != recording_version ||
+      fh.codec_version != frame_codec_version)
+  {
+    close();
+    return false;
+  }
+
+  /* Sequential access pays off when replaying. */
+  ::madvise(const_cast< uint8_t * >(_data), _size, MADV_SEQUENTIAL);
+
+  if (!loadIndex())
+  {
+    _index.clear();
+    scanIndex();
+  }
+
+  return true;
+}
+
+void recording_reader::close()
+{
+  if (_data != nullptr)
+    ::munmap(const_cast< uint8_t * >(_data), _size);
+
+  _data = nullptr;
+  _size = 0;
+  _index.clear();
+}
+
+size_t recording_reader::frameCount() const
+{
+  return _index.size();
+}
+
+unsigned int recording_reader::frameNumber(const size_t index) const
+{
+  return _index[index].frame_number;
+}
+
+size_t recording_reader::find(const unsigned int frame_number) const
+{
+  auto it = std::lower_bound(
+      _index.begin(), _index.end(), frame_number,
+      [](const index_entry &e, const unsigned int fn) {
+        return e.frame_number < fn;
+      });
+
+  return it - _index.begin();
+}
+
+bool recording_reader::read(const size_t index, frame &f) const
+{
+  if (index >= _index.size())
+    return false;
+
+  const uint64_t offset = _index[index].offset;
+  record_header rh;
+
+  if (offset + sizeof(rh) > _size)
+    return false;
+
+  std::memcpy(&rh, _data + offset, sizeof(rh));
+
+  if (rh.type != RecordType::Frame || offset + sizeof(rh) + rh.size > _size)
+    return false;
+
+  return decodeFrame(_data + offset + sizeof(rh), rh.size, f);
+}
+
+}  // end libviconstream
@@ -0,0 +1,203 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <thread>
+#include "libviconstream/replay_source.h"
+
+namespace libviconstream
+{
+/*********************************
+ * Private members
+ ********************************/
+
+void replay_source::jumpTo(const size_t index)
+{
+  _next = index;
+
+  if (index >= _reader.frameCount())
+    return;
+
+  /* The target frame follows the last delivered frame without a gap. */
+  const unsigned int recorded = _reader.frameNumber(index);
+  _offset = static_cast< int64_t >(_current) + 1 - recorded;
+
+  _base_time  = std::chrono::steady_clock::now();
+  _base_frame = recorded;
+}
+
+/*********************************
+ * Public members
+ ********************************/
+
+replay_source::replay_source(const std::string &path,
+                             const ReplayMode::Enum mode, const double speed,
+                             const bool loop)
+    : _path(path),
+      _mode(mode),
+      _speed(mode == ReplayMode::RealTime ? 1.0 : speed),
+      _loop(loop),
+      _rate(0),
+      _connected(false),
+      _index(0),
+      _next(0),
+      _offset(0),
+      _current(0),
+      _base_frame(0),
+      _seek(-1),
+      _replayed(0),
+      _finished(false),
+      _elapsed(0)
+{
+}
+
+bool replay_source::connect()
+{
+  if (!_reader.open(_path) || _reader.frameCount() == 0)
+    return false;
+
+  /* The rate is taken from the first frame. */
+  frame first;
+
+  if (!_reader.read(0, first))
+    return false;
+
+  _rate       = first.frame_rate > 0 ? first.frame_rate : 100;
+  _index      = 0;
+  _next       = 0;
+  _offset     = 0;
+  _current    = 0;
+  _base_time  = std::chrono::steady_clock::now();
+  _base_frame = _reader.frameNumber(0);
+  _start      = _base_time;
+  _replayed   = 0;
+  _finished   = false;
+  _elapsed    = 0;
+  _connected  = true;
+
+  return true;
+}
+
+void replay_source::disconnect()
+{
+  _connected = false;
+  _reader.close();
+}
+
+bool replay_source::isConnected()
+{
+  return _connected;
+}
+
+void replay_source::configure(const stream_settings &)
+{
+}
+
+bool replay_source::getFrame()
+{
+  if (!_connected)
+    return false;
+
+  const int64_t seek = _seek.exchange(-1);
+
+  if (seek >= 0)
+  {
+    jumpTo(_reader.find(static_cast< unsigned int >(seek)));
+    _finished = false;
+  }
+
+  if (_next >= _reader.frameCount())
+  {
+    if (!_loop)
+    {
+      _finished = true;
+      return false;
+    }
+
+    jumpTo(0);
+  }
+
+  const unsigned int recorded = _reader.frameNumber(_next);
+
+  /* Pace relative to the last jump, recorded gaps take their time. */
+  if (_mode != ReplayMode::AsFastAsPossible)
+  {
+    const double t = (static_cast< double >(recorded) - _base_frame) /
+                     (_rate * _speed);
+
+    std::this_thread::sleep_until(
+        _base_time + std::chrono::duration_cast< std::chrono::nanoseconds >(
+                         std::chrono::duration< double >(t)));
+  }
+
+  _index   = _next++;
+  _current = static_cast< unsigned int >(recorded + _offset);
+
+  _replayed.fetch_add(1, std::memory_order_relaxed);
+  _elapsed.store(std::chrono::duration_cast< std::chrono::nanoseconds >(
+                     std::chrono::steady_clock::now() - _start)
+                     .count(),
+                 std::memory_order_relaxed);
+
+  return true;
+}
+
+unsigned int replay_source::frameNumber()
+{
+  return _current;
+}
+
+double replay_source::frameRate()
+{
+  return _rate;
+}
+
+void replay_source::extract(frame &f, const extraction_filter &)
+{
+  /* The recording is decoded whole, the filter is only an optimization. */
+  if (!_reader.read(_index, f))
+  {
+    f.clear();
+    f.frame_rate = _rate;
+  }
+
+  f.frame_number = _current;
+}
+
+std::string replay_source::name() const
+{
+  return _path;
+}
+
+void replay_source::seek(const unsigned int frame_number)
+{
+  _seek.store(frame_number);
+}
+
+size_t replay_source::frameCount() const
+{
+  return _reader.frameCount();
+}
+
+uint64_t replay_source::framesReplayed() const
+{
+  return _replayed.load(std::memory_order_relaxed);
+}
+
+double replay_source::framesPerSecond() const
+{
+  const int64_t elapsed = _elapsed.load(std::memory_order_relaxed);
+
+  if (elapsed <= 0)
+    return 0;
+
+  return framesReplayed() / (elapsed * 1e-9);
+}
+
+bool replay_source::finished() const
+{
+  return _finished.load();
+}
+
+}  // end libviconstream
@@ -0,0 +1,276 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <climits>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+/* POSIX shared memory and Linux futexes. */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "libviconstream/shm_ring.h"
+#include "libviconstream/frame_codec.h"
+#include "libviconstream/viconstream.h"
+
+namespace libviconstream
+{
+namespace
+{
+const size_t alignment = 64;
+
+size_t align(const size_t size)
+{
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+size_t stride(const uint32_t slot_size)
+{
+  return align(sizeof(shm_slot) + slot_size);
+}
+
+/* Shared, not private, futexes: the word is waited on across processes. */
+long futex(std::atomic< uint32_t > &word, const int op, const uint32_t value,
+           const timespec *timeout)
+{
+  return syscall(SYS_futex, reinterpret_cast< uint32_t * >(&word), op, value,
+                 timeout, nullptr, 0);
+}
+
+/* Marks a ring left behind by a crashed publisher as closed and wakes its
+   readers, so they move on instead of waiting on it forever. */
+void closeStale(const std::string &name)
+{
+  const int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+
+  if (fd < 0)
+    return;
+
+  struct stat st;
+
+  if (::fstat(fd, &st) != 0 ||
+      static_cast< size_t >(st.st_size) < sizeof(shm_header))
+  {
+    ::close(fd);
+    return;
+  }
+
+  void *p = ::mmap(nullptr, sizeof(shm_header), PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+  ::close(fd);
+
+  if (p == MAP_FAILED)
+    return;
+
+  shm_header *header = static_cast< shm_header * >(p);
+
+  if (std::memcmp(header->magic, shm_magic, sizeof(header->magic)) == 0)
+  {
+    header->closed.store(1);
+    header->futex.fetch_add(1);
+    shmWake(header->futex);
+  }
+
+  ::munmap(p, sizeof(shm_header));
+}
+}
+
+/*********************************
+ * Ring helpers
+ ********************************/
+
+size_t shmSize(const uint32_t slots, const uint32_t slot_size)
+{
+  return align(sizeof(shm_header)) + slots * stride(slot_size);
+}
+
+shm_slot *shmSlot(shm_header *header, const uint32_t index)
+{
+  uint8_t *base = reinterpret_cast< uint8_t * >(header);
+
+  return reinterpret_cast< shm_slot * >(base + align(sizeof(shm_header)) +
+                                        index * stride(header->slot_size));
+}
+
+uint8_t *shmPayload(shm_slot *slot)
+{
+  return reinterpret_cast< uint8_t * >(slot) + sizeof(shm_slot);
+}
+
+std::string shmName(const std::string &name)
+{
+  return (!name.empty() && name[0] == '/') ? name : "/" + name;
+}
+
+void shmWait(std::atomic< uint32_t > &word, const uint32_t expected,
+             const std::chrono::nanoseconds timeout)
+{
+  timespec ts;
+  ts.tv_sec  = static_cast< time_t >(timeout.count() / 1000000000);
+  ts.tv_nsec = static_cast< long >(timeout.count() % 1000000000);
+
+  futex(word, FUTEX_WAIT, expected, &ts);
+}
+
+void shmWake(std::atomic< uint32_t > &word)
+{
+  futex(word, FUTEX_WAKE, INT_MAX, nullptr);
+}
+
+/*********************************
+ * Publisher public members
+ ********************************/
+
+shm_publisher::shm_publisher(const std::string &name, const uint32_t slots,
+                             const uint32_t slot_size)
+    : _name(shmName(name)),
+      _header(nullptr),
+      _size(shmSize(std::max< uint32_t >(slots, 2), slot_size)),
+      _arbiter(nullptr),
+      _id(0),
+      _frames(0),
+      _oversized(0)
+{
+  /* A stale object of a crashed publisher is replaced, readers still
+     mapping it see it closed and move on to the new one. */
+  closeStale(_name);
+  ::shm_unlink(_name.c_str());
+
+  const int fd = ::shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+
+  if (fd < 0)
+    return;
+
+  if (::ftruncate(fd, _size) != 0)
+  {
+    ::close(fd);
+    ::shm_unlink(_name.c_str());
+    return;
+  }
+
+  void *p = ::mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+
+  if (p == MAP_FAILED)
+  {
+    ::shm_unlink(_name.c_str());
+    return;
+  }
+
+  /* The object is zero filled, so every slot starts at sequence 0. */
+  _header                = static_cast< shm_header * >(p);
+  _header->version       = shm_version;
+  _header->codec_version = frame_codec_version;
+  _header->slots         = std::max< uint32_t >(slots, 2);
+  _header->slot_size     = slot_size;
+
+  _scratch.reserve(slot_size);
+
+  /* Readers check the magic last written, the layout is complete then. */
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(_header->magic, shm_magic, sizeof(_header->magic));
+}
+
+shm_publisher::~shm_publisher()
+{
+  close();
+}
+
+bool shm_publisher::isOpen() const
+{
+  return _header != nullptr;
+}
+
+bool shm_publisher::attach(arbiter &a)
+{
+  if (!isOpen() || _arbiter != nullptr)
+    return false;
+
+  _arbiter = &a;
+  _id = a.registerCallback([this](const frame &f) { publish(f); });
+
+  return true;
+}
+
+void shm_publisher::detach()
+{
+  if (_arbiter == nullptr)
+    return;
+
+  /* Waits for dispatch, no publish() is running after this. */
+  _arbiter->unregisterCallback(_id);
+  _arbiter = nullptr;
+}
+
+void shm_publisher::publish(const frame &f)
+{
+  if (!isOpen())
+    return;
+
+  _scratch.clear();
+  encodeFrame(f, _scratch);
+
+  if (_scratch.size() > _header->slot_size)
+  {
+    _oversized.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  const uint64_t n = _header->published.load(std::memory_order_relaxed);
+  shm_slot *slot   = shmSlot(_header, n % _header->slots);
+
+  /* Odd while writing, readers copying the slot meanwhile retry. */
+  slot->sequence.store(2 * n + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot->size.store(static_cast< uint32_t >(_scratch.size()),
+                   std::memory_order_relaxed);
+  std::memcpy(shmPayload(slot), _scratch.data(), _scratch.size());
+
+  slot->sequence.store(2 * n + 2, std::memory_order_release);
+  _header->published.store(n + 1, std::memory_order_release);
+
+  /* A reader registers as a waiter before reading the futex word, so
+     either it sees the new value or the wake is not skipped. */
+  _header->futex.fetch_add(1);
+
+  if (_header->waiters.load() > 0)
+    shmWake(_header->futex);
+
+  _frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void shm_publisher::close()
+{
+  detach();
+
+  if (!isOpen())
+    return;
+
+  _header->closed.store(1);
+  _header->futex.fetch_add(1);
+  shmWake(_header->futex);
+
+  ::munmap(_header, _size);
+  ::shm_unlink(_name.c_str());
+  _header = nullptr;
+}
+
+uint64_t shm_publisher::framesPublished() const
+{
+  return _frames.load(std::memory_order_relaxed);
+}
+
+uint64_t shm_publisher::framesOversized() const
+{
+  return _oversized.load(std::memory_order_relaxed);
+}
+
+}  // end libviconstream
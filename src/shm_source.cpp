@@ -0,0 +1,293 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstring>
+#include <algorithm>
+#include <thread>
+
+/* POSIX shared memory. */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libviconstream/shm_source.h"
+#include "libviconstream/frame_codec.h"
+
+namespace libviconstream
+{
+namespace
+{
+/* Longest time getFrame() blocks, so the grabber can see a shutdown. */
+const std::chrono::milliseconds frame_timeout(100);
+
+/* Poll interval while waiting for a publisher to (re)appear. */
+const std::chrono::milliseconds reopen_interval(10);
+}
+
+/*********************************
+ * Private members
+ ********************************/
+
+bool shm_source::map()
+{
+  const int fd = ::shm_open(_name.c_str(), O_RDWR, 0);
+
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+
+  if (::fstat(fd, &st) != 0 ||
+      static_cast< size_t >(st.st_size) < sizeof(shm_header))
+  {
+    ::close(fd);
+    return false;
+  }
+
+  void *p =
+      ::mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+
+  if (p == MAP_FAILED)
+    return false;
+
+  shm_header *header = static_cast< shm_header * >(p);
+  const size_t size  = st.st_size;
+
+  /* The magic is written last by the publisher, check it first. */
+  bool valid =
+      std::memcmp(header->magic, shm_magic, sizeof(header->magic)) == 0;
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  valid = valid && header->version == shm_version &&
+          header->codec_version == frame_codec_version &&
+          header->slots >= 2 &&
+          shmSize(header->slots, header->slot_size) <= size &&
+          header->closed.load() == 0;
+
+  if (!valid)
+  {
+    ::munmap(p, size);
+    return false;
+  }
+
+  unmap();
+
+  _header = header;
+  _size   = size;
+
+  /* Start at the newest frame, older ones are of no interest. */
+  const uint64_t published = _header->published.load();
+  _next                    = published > 0 ? published - 1 : 0;
+
+  return true;
+}
+
+void shm_source::unmap()
+{
+  if (_header != nullptr)
+    ::munmap(_header, _size);
+
+  _header = nullptr;
+  _size   = 0;
+}
+
+bool shm_source::read(const uint64_t index, bool &overwritten)
+{
+  shm_slot *slot          = shmSlot(_header, index % _header->slots);
+  const uint64_t sequence = 2 * index + 2;
+
+  overwritten = true;
+
+  if (slot->sequence.load(std::memory_order_acquire) != sequence)
+    return false;
+
+  /* A torn size is clamped, decoding is bounds checked either way. */
+  const uint32_t size =
+      std::min(slot->size.load(std::memory_order_relaxed), _header->slot_size);
+  const bool decoded = decodeFrame(shmPayload(slot), size, _current);
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+
+  if (slot->sequence.load(std::memory_order_relaxed) != sequence)
+    return false;
+
+  overwritten = false;
+  return decoded;
+}
+
+/*********************************
+ * Public members
+ ********************************/
+
+shm_source::shm_source(const std::string &name)
+    : _name(shmName(name)),
+      _header(nullptr),
+      _size(0),
+      _connected(false),
+      _newest(true),
+      _next(0),
+      _offset(0),
+      _frame_number(0),
+      _rate(0),
+      _overruns(0)
+{
+}
+
+shm_source::~shm_source()
+{
+  unmap();
+}
+
+bool shm_source::connect()
+{
+  if (!map())
+    return false;
+
+  _offset       = 0;
+  _frame_number = 0;
+  _rate         = 0;
+  _connected    = true;
+
+  return true;
+}
+
+void shm_source::disconnect()
+{
+  _connected = false;
+  unmap();
+}
+
+bool shm_source::isConnected()
+{
+  return _connected;
+}
+
+void shm_source::configure(const stream_settings &settings)
+{
+  /* The data types are decided by the publisher's arbiter. */
+  _newest = settings.stream_mode == StreamMode::ServerPush;
+}
+
+bool shm_source::getFrame()
+{
+  if (!_connected)
+    return false;
+
+  const auto deadline = std::chrono::steady_clock::now() + frame_timeout;
+
+  while (std::chrono::steady_clock::now() < deadline)
+  {
+    /* The publisher closed or restarted, move to its new ring. */
+    if (_header == nullptr || _header->closed.load() != 0)
+    {
+      if (!map())
+      {
+        std::this_thread::sleep_for(reopen_interval);
+        continue;
+      }
+    }
+
+    const uint64_t published =
+        _header->published.load(std::memory_order_acquire);
+
+    if (published > _next)
+    {
+      const uint64_t behind = published - _next;
+
+      if (behind > 1 && (_newest || behind > _header->slots))
+      {
+        if (!_newest)
+          _overruns.fetch_add(1, std::memory_order_relaxed);
+
+        _next = published - 1;
+      }
+
+      bool overwritten;
+
+      if (read(_next, overwritten))
+      {
+        _next++;
+
+        _transport.record(
+            std::chrono::duration_cast< std::chrono::nanoseconds >(
+                std::chrono::steady_clock::now() - _current.latency.dispatched)
+                .count());
+
+        /* Frame numbers keep increasing over publisher restarts. */
+        if (static_cast< int64_t >(_current.frame_number) + _offset <=
+            static_cast< int64_t >(_frame_number))
+          _offset = static_cast< int64_t >(_frame_number) + 1 -
+                    _current.frame_number;
+
+        _frame_number =
+            static_cast< unsigned int >(_current.frame_number + _offset);
+
+        if (_current.frame_rate > 0)
+          _rate = _current.frame_rate;
+
+        return true;
+      }
+
+      /* A corrupt frame is skipped, an overwritten one is caught up on. */
+      if (!overwritten)
+        _next++;
+
+      continue;
+    }
+
+    /* Register as a waiter before reading the word, see publish(). */
+    _header->waiters.fetch_add(1);
+    const uint32_t word = _header->futex.load();
+
+    if (_header->published.load() == published &&
+        _header->closed.load() == 0)
+      shmWait(_header->futex, word,
+              std::max(std::chrono::nanoseconds(0),
+                       std::chrono::duration_cast< std::chrono::nanoseconds >(
+                           deadline - std::chrono::steady_clock::now())));
+
+    _header->waiters.fetch_sub(1);
+  }
+
+  return false;
+}
+
+unsigned int shm_source::frameNumber()
+{
+  return _frame_number;
+}
+
+double shm_source::frameRate()
+{
+  return _rate;
+}
+
+void shm_source::extract(frame &f, const extraction_filter &)
+{
+  /* The frame is decoded whole, the filter is only an optimization. The
+     pooled frame's buffers are decoded into next time. */
+  f.swap(_current);
+  f.frame_number = _frame_number;
+}
+
+std::string shm_source::name() const
+{
+  return _name;
+}
+
+uint64_t shm_source::overruns() const
+{
+  return _overruns.load(std::memory_order_relaxed);
+}
+
+const latency_histogram &shm_source::transportLatency() const
+{
+  return _transport;
+}
+
+}  // end libviconstream
@@ -0,0 +1,403 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cmath>
+#include <thread>
+#include <algorithm>
+#include "libviconstream/simulated_source.h"
+
+namespace libviconstream
+{
+namespace
+{
+/* SplitMix64, a tiny stateless hash for the deterministic frame loss. */
+uint64_t splitmix64(uint64_t x)
+{
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+double uniform(const uint64_t seed, const uint64_t n)
+{
+  return (splitmix64(seed ^ splitmix64(n)) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+const double pi = 3.14159265358979323846;
+}
+
+simulator_settings::simulator_settings()
+    : subjects(1),
+      segments(1),
+      markers(0),
+      unlabeled_markers(0),
+      devices(0),
+      frame_rate(100),
+      latency(0),
+      drop_probability(0),
+      first_frame(1),
+      seed(1),
+      realtime(true)
+{
+}
+
+/*********************************
+ * Private members
+ ********************************/
+
+bool simulated_source::dropped(const unsigned int frame_number) const
+{
+  if (frame_number >= _drop_first && frame_number <= _drop_last)
+    return true;
+
+  return _sim.drop_probability > 0 &&
+         uniform(_sim.seed, frame_number) < _sim.drop_probability;
+}
+
+bool simulated_source::advanceTo(const unsigned int n)
+{
+  const unsigned int pending = _pending_drops.exchange(0);
+
+  /* Injected loss starts at the next frame after the injection. */
+  if (pending > 0)
+  {
+    _drop_first = n;
+    _drop_last  = n + pending - 1;
+  }
+
+  if (dropped(n))
+    return false;
+
+  _current = n;
+  return true;
+}
+
+/*********************************
+ * Public members
+ ********************************/
+
+simulated_source::simulated_source(const simulator_settings &settings)
+    : _sim(settings),
+      _connected(false),
+      _current(settings.first_frame - 1),
+      _pending_drops(0),
+      _drop_first(1),
+      _drop_last(0)
+{
+  _settings.segment_data          = true;
+  _settings.marker_data           = false;
+  _settings.unlabeled_marker_data = false;
+  _settings.device_data           = false;
+  _settings.stream_mode           = StreamMode::ServerPush;
+
+  for (unsigned int i = 0; i < _sim.subjects; i++)
+    _subject_names.push_back("subject" + std::to_string(i));
+
+  for (unsigned int i = 0; i < _sim.segments; i++)
+    _segment_names.push_back(i == 0 ? "root" : "segment" + std::to_string(i));
+
+  for (unsigned int i = 0; i < _sim.markers; i++)
+    _marker_names.push_back("marker" + std::to_string(i));
+
+  for (unsigned int i = 0; i < _sim.devices; i++)
+    _device_names.push_back("device" + std::to_string(i));
+}
+
+bool simulated_source::connect()
+{
+  /* Frames start flowing at connection, from the configured number. */
+  _start     = std::chrono::steady_clock::now();
+  _current   = _sim.first_frame - 1;
+  _connected = true;
+
+  return true;
+}
+
+void simulated_source::disconnect()
+{
+  _connected = false;
+}
+
+bool simulated_source::isConnected()
+{
+  return _connected;
+}
+
+void simulated_source::configure(const stream_settings &settings)
+{
+  _settings = settings;
+}
+
+bool simulated_source::getFrame()
+{
+  if (!_connected)
+    return false;
+
+  /* Unpaced, every call produces the next frame. */
+  if (!_sim.realtime)
+  {
+    unsigned int n = _current + 1;
+
+    while (!advanceTo(n))
+      n++;
+
+    return true;
+  }
+
+  /* The latest frame which is due now. */
+  const auto now        = std::chrono::steady_clock::now();
+  const double elapsed  = std::chrono::duration< double >(now - _start).count();
+  const unsigned int due = _sim.first_frame +
+      static_cast< unsigned int >(std::floor(elapsed * _sim.frame_rate));
+
+  if (due > _current && advanceTo(due))
+    return true;
+
+  if (_settings.stream_mode != StreamMode::ServerPush)
+    return true;
+
+  /* ServerPush blocks until the next frame arrives. */
+  unsigned int n = std::max(due, _current) + 1;
+
+  while (_connected)
+  {
+    std::this_thread::sleep_until(frameDue(n));
+
+    if (advanceTo(n))
+      return true;
+
+    n++;
+  }
+
+  return false;
+}
+
+unsigned int simulated_source::frameNumber()
+{
+  return _current;
+}
+
+double simulated_source::frameRate()
+{
+  return _sim.frame_rate;
+}
+
+void simulated_source::extract(frame &f, const extraction_filter &filter)
+{
+  const double t = frameTime(_current);
+
+  f.frame_number = _current;
+  f.frame_rate   = _sim.frame_rate;
+
+  /* Timecode counts whole frames from the first frame. */
+  const unsigned int rate  = static_cast< unsigned int >(_sim.frame_rate);
+  const unsigned int n     = _current - _sim.first_frame + 1;
+  const unsigned int secs  = rate > 0 ? n / rate : 0;
+  f.tc.hours                = secs / 3600;
+  f.tc.minutes              = (secs / 60) % 60;
+  f.tc.seconds              = secs % 60;
+  f.tc.frames               = rate > 0 ? n % rate : 0;
+  f.tc.sub_frame            = 0;
+  f.tc.field_flag           = false;
+  f.tc.standard             = TimecodeStandard::None;
+  f.tc.sub_frames_per_frame = 1;
+  f.tc.user_bits            = 0;
+
+  f.latency.server_total = _sim.latency;
+
+  const bool global_pose =
+      _settings.segment_data && filter.wants(DataKind::GlobalPose);
+  const bool local_pose =
+      _settings.segment_data && filter.wants(DataKind::LocalPose);
+  const bool markers = _settings.marker_data && filter.wants(DataKind::Markers);
+
+  if (global_pose || local_pose || markers)
+  {
+    for (unsigned int i = 0; i < _sim.subjects; i++)
+    {
+      if (!filter.wantsSubject(_subject_names[i]))
+        continue;
+
+      const uint32_t sidx = static_cast< uint32_t >(f.subjects.size());
+
+      subject_data sd;
+      sd.first_segment = static_cast< uint32_t >(f.segments.size());
+      sd.segment_count = 0;
+      sd.root_segment  = sd.first_segment;
+      sd.first_marker  = static_cast< uint32_t >(f.markers.size());
+      sd.marker_count  = 0;
+      sd.source_frame  = f.frame_number;
+      sd.source_rate   = f.frame_rate;
+      sd.source_delay  = f.latency.server_total;
+
+      if (global_pose || local_pose)
+      {
+        for (unsigned int j = 0; j < _sim.segments; j++)
+        {
+          /* The first segment is the root. */
+          if (j > 0 && !filter.wantsSegment(_segment_names[j]))
+            continue;
+
+          segment_data sg = segment_data();
+          sg.subject      = sidx;
+          truePose(i, j, t, sg.global);
+
+          /* Segments are chained along x with the parent's orientation. */
+          if (j == 0)
+            sg.local = sg.global;
+          else
+          {
+            sg.local.translation[0] = 100;
+            sg.local.rotation[3]    = 1;
+          }
+
+          if (!global_pose)
+            sg.global.occluded = true;
+
+          if (!local_pose)
+            sg.local.occluded = true;
+
+          f.segments.push_back(sg);
+          f.segment_names.push_back(_segment_names[j]);
+        }
+
+        sd.segment_count =
+            static_cast< uint32_t >(f.segments.size()) - sd.first_segment;
+      }
+
+      if (markers && _sim.markers > 0)
+      {
+        pose root;
+        truePose(i, 0, t, root);
+
+        /* Markers on a ring around the root, rotated with its yaw. */
+        const double yaw = 2 * std::atan2(root.rotation[2], root.rotation[3]);
+
+        for (unsigned int j = 0; j < _sim.markers; j++)
+        {
+          if (!filter.wantsMarker(_marker_names[j]))
+            continue;
+
+          const double a = 2 * pi * j / _sim.markers + yaw;
+
+          marker_data md;
+          md.subject        = sidx;
+          md.translation[0] = root.translation[0] + 50 * std::cos(a);
+          md.translation[1] = root.translation[1] + 50 * std::sin(a);
+          md.translation[2] = root.translation[2] + 20;
+          md.occluded       = false;
+
+          f.markers.push_back(md);
+          f.marker_names.push_back(_marker_names[j]);
+        }
+
+        sd.marker_count =
+            static_cast< uint32_t >(f.markers.size()) - sd.first_marker;
+      }
+
+      f.subjects.push_back(sd);
+      f.subject_names.push_back(_subject_names[i]);
+    }
+  }
+
+  if (_settings.unlabeled_marker_data &&
+      filter.wants(DataKind::UnlabeledMarkers))
+  {
+    /* A slowly rotating, fixed point cloud. */
+    for (unsigned int i = 0; i < _sim.unlabeled_markers; i++)
+    {
+      const double r = 4000 * uniform(_sim.seed, 3 * i);
+      const double a = 2 * pi * uniform(_sim.seed, 3 * i + 1) + 0.1 * t;
+      const double h = 3000 * uniform(_sim.seed, 3 * i + 2);
+
+      unlabeled_marker_data um;
+      um.translation[0] = r * std::cos(a);
+      um.translation[1] = r * std::sin(a);
+      um.translation[2] = h;
+
+      f.unlabeled_markers.push_back(um);
+    }
+  }
+
+  if (_settings.device_data && filter.wants(DataKind::Devices))
+  {
+    for (unsigned int i = 0; i < _sim.devices; i++)
+    {
+      device_data dd;
+      dd.first_output = static_cast< uint32_t >(f.device_outputs.size());
+      dd.output_count = 1;
+      dd.type         = DeviceType::Unknown;
+
+      device_output_data od;
+      od.device   = i;
+      od.value    = std::sin(2 * pi * t + i);
+      od.unit     = Unit::Volt;
+      od.occluded = false;
+
+      f.device_outputs.push_back(od);
+      f.device_output_names.push_back("output");
+
+      f.devices.push_back(dd);
+      f.device_names.push_back(_device_names[i]);
+    }
+  }
+}
+
+std::string simulated_source::name() const
+{
+  return "simulator";
+}
+
+void simulated_source::injectDrop(const unsigned int count)
+{
+  _pending_drops.fetch_add(count);
+}
+
+double simulated_source::frameTime(const unsigned int frame_number) const
+{
+  return (static_cast< double >(frame_number) - _sim.first_frame) /
+         _sim.frame_rate;
+}
+
+std::chrono::steady_clock::time_point simulated_source::frameDue(
+    const unsigned int frame_number) const
+{
+  return _start + std::chrono::duration_cast< std::chrono::nanoseconds >(
+                      std::chrono::duration< double >(frameTime(frame_number)));
+}
+
+void simulated_source::truePose(const unsigned int subject,
+                                const unsigned int segment, const double t,
+                                pose &p) const
+{
+  /* Each subject circles its own center with its own angular rate. */
+  const double w     = 2 * pi * 0.25 * (1 + 0.1 * subject);
+  const double phase = 0.7 * subject;
+  const double cx    = 1500.0 * (subject % 8) - 5250;
+  const double cy    = 1500.0 * (subject / 8);
+
+  const double yaw  = w * t + phase + pi / 2;
+  const double roll = 0.1 * std::sin(3 * w * t);
+
+  /* Segments are chained along the body's x axis. */
+  const double off = 100.0 * segment;
+
+  p.translation[0] = cx + 500 * std::cos(w * t + phase) + off * std::cos(yaw);
+  p.translation[1] = cy + 500 * std::sin(w * t + phase) + off * std::sin(yaw);
+  p.translation[2] = 1000 + 200 * std::sin(2 * w * t);
+
+  /* q = q_z(yaw) * q_x(roll), in (x, y, z, w) order. */
+  const double sy = std::sin(yaw / 2), cy2 = std::cos(yaw / 2);
+  const double sr = std::sin(roll / 2), cr = std::cos(roll / 2);
+
+  p.rotation[0] = sr * cy2;
+  p.rotation[1] = sr * sy;
+  p.rotation[2] = cr * sy;
+  p.rotation[3] = cr * cy2;
+  p.occluded    = false;
+}
+
+}  // end libviconstream
@@ -0,0 +1,173 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include "libviconstream/subscriber.h"
+
+namespace libviconstream
+{
+subscriber::subscriber(viconstream_callback cb, const DispatchMode::Enum mode,
+                       const size_t queue_size,
+                       const OverflowPolicy::Enum policy,
+                       const subscription &filter,
+                       const std::vector< subject_handle > &handles)
+    : _queue(mode == DispatchMode::Async ? std::max< size_t >(queue_size, 1)
+                                         : 0),
+      _head(0),
+      _count(0),
+      _stop(false),
+      _give_way(false),
+      _depth(0),
+      _delivered(0),
+      _dropped(0),
+      callback(cb),
+      mode(mode),
+      policy(policy),
+      filter(filter),
+      subject_handles(handles)
+{
+}
+
+bool subscriber::wants(const frame &f) const
+{
+  for (auto h : subject_handles)
+  {
+    if (f.findSubject(h) < 0)
+      return false;
+  }
+
+  return true;
+}
+
+bool subscriber::push(const frame_ptr &f)
+{
+  std::unique_lock< std::mutex > locker(_lock);
+
+  if (_stop)
+    return false;
+
+  if (_count == _queue.size())
+  {
+    if (policy == OverflowPolicy::DropNewest)
+    {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    else if (policy == OverflowPolicy::DropOldest)
+    {
+      _queue[_head].reset();
+      _head = (_head + 1) % _queue.size();
+      _count--;
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+      _cv_space.wait(locker, [this]() {
+        return _stop || _give_way || _count < _queue.size();
+      });
+
+      if (_stop)
+        return false;
+
+      if (_count == _queue.size())
+      {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+    }
+  }
+
+  _queue[(_head + _count) % _queue.size()] = f;
+  _count++;
+  _depth.store(_count, std::memory_order_relaxed);
+
+  locker.unlock();
+  _cv_data.notify_one();
+
+  return true;
+}
+
+bool subscriber::pop(frame_ptr &f)
+{
+  std::unique_lock< std::mutex > locker(_lock);
+
+  _cv_data.wait(locker, [this]() { return _stop || _count > 0; });
+
+  if (_stop)
+    return false;
+
+  f = std::move(_queue[_head]);
+  _head = (_head + 1) % _queue.size();
+  _count--;
+  _depth.store(_count, std::memory_order_relaxed);
+
+  locker.unlock();
+  _cv_space.notify_one();
+
+  return true;
+}
+
+void subscriber::stop()
+{
+  {
+    std::lock_guard< std::mutex > locker(_lock);
+    _stop = true;
+
+    /* Release the queued frames back to the pool. */
+    for (auto &f : _queue)
+      f.reset();
+
+    _count = 0;
+    _depth.store(0, std::memory_order_relaxed);
+  }
+
+  _cv_data.notify_all();
+  _cv_space.notify_all();
+}
+
+void subscriber::giveWay(const bool enable)
+{
+  {
+    std::lock_guard< std::mutex > locker(_lock);
+    _give_way = enable;
+  }
+
+  _cv_space.notify_all();
+}
+
+void subscriber::deliver(const frame &f)
+{
+  using namespace std::chrono;
+
+  /* Unregistered while a dispatch was using the old registry. */
+  if (_stop.load(std::memory_order_relaxed))
+    return;
+
+  const auto start = steady_clock::now();
+  callback(f);
+  const auto end = steady_clock::now();
+
+  callback_start.record(
+      duration_cast< nanoseconds >(start - f.latency.received).count());
+  callback_duration.record(duration_cast< nanoseconds >(end - start).count());
+
+  _delivered.fetch_add(1, std::memory_order_relaxed);
+}
+
+subscriber_stats subscriber::stats() const
+{
+  subscriber_stats s;
+  s.queue_depth    = _depth.load(std::memory_order_relaxed);
+  s.queue_capacity = _queue.size();
+  s.delivered      = _delivered.load(std::memory_order_relaxed);
+  s.dropped        = _dropped.load(std::memory_order_relaxed);
+
+  s.callback_start    = callback_start.summary();
+  s.callback_duration = callback_duration.summary();
+
+  return s;
+}
+
+}  // end libviconstream
@@ -0,0 +1,401 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+
+/* POSIX sockets. */
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include "libviconstream/udp_relay.h"
+#include "libviconstream/viconstream.h"
+
+namespace libviconstream
+{
+/*********************************
+ * Private members
+ ********************************/
+
+void udp_relay::updateModel(const frame &f)
+{
+  _handles = f.handles;
+  _ids.assign(f.subjects.size(), -1);
+
+  /* Handle ids are stable over model changes, frame indexes are not. */
+  if (_handles)
+  {
+    const std::vector< int32_t > &map = _handles->subjects;
+
+    for (size_t id = 0; id < map.size() && id <= 0xFFFF; id++)
+    {
+      if (map[id] >= 0 && static_cast< size_t >(map[id]) < _ids.size())
+        _ids[map[id]] = static_cast< int32_t >(id);
+    }
+  }
+  else
+  {
+    for (size_t i = 0; i < _ids.size() && i <= 0xFFFF; i++)
+      _ids[i] = static_cast< int32_t >(i);
+  }
+
+  for (auto &d : _destinations)
+  {
+    d.wanted.assign(_ids.size(), 0);
+
+    for (size_t i = 0; i < _ids.size(); i++)
+      d.wanted[i] = _ids[i] >= 0 &&
+                    (d.subjects.empty() ||
+                     std::binary_search(d.subjects.begin(), d.subjects.end(),
+                                        f.subject_names[i]));
+
+    /* The receivers learn the new names with the next frame. */
+    d.names_countdown = 0;
+  }
+}
+
+uint8_t *udp_relay::addPacket(const size_t target)
+{
+  const size_t index = _sizes.size();
+
+  if (_packets.size() < (index + 1) * pose_packet_max_size)
+    _packets.resize((index + 1) * pose_packet_max_size);
+
+  _sizes.push_back(0);
+  _targets.push_back(target);
+
+  return _packets.data() + index * pose_packet_max_size;
+}
+
+void udp_relay::addNames(const frame &f, const size_t target)
+{
+  const destination &d = _destinations[target];
+
+  packet_header h;
+  h.type         = PacketType::Names;
+  h.frame_number = f.frame_number;
+  h.age_us       = 0;
+  h.frame_rate   = static_cast< float >(f.frame_rate);
+
+  /* Count the packets first, every packet carries the total. */
+  unsigned int fragments = 1;
+  size_t size            = pose_packet_header_size;
+
+  for (size_t i = 0; i < _ids.size(); i++)
+  {
+    if (!d.wanted[i])
+      continue;
+
+    const size_t entry = packetNameSize(f.subject_names[i]);
+
+    if (size + entry > pose_packet_max_size)
+    {
+      fragments++;
+      size = pose_packet_header_size;
+    }
+
+    size += entry;
+  }
+
+  h.fragments = static_cast< uint8_t >(std::min(fragments, 255u));
+  h.fragment  = 0;
+  h.count     = 0;
+
+  uint8_t *out = addPacket(target);
+  size         = pose_packet_header_size;
+
+  for (size_t i = 0; i < _ids.size(); i++)
+  {
+    if (!d.wanted[i])
+      continue;
+
+    const size_t entry = packetNameSize(f.subject_names[i]);
+
+    if (size + entry > pose_packet_max_size)
+    {
+      encodePacketHeader(h, out);
+      _sizes.back() = size;
+
+      if (++h.fragment == h.fragments)
+        return;
+
+      h.count = 0;
+      out     = addPacket(target);
+      size    = pose_packet_header_size;
+    }
+
+    size += encodePacketName(static_cast< uint16_t >(_ids[i]),
+                             f.subject_names[i], out + size);
+    h.count++;
+  }
+
+  encodePacketHeader(h, out);
+  _sizes.back() = size;
+}
+
+void udp_relay::addPoses(const frame &f, const size_t target,
+                         const uint32_t age_us)
+{
+  const destination &d = _destinations[target];
+
+  /* Counted and encoded alike, the receivers wait for every fragment. */
+  auto sent = [&](const size_t i) {
+    return d.wanted[i] && f.subjects[i].segment_count > 0;
+  };
+
+  size_t count = 0;
+  for (size_t i = 0; i < _ids.size(); i++)
+    count += sent(i);
+
+  /* A frame without poses is still sent, receivers see the frame rate. */
+  const size_t fragments = std::min< size_t >(
+      std::max< size_t >(
+          (count + pose_packet_max_poses - 1) / pose_packet_max_poses, 1),
+      255);
+
+  packet_header h;
+  h.type         = PacketType::Poses;
+  h.fragment     = 0;
+  h.fragments    = static_cast< uint8_t >(fragments);
+  h.frame_number = f.frame_number;
+  h.age_us       = age_us;
+  h.frame_rate   = static_cast< float >(f.frame_rate);
+  h.count        = 0;
+
+  uint8_t *out = addPacket(target);
+  size_t size  = pose_packet_header_size;
+
+  for (size_t i = 0; i < _ids.size(); i++)
+  {
+    if (!sent(i))
+      continue;
+
+    if (h.count == pose_packet_max_poses)
+    {
+      encodePacketHeader(h, out);
+      _sizes.back() = size;
+
+      if (++h.fragment == h.fragments)
+        return;
+
+      h.count = 0;
+      out     = addPacket(target);
+      size    = pose_packet_header_size;
+    }
+
+    const pose &g = f.segments[f.subjects[i].root_segment].global;
+
+    packet_pose p;
+    p.id       = static_cast< uint16_t >(_ids[i]);
+    p.occluded = g.occluded;
+
+    for (int j = 0; j < 3; j++)
+      p.translation[j] = static_cast< float >(g.translation[j]);
+
+    for (int j = 0; j < 4; j++)
+      p.rotation[j] = static_cast< float >(g.rotation[j]);
+
+    size += encodePacketPose(p, out + size);
+    h.count++;
+  }
+
+  encodePacketHeader(h, out);
+  _sizes.back() = size;
+}
+
+void udp_relay::send()
+{
+  const size_t n = _sizes.size();
+
+  _messages.resize(n);
+  _iov.resize(n);
+
+  for (size_t i = 0; i < n; i++)
+  {
+    _iov[i].iov_base = _packets.data() + i * pose_packet_max_size;
+    _iov[i].iov_len  = _sizes[i];
+
+    std::memset(&_messages[i], 0, sizeof(mmsghdr));
+    _messages[i].msg_hdr.msg_name =
+        &_destinations[_targets[i]].address;
+    _messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    _messages[i].msg_hdr.msg_iov     = &_iov[i];
+    _messages[i].msg_hdr.msg_iovlen  = 1;
+  }
+
+  size_t done = 0;
+
+  while (done < n)
+  {
+    const int r = ::sendmmsg(_fd, _messages.data() + done,
+                             static_cast< unsigned int >(n - done),
+                             MSG_DONTWAIT);
+
+    if (r < 0 && errno == EINTR)
+      continue;
+
+    /* The message which failed is dropped, the rest are still sent. */
+    if (r <= 0)
+    {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      done++;
+      continue;
+    }
+
+    _sent.fetch_add(r, std::memory_order_relaxed);
+    done += r;
+  }
+}
+
+/*********************************
+ * Public members
+ ********************************/
+
+relay_settings::relay_settings() : multicast_ttl(1), names_interval(100)
+{
+}
+
+udp_relay::udp_relay(const relay_settings &settings)
+    : _settings(settings),
+      _fd(-1),
+      _arbiter(nullptr),
+      _id(0),
+      _frames(0),
+      _sent(0),
+      _dropped(0)
+{
+  _fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+
+  if (_fd < 0)
+    return;
+
+  const unsigned char ttl =
+      static_cast< unsigned char >(std::max(settings.multicast_ttl, 0));
+  ::setsockopt(_fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+}
+
+udp_relay::~udp_relay()
+{
+  detach();
+
+  if (_fd >= 0)
+    ::close(_fd);
+}
+
+bool udp_relay::isOpen() const
+{
+  return _fd >= 0;
+}
+
+bool udp_relay::addDestination(const std::string &address,
+                               const uint16_t port,
+                               const std::vector< std::string > &subjects)
+{
+  if (_arbiter != nullptr)
+    return false;
+
+  destination d;
+  std::memset(&d.address, 0, sizeof(d.address));
+  d.address.sin_family = AF_INET;
+  d.address.sin_port   = htons(port);
+
+  if (::inet_pton(AF_INET, address.c_str(), &d.address.sin_addr) != 1)
+    return false;
+
+  d.subjects = subjects;
+  std::sort(d.subjects.begin(), d.subjects.end());
+  d.names_countdown = 0;
+
+  _destinations.push_back(d);
+
+  /* Filters are rebuilt with the next frame. */
+  _handles.reset();
+  _ids.clear();
+
+  return true;
+}
+
+bool udp_relay::attach(arbiter &a)
+{
+  if (!isOpen() || _arbiter != nullptr)
+    return false;
+
+  subscription s;
+  s.kinds = DataKind::GlobalPose;
+
+  _arbiter = &a;
+  _id      = a.registerCallback(s, [this](const frame &f) { relay(f); });
+
+  return true;
+}
+
+void udp_relay::detach()
+{
+  if (_arbiter == nullptr)
+    return;
+
+  /* Waits for dispatch, no relay() is running after this. */
+  _arbiter->unregisterCallback(_id);
+  _arbiter = nullptr;
+}
+
+void udp_relay::relay(const frame &f)
+{
+  if (!isOpen() || _destinations.empty())
+    return;
+
+  if (f.handles != _handles || _ids.size() != f.subjects.size())
+    updateModel(f);
+
+  /* The receiver's clock is unrelated, so the age is sent instead of a
+     time: the server's latency plus the time on this host. */
+  const double age =
+      f.latency.server_total +
+      std::chrono::duration< double >(std::chrono::steady_clock::now() -
+                                      f.latency.received)
+          .count();
+  const uint32_t age_us =
+      static_cast< uint32_t >(std::min(std::max(age * 1e6, 0.0), 4e9));
+
+  _sizes.clear();
+  _targets.clear();
+
+  for (size_t t = 0; t < _destinations.size(); t++)
+  {
+    destination &d = _destinations[t];
+
+    if (d.names_countdown == 0)
+    {
+      addNames(f, t);
+      d.names_countdown = std::max(_settings.names_interval, 1u);
+    }
+
+    d.names_countdown--;
+    addPoses(f, t, age_us);
+  }
+
+  send();
+
+  _frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t udp_relay::framesRelayed() const
+{
+  return _frames.load(std::memory_order_relaxed);
+}
+
+uint64_t udp_relay::packetsSent() const
+{
+  return _sent.load(std::memory_order_relaxed);
+}
+
+uint64_t udp_relay::packetsDropped() const
+{
+  return _dropped.load(std::memory_order_relaxed);
+}
+
+}  // end libviconstream
@@ -0,0 +1,324 @@
+//          Copyright Emil Fresk 2015-2017.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#include <algorithm>
+#include <cmath>
+#include "libviconstream/vicon_source.h"
+
+namespace libviconstream
+{
+vicon_source::vicon_source(std::string hostname) : _host_name(hostname)
+{
+  _settings.segment_data          = true;
+  _settings.marker_data           = false;
+  _settings.unlabeled_marker_data = false;
+  _settings.device_data           = false;
+  _settings.stream_mode           = StreamMode::ServerPush;
+}
+
+bool vicon_source::connect()
+{
+  return _client.Connect(_host_name).Result == Result::Success;
+}
+
+void vicon_source::disconnect()
+{
+  _client.Disconnect();
+}
+
+bool vicon_source::isConnected()
+{
+  return _client.IsConnected().Connected;
+}
+
+void vicon_source::configure(const stream_settings &settings)
+{
+  _settings = settings;
+
+  if (settings.segment_data)
+    _client.EnableSegmentData();
+  else
+    _client.DisableSegmentData();
+
+  if (settings.marker_data)
+    _client.EnableMarkerData();
+  else
+    _client.DisableMarkerData();
+
+  if (settings.unlabeled_marker_data)
+    _client.EnableUnlabeledMarkerData();
+  else
+    _client.DisableUnlabeledMarkerData();
+
+  if (settings.device_data)
+    _client.EnableDeviceData();
+  else
+    _client.DisableDeviceData();
+
+  _client.SetStreamMode(settings.stream_mode);
+
+  /* Set axis mapping (Z up) */
+  _client.SetAxisMapping(Direction::Forward, Direction::Left, Direction::Up);
+}
+
+bool vicon_source::getFrame()
+{
+  return _client.GetFrame().Result == Result::Success;
+}
+
+unsigned int vicon_source::frameNumber()
+{
+  return _client.GetFrameNumber().FrameNumber;
+}
+
+double vicon_source::frameRate()
+{
+  const Output_GetFrameRate fr = _client.GetFrameRate();
+
+  if (fr.Result != Result::Success || std::isinf(fr.FrameRateHz) ||
+      std::isnan(fr.FrameRateHz))
+    return 0;
+
+  return fr.FrameRateHz;
+}
+
+std::string vicon_source::name() const
+{
+  return _host_name;
+}
+
+void vicon_source::extract(frame &f, const extraction_filter &filter)
+{
+  f.frame_number = _client.GetFrameNumber().FrameNumber;
+
+  f.frame_rate   = frameRate();
+
+  const Output_GetTimecode tc = _client.GetTimecode();
+  if (tc.Result == Result::Success)
+  {
+    f.tc.hours                = tc.Hours;
+    f.tc.minutes              = tc.Minutes;
+    f.tc.seconds              = tc.Seconds;
+    f.tc.frames               = tc.Frames;
+    f.tc.sub_frame            = tc.SubFrame;
+    f.tc.field_flag           = tc.FieldFlag;
+    f.tc.standard             = tc.Standard;
+    f.tc.sub_frames_per_frame = tc.SubFramesPerFrame;
+    f.tc.user_bits            = tc.UserBits;
+  }
+
+  /*
+   * Server reported latency, in total and per stage.
+   */
+  const Output_GetLatencyTotal lt = _client.GetLatencyTotal();
+  if (lt.Result == Result::Success)
+    f.latency.server_total = lt.Total;
+
+  const unsigned int sample_count = _client.GetLatencySampleCount().Count;
+
+  for (unsigned int i = 0; i < sample_count; i++)
+  {
+    const std::string sample = _client.GetLatencySampleName(i).Name;
+
+    f.latency_samples.push_back(_client.GetLatencySampleValue(sample).Value);
+    f.latency_sample_names.push_back(sample);
+  }
+
+  /*
+   * Subjects with their segments and markers, only the requested ones.
+   */
+  const bool global_pose =
+      _settings.segment_data && filter.wants(DataKind::GlobalPose);
+  const bool local_pose =
+      _settings.segment_data && filter.wants(DataKind::LocalPose);
+  const bool markers = _settings.marker_data && filter.wants(DataKind::Markers);
+
+  if (global_pose || local_pose || markers)
+  {
+    const unsigned int subject_count =
+        _client.GetSubjectCount().SubjectCount;
+
+    for (unsigned int i = 0; i < subject_count; i++)
+    {
+      const std::string subject = _client.GetSubjectName(i).SubjectName;
+      const uint32_t sidx       = static_cast< uint32_t >(f.subjects.size());
+
+      if (!filter.wantsSubject(subject))
+        continue;
+
+      subject_data sd;
+      sd.first_segment = static_cast< uint32_t >(f.segments.size());
+      sd.segment_count = 0;
+      sd.root_segment  = sd.first_segment;
+      sd.first_marker  = static_cast< uint32_t >(f.markers.size());
+      sd.marker_count  = 0;
+      sd.source_frame  = f.frame_number;
+      sd.source_rate   = f.frame_rate;
+      sd.source_delay  = f.latency.server_total;
+
+      if (global_pose || local_pose)
+      {
+        const std::string root =
+            _client.GetSubjectRootSegmentName(subject).SegmentName;
+        const unsigned int segment_count =
+            _client.GetSegmentCount(subject).SegmentCount;
+
+        for (unsigned int j = 0; j < segment_count; j++)
+        {
+          const std::string segment =
+              _client.GetSegmentName(subject, j).SegmentName;
+
+          if (segment != root && !filter.wantsSegment(segment))
+            continue;
+
+          segment_data sg = segment_data();
+          sg.subject         = sidx;
+          sg.global.occluded = true;
+          sg.local.occluded  = true;
+
+          if (global_pose)
+          {
+            const Output_GetSegmentGlobalTranslation t =
+                _client.GetSegmentGlobalTranslation(subject, segment);
+            const Output_GetSegmentGlobalRotationQuaternion q =
+                _client.GetSegmentGlobalRotationQuaternion(subject, segment);
+
+            std::copy(t.Translation, t.Translation + 3, sg.global.translation);
+            std::copy(q.Rotation, q.Rotation + 4, sg.global.rotation);
+            sg.global.occluded = t.Occluded || q.Occluded ||
+                                 t.Result != Result::Success ||
+                                 q.Result != Result::Success;
+          }
+
+          if (local_pose)
+          {
+            const Output_GetSegmentLocalTranslation t =
+                _client.GetSegmentLocalTranslation(subject, segment);
+            const Output_GetSegmentLocalRotationQuaternion q =
+                _client.GetSegmentLocalRotationQuaternion(subject, segment);
+
+            std::copy(t.Translation, t.Translation + 3, sg.local.translation);
+            std::copy(q.Rotation, q.Rotation + 4, sg.local.rotation);
+            sg.local.occluded = t.Occluded || q.Occluded ||
+                                t.Result != Result::Success ||
+                                q.Result != Result::Success;
+          }
+
+          if (segment == root)
+            sd.root_segment = static_cast< uint32_t >(f.segments.size());
+
+          f.segments.push_back(sg);
+          f.segment_names.push_back(segment);
+        }
+
+        sd.segment_count =
+            static_cast< uint32_t >(f.segments.size()) - sd.first_segment;
+      }
+
+      if (markers)
+      {
+        const unsigned int marker_count =
+            _client.GetMarkerCount(subject).MarkerCount;
+
+        for (unsigned int j = 0; j < marker_count; j++)
+        {
+          const std::string marker =
+              _client.GetMarkerName(subject, j).MarkerName;
+
+          if (!filter.wantsMarker(marker))
+            continue;
+
+          const Output_GetMarkerGlobalTranslation t =
+              _client.GetMarkerGlobalTranslation(subject, marker);
+
+          marker_data md;
+          md.subject = sidx;
+          std::copy(t.Translation, t.Translation + 3, md.translation);
+          md.occluded = t.Occluded || t.Result != Result::Success;
+
+          f.markers.push_back(md);
+          f.marker_names.push_back(marker);
+        }
+
+        sd.marker_count =
+            static_cast< uint32_t >(f.markers.size()) - sd.first_marker;
+      }
+
+      f.subjects.push_back(sd);
+      f.subject_names.push_back(subject);
+    }
+  }
+
+  /*
+   * Unlabeled markers.
+   */
+  if (_settings.unlabeled_marker_data &&
+      filter.wants(DataKind::UnlabeledMarkers))
+  {
+    const unsigned int marker_count =
+        _client.GetUnlabeledMarkerCount().MarkerCount;
+
+    f.unlabeled_markers.reserve(marker_count);
+
+    for (unsigned int i = 0; i < marker_count; i++)
+    {
+      const Output_GetUnlabeledMarkerGlobalTranslation t =
+          _client.GetUnlabeledMarkerGlobalTranslation(i);
+
+      if (t.Result != Result::Success)
+        continue;
+
+      unlabeled_marker_data um;
+      std::copy(t.Translation, t.Translation + 3, um.translation);
+      f.unlabeled_markers.push_back(um);
+    }
+  }
+
+  /*
+   * Devices and their outputs.
+   */
+  if (_settings.device_data && filter.wants(DataKind::Devices))
+  {
+    const unsigned int device_count =
+        _client.GetDeviceCount().DeviceCount;
+
+    for (unsigned int i = 0; i < device_count; i++)
+    {
+      const Output_GetDeviceName dn = _client.GetDeviceName(i);
+      const std::string device      = dn.DeviceName;
+      const uint32_t didx = static_cast< uint32_t >(f.devices.size());
+
+      device_data dd;
+      dd.first_output = static_cast< uint32_t >(f.device_outputs.size());
+      dd.output_count = _client.GetDeviceOutputCount(device)
+                            .DeviceOutputCount;
+      dd.type = dn.DeviceType;
+
+      for (unsigned int j = 0; j < dd.output_count; j++)
+      {
+        const Output_GetDeviceOutputName on =
+            _client.GetDeviceOutputName(device, j);
+        const std::string output = on.DeviceOutputName;
+
+        const Output_GetDeviceOutputValue v =
+            _client.GetDeviceOutputValue(device, output);
+
+        device_output_data od;
+        od.device   = didx;
+        od.value    = v.Value;
+        od.unit     = on.DeviceOutputUnit;
+        od.occluded = v.Occluded || v.Result != Result::Success;
+
+        f.device_outputs.push_back(od);
+        f.device_output_names.push_back(output);
+      }
+
+      f.devices.push_back(dd);
+      f.device_names.push_back(device);
+    }
+  }
+}
+
+}  // end libviconstream
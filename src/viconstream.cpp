@@ -4,202 +4,657 @@
 //          http://www.boost.org/LICENSE_1_0.txt)
 
 #include <iostream>
+#include <cstring>
 #include <chrono>
 #include <sstream>
 #include <iomanip>
-#include <cmath>
+#include <atomic>
+#include <algorithm>
 #include "libviconstream/viconstream.h"
+#include "libviconstream/vicon_source.h"
 
 namespace libviconstream
 {
+
+namespace
+{
+/* Lost frames are logged at most this often, summed in between. */
+const std::chrono::seconds loss_report_interval(1);
+
+/* The subscriber whose async worker runs on this thread, if any. */
+thread_local subscriber *current_worker = nullptr;
+
+/* Adds names to a filter's union, an empty list stands for all names. */
+void mergeNames(const std::vector< std::string > &names, bool &all,
+                std::vector< std::string > &merged)
+{
+  if (names.empty())
+    all = true;
+  else
+    merged.insert(merged.end(), names.begin(), names.end());
+}
+
+/* Sorts the union for the binary searches, all names need no list. */
+void finishNames(const bool all, std::vector< std::string > &names)
+{
+  if (all)
+    names.clear();
+
+  std::sort(names.begin(), names.end());
+  names.erase(std::unique(names.begin(), names.end()), names.end());
+}
+
+/* Root segment of a subject by its index, -1 if it has none. */
+int rootSegment(const frame &f, const int subject)
+{
+  if (subject < 0 || f.subjects[subject].segment_count == 0)
+    return -1;
+
+  return static_cast< int >(f.subjects[subject].root_segment);
+}
+
+/* Extrapolates a pose from up to three distinct samples in the recent
+   frames, lookup finds its segment index in a frame. */
+template < typename Lookup >
+bool predict(const frame_ptr *frames, const unsigned int depth,
+             const Lookup &lookup,
+             const std::chrono::steady_clock::time_point &t,
+             const Prediction::Enum model, pose &p)
+{
+  using namespace std::chrono;
+
+  const frame *newest       = nullptr;
+  const subject_data *first = nullptr;
+  uint32_t previous         = 0;
+  const pose *samples[3];
+  double times[3];
+  unsigned int count = 0;
+
+  /* Times relative to the newest capture of the subject, spaced by its
+   * source's frame numbers as reception times jitter. */
+  for (unsigned int i = 0; i < depth && count < 3 && frames[i]; i++)
+  {
+    const frame &f = *frames[i];
+    const int s    = lookup(f);
+
+    if (s < 0)
+      break;
+
+    const subject_data &sd = f.subjects[f.segments[s].subject];
+
+    /* Merges triggered by other sources repeat the sample. */
+    if (count > 0 && sd.source_frame == previous)
+      continue;
+
+    if (count == 0)
+    {
+      newest = &f;
+      first  = &sd;
+    }
+
+    if (first->source_rate > 0)
+      times[count] = (static_cast< double >(sd.source_frame) -
+                      static_cast< double >(first->source_frame)) /
+                     first->source_rate;
+    else
+      times[count] =
+          duration< double >(f.latency.received - newest->latency.received)
+              .count() -
+          sd.source_delay + first->source_delay;
+
+    samples[count] = &f.segments[s].global;
+    previous       = sd.source_frame;
+    count++;
+  }
+
+  if (count == 0)
+    return false;
+
+  const double h =
+      duration< double >(t - newest->latency.received).count() +
+      first->source_delay;
+
+  return extrapolatePose(samples, times, count, h, model, p);
+}
+}
+
 /*********************************
  * Private members
  ********************************/
 
-void arbiter::logString(const std::string &log)
+void arbiter::logString(const char *log, const LogLevel::Enum level)
+{
+  _log.log(level, log, std::strlen(log));
+}
+
+void arbiter::logString(const std::string &log, const LogLevel::Enum level)
+{
+  _log.log(level, log);
+}
+
+std::shared_ptr< frame > arbiter::acquireFrame()
+{
+  /* A frame only referenced by the pool is not retained by anyone. */
+  for (auto &f : _frame_pool)
+  {
+    if (f.use_count() == 1)
+    {
+      /* Synchronize with the last owner's release. */
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      f->clear();
+      return f;
+    }
+  }
+
+  _frame_pool.emplace_back(std::make_shared< frame >());
+  return _frame_pool.back();
+}
+
+void arbiter::updateHandles(frame &f)
+{
+  /* Names are compared once here instead of in every subscriber. */
+  if (!_handles || _names.generation() != _handles_generation ||
+      f.subject_names != _model_subjects ||
+      f.segment_names != _model_segments || f.marker_names != _model_markers)
+  {
+    /* Every subject gets a handle, the motion estimates and the pose
+     * history keep their state by handle. */
+    for (auto &name : f.subject_names)
+      _names.subject(name);
+
+    _handles        = _names.map(f, _handles_generation);
+    _model_subjects = f.subject_names;
+    _model_segments = f.segment_names;
+    _model_markers  = f.marker_names;
+  }
+
+  f.handles = _handles;
+}
+
+void arbiter::publishRegistry(std::shared_ptr< registry > reg)
 {
-  /* Check the execution time. */
-  auto tp   = std::chrono::high_resolution_clock::now();
-  auto diff = std::chrono::duration_cast< std::chrono::duration< double > >(
-                  tp - _tp_start)
-                  .count();
+  extraction_filter filter;
+
+  /* Without subscribers everything is extracted, for the polling readers. */
+  if (!reg->callbacks.empty())
+  {
+    filter.kinds        = 0;
+    filter.all_subjects = false;
+    filter.all_segments = false;
+    filter.all_markers  = false;
+  }
+
+  for (auto &cb : reg->callbacks)
+  {
+    const subscription &s = cb.second->filter;
+
+    filter.kinds |= s.kinds;
+    mergeNames(s.subjects, filter.all_subjects, filter.subjects);
+
+    /* Names only widen the kinds of data the subscriber asked for. */
+    if (s.kinds & (DataKind::GlobalPose | DataKind::LocalPose))
+      mergeNames(s.segments, filter.all_segments, filter.segments);
+
+    if (s.kinds & DataKind::Markers)
+      mergeNames(s.markers, filter.all_markers, filter.markers);
+  }
+
+  /* The pose history records the root segment of every subject. */
+  reg->history = _history;
+
+  if (reg->history)
+  {
+    filter.kinds |= DataKind::GlobalPose;
+    filter.all_subjects = true;
+  }
+
+  finishNames(filter.all_subjects, filter.subjects);
+  finishNames(filter.all_segments, filter.segments);
+  finishNames(filter.all_markers, filter.markers);
+
+  reg->filter = std::move(filter);
+
+  std::atomic_store(&_registry,
+                    std::shared_ptr< const registry >(std::move(reg)));
+  _registry_version.fetch_add(1);
+}
 
-  /* Convert to desired format (6 decimals). */
-  std::stringstream s;
+void arbiter::waitForDispatch()
+{
+  const uint64_t seq = _dispatch_seq.load();
 
-  s << std::fixed << std::setprecision(std::numeric_limits< double >::digits10)
-    << diff;
+  /* Wait only for the frame in flight, not for the next ones. */
+  if (seq & 1)
+  {
+    while (_dispatch_seq.load() == seq)
+      std::this_thread::yield();
+  }
+}
 
-  /* Convert to string. */
-  std::string res = s.str();
-  size_t dotIndex = res.find(".");
-  res             = res.substr(0, dotIndex + 7);
+void arbiter::waitForFrame(
+    const std::chrono::steady_clock::time_point &last_frame,
+    const double period, const bool success, const bool realtime)
+{
+  using namespace std::chrono;
 
-  /* Lock the log output. */
-  std::lock_guard< std::mutex > locker(_log_lock);
+  if (_grab_wait == GrabWait::Blocking)
+  {
+    /* GetFrame() blocks in ServerPush, only back off if it failed. A
+       source failing fast, like a finished replay, must not spin, and a
+       yield gives nothing to lower priorities under real-time scheduling. */
+    if (!success)
+      std::this_thread::sleep_for(microseconds(100));
+  }
+  else if (_grab_wait == GrabWait::Adaptive && period > 0)
+  {
+    /* Sleep until a guard interval before the next expected frame, then
+       poll without sleeping so the frame is picked up on arrival. Late
+       frames fall back to short sleeps to not spin on a stalled stream.
+       Under real-time scheduling the poll starves lower priorities, so it
+       ends a guard interval after the expected arrival. */
+    const auto p     = duration_cast< nanoseconds >(duration< double >(period));
+    const auto guard = std::min< nanoseconds >(p / 4, microseconds(500));
+    const auto poll  = realtime ? guard : p / 2;
+    const auto now   = steady_clock::now();
 
-  /* Send it to the log ostream. */
-  _log << "[" << res << "] ViconLog: " << log << std::endl;
+    if (now < last_frame + p - guard)
+      std::this_thread::sleep_until(last_frame + p - guard);
+    else if (now < last_frame + p + poll)
+      std::this_thread::yield();
+    else
+      std::this_thread::sleep_for(microseconds(100));
+  }
+  else
+    std::this_thread::sleep_for(milliseconds(1));
 }
 
 void arbiter::frameGrabberWorker()
 {
   logString("Frame grabber thread started!");
 
-  Output_GetFrame f;
+  applyRealtime(_realtime.grabber, "frame grabber");
+  const bool realtime = isRealtimeThread();
+
+  /* The frame fetched by enableStream() is delivered first. */
+  bool success = true, fetched = true;
   unsigned int framenumber, old_framenumber = 0;
   bool startup = true;
 
+  /* Arrival time and period of frames, for the adaptive wait. */
+  auto last_frame = std::chrono::steady_clock::now();
+  double period   = 0;
+
+  /* Losses not yet logged, and when they were last logged. */
+  uint64_t unreported_lost = 0, unreported_gaps = 0;
+  auto last_report = last_frame - loss_report_interval;
+
+  const auto stall_timeout = _connection_settings.stall_timeout;
+
+  /* The most recent frames, newest first, for pose prediction. */
+  frame_ptr history[recent_frames::depth];
+
+  _grabber_id = std::this_thread::get_id();
+
+  /* The grabber's snapshot of the registry, reloaded when swapped. */
+  uint64_t reg_version = _registry_version.load();
+  auto reg             = std::atomic_load(&_registry);
+
   while (!_shutdown)
   {
     /* Check so there is an active connection. */
-    if (_vicon_client.IsConnected().Connected)
+    if (_source->isConnected())
     {
-      f           = _vicon_client.GetFrame();
-      framenumber = _vicon_client.GetFrameNumber().FrameNumber;
+      if (!fetched)
+        success = _source->getFrame();
+
+      fetched     = false;
+      framenumber = _source->frameNumber();
 
-      if ((f.Result == Result::Success) && (framenumber > old_framenumber))
+      if (success && (framenumber > old_framenumber))
       {
         const unsigned int df = framenumber - old_framenumber;
 
-        /* Check if frames have been skipped.  */
-        if (df > 1)
+        /* Check if frames have been skipped, the first frame's number is
+           relative to nothing. */
+        if (df > 1 && !startup)
         {
-          if (startup)
-            startup = false;
-          else
-            logString("Warning! " + std::to_string(df - 1) +
-                      " frames have been lost.");
+          _frame_counters.recordGap(df - 1);
+          unreported_lost += df - 1;
+          unreported_gaps++;
         }
 
+        startup         = false;
         old_framenumber = framenumber;
+        last_frame      = std::chrono::steady_clock::now();
+
+        _frame_counters.recordFrame(last_frame);
+
+        /* Logging allocates and locks, keep it off every gap. */
+        if (unreported_lost > 0 &&
+            last_frame - last_report >= loss_report_interval)
+        {
+          _log.logf(LogLevel::Warning,
+                    "Warning! %llu frames have been lost in %llu gaps.",
+                    static_cast< unsigned long long >(unreported_lost),
+                    static_cast< unsigned long long >(unreported_gaps));
 
-        /* Since all information is stored in the Client object it
-           will be passed by reference for the used to extract the
-           needed data, but not to run more code in the callback.
+          unreported_lost = 0;
+          unreported_gaps = 0;
+          last_report     = last_frame;
+        }
+
+        /* Extract the frame once, all subscribers share the snapshot
+           instead of doing their own lookups in the Client object.
         */
-        std::lock_guard< std::mutex > locker(_id_cblock);
+        /* Marks the start of dispatch, see waitForDispatch(). */
+        _dispatch_seq.fetch_add(1);
+
+        const uint64_t version = _registry_version.load();
+        if (version != reg_version)
+        {
+          reg_version = version;
+          reg         = std::atomic_load(&_registry);
+        }
+
+        std::shared_ptr< frame > snapshot = acquireFrame();
+        _source->extract(*snapshot, reg->filter);
+        updateHandles(*snapshot);
+
+        snapshot->latency.received = last_frame;
+        _motion.update(*snapshot);
+
+        if (_arrivals.record(last_frame, framenumber, snapshot->frame_rate))
+          _log.logf(LogLevel::Warning,
+                    "Warning: Frame rate changed from %.1f Hz to %.1f Hz.",
+                    _arrivals.summary().previous_rate, _arrivals.rate());
+
+        snapshot->latency.dispatched = std::chrono::steady_clock::now();
+
+        _server_latency.record(
+            static_cast< int64_t >(snapshot->latency.server_total * 1e9));
+        _extraction_latency.record(
+            std::chrono::duration_cast< std::chrono::nanoseconds >(
+                snapshot->latency.dispatched - last_frame)
+                .count());
+
+        if (snapshot->frame_rate > 0)
+          period = 1.0 / snapshot->frame_rate;
+
+        const frame_ptr shared = snapshot;
 
-        for (auto &cb : callbacks)
-          cb.second(_vicon_client);
+        /* Publish for the polling readers. */
+        frame_ptr *latest = _latest.acquire();
+        if (latest)
+        {
+          *latest = shared;
+          _latest.publish(latest);
+        }
+
+        for (unsigned int i = recent_frames::depth - 1; i > 0; i--)
+          history[i] = std::move(history[i - 1]);
+
+        history[0] = shared;
+
+        recent_frames *recent = _recent.acquire();
+        if (recent)
+        {
+          for (unsigned int i = 0; i < recent_frames::depth; i++)
+            recent->frames[i] = history[i];
+
+          _recent.publish(recent);
+        }
+
+        if (reg->history)
+          reg->history->record(*shared);
+
+        for (auto &cb : reg->callbacks)
+        {
+          if (!cb.second->wants(*shared))
+            continue;
+
+          if (cb.second->mode == DispatchMode::Async)
+            cb.second->push(shared);
+          else
+            cb.second->deliver(*shared);
+        }
+
+        _dispatch_seq.fetch_add(1);
       }
       else
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      {
+        if (success)
+          _frame_counters.recordStale();
+
+        /* A silent server is treated as lost, if configured. */
+        if (stall_timeout.count() > 0 &&
+            std::chrono::steady_clock::now() - last_frame > stall_timeout)
+        {
+          _log.logf(LogLevel::Warning,
+                    "Warning: No frames for %lld ms, reconnecting.",
+                    static_cast< long long >(stall_timeout.count()));
+          break;
+        }
+
+        waitForFrame(last_frame, period, success, realtime);
+      }
     }
     else
     {
-      logString(
-          "Frame grabber is running but no connection... \
-                        Something is horribly wrong!");
-
-      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      /* The connection manager reconnects. */
+      logString("Warning: Connection to " + _host_name + " lost!",
+                LogLevel::Warning);
+      break;
     }
   }
-}
 
-/*********************************
- * Public members
- ********************************/
+  _grabber_id = std::thread::id();
 
-arbiter::arbiter(std::string hostname, std::ostream &log_output)
-    : _host_name(hostname), _log(log_output)
-{
-  _tp_start = std::chrono::high_resolution_clock::now();
+  {
+    std::lock_guard< std::mutex > locker(_connection_lock);
+    _grabber_exited = true;
+  }
+
+  _connection_cv.notify_all();
 }
 
-arbiter::~arbiter()
+bool arbiter::establishConnection()
 {
-  if (_shutdown == false)
-    disableStream();
+  logString("Connecting to " + _host_name + "...");
+
+  if (!_source->isConnected() && !_source->connect())
+    return false;
+
+  logString("Success! Connected to " + _host_name);
+
+  /* Data types, stream mode and axis mapping are lost with the connection,
+     apply them on every connection. */
+  _source->configure(_stream_settings);
+
+  /* Testing the frame grabber. */
+  bool started = false;
+
+  for (int i = 0; i < 10 && !started; i++)
+    started = _source->getFrame();
+
+  if (!started)
+  {
+    logString("Frame grabber startup failed!", LogLevel::Error);
+    _source->disconnect();
+
+    return false;
+  }
+
+  /* The frame rate is not valid until a few frames have been received. */
+  double framerate = _source->frameRate();
+
+  for (int i = 0; i < 100 && framerate == 0; i++)
+  {
+    _source->getFrame();
+    framerate = _source->frameRate();
+  }
+
+  if (framerate > 0)
+  {
+    std::stringstream s;
+    s << framerate;
+    logString("Frame rate:              " + s.str() + " Hz");
+  }
+  else
+  {
+    logString("Frame rate:              Unknown");
+  }
+
+  return true;
 }
 
-bool arbiter::enableStream(const bool enableSegmentData,
-                           const bool enableMarkerData,
-                           const bool enableUnlabeledMarkerData,
-                           const bool enableDeviceData,
-                           const StreamMode::Enum streamMode)
+void arbiter::connectionWorker()
 {
-  _shutdown = false;
+  const connection_settings settings = _connection_settings;
 
-  logString("Connecting to " + _host_name + "...");
+  _connection_id = std::this_thread::get_id();
 
-  int cnt = 0;
+  auto backoff        = settings.initial_backoff;
+  unsigned int failed = 0;
+  bool connected_once = false;
 
-  /* Try to connect to the Vicon host. */
-  while (!_vicon_client.IsConnected().Connected)
+  while (!_shutdown)
   {
-    /* Connection failed. */
-    if (cnt >= 3)
+    if (!establishConnection())
     {
-      logString("Error: Connection failed, aborting!");
-      return false;
+      failed++;
+
+      /* Only the first connection gives up, a lost one is always retried. */
+      if (!connected_once && settings.connect_attempts > 0 &&
+          failed >= settings.connect_attempts)
+      {
+        logString("Error: Connection failed, aborting!", LogLevel::Error);
+
+        /* The stream is disabled again, it may be enabled anew. */
+        {
+          std::lock_guard< std::mutex > locker(_connection_lock);
+          _shutdown = true;
+        }
+
+        setState(ConnectionState::Failed);
+        return;
+      }
+
+      _log.logf(LogLevel::Warning,
+                "Warning: Connection failed, retrying in %lld ms...",
+                static_cast< long long >(backoff.count()));
+
+      if (!connectionSleep(backoff))
+        break;
+
+      backoff = std::min(backoff * 2, settings.max_backoff);
+      continue;
     }
 
-    if (_vicon_client.Connect(_host_name).Result != Result::Success)
+    if (connected_once)
+      _reconnects.fetch_add(1, std::memory_order_relaxed);
+
+    connected_once = true;
+    failed         = 0;
+    backoff        = settings.initial_backoff;
+
     {
-      logString("Warning: Connection failed, retrying...");
-      cnt++;
+      std::lock_guard< std::mutex > locker(_connection_lock);
+      _grabber_exited = false;
     }
-    else
+
+    /* A new grabber per connection starts over with the frame numbers, a
+       restarted server counts from zero again. */
+    logString("Starting the frame grabber thread...");
+    _frame_grabber = std::thread(&arbiter::frameGrabberWorker, this);
+    setState(ConnectionState::Connected);
+
     {
-      logString("Success! Connected to " + _host_name);
-      break;
+      std::unique_lock< std::mutex > locker(_connection_lock);
+      _connection_cv.wait(locker,
+                          [this]() { return _grabber_exited || _shutdown; });
     }
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    _frame_grabber.join();
+
+    if (_shutdown)
+      break;
+
+    _source->disconnect();
+    setState(ConnectionState::Reconnecting);
+  }
+}
+
+void arbiter::setState(const ConnectionState::Enum state)
+{
+  std::map< unsigned int, connection_callback > callbacks;
+
+  {
+    std::lock_guard< std::mutex > locker(_connection_lock);
+
+    if (_state == state)
+      return;
+
+    _state    = state;
+    callbacks = _state_callbacks;
   }
 
-  /*
-   * Connection established, apply settings.
-   */
+  _connection_cv.notify_all();
+
+  for (auto &cb : callbacks)
+    cb.second(state);
+}
+
+bool arbiter::connectionSleep(const std::chrono::milliseconds time)
+{
+  std::unique_lock< std::mutex > locker(_connection_lock);
+
+  return !_connection_cv.wait_for(locker, time,
+                                  [this]() { return bool(_shutdown); });
+}
+
+bool arbiter::startStream(const bool enableSegmentData,
+                          const bool enableMarkerData,
+                          const bool enableUnlabeledMarkerData,
+                          const bool enableDeviceData,
+                          const StreamMode::Enum streamMode,
+                          const GrabWait::Enum grabWait)
+{
+  if (!_shutdown)
+    return false;
+
+  /* A connection manager which gave up may still be notifying Failed. */
+  reapConnection();
+
+  _shutdown  = false;
+  _grab_wait = grabWait;
 
   /* Enable data based on the selected inputs. */
+  _stream_settings.segment_data          = enableSegmentData;
+  _stream_settings.marker_data           = enableMarkerData;
+  _stream_settings.unlabeled_marker_data = enableUnlabeledMarkerData;
+  _stream_settings.device_data           = enableDeviceData;
+  _stream_settings.stream_mode           = streamMode;
+
   if (enableSegmentData)
-  {
-    _vicon_client.EnableSegmentData();
     logString("Segment Data:            enabled");
-  }
   else
-  {
-    _vicon_client.DisableSegmentData();
     logString("Segment Data:            disabled");
-  }
 
   if (enableMarkerData)
-  {
-    _vicon_client.EnableMarkerData();
     logString("Marker Data:             enabled");
-  }
   else
-  {
-    _vicon_client.DisableMarkerData();
     logString("Marker Data:             disabled");
-  }
 
   if (enableUnlabeledMarkerData)
-  {
-    _vicon_client.EnableUnlabeledMarkerData();
     logString("Unlabeled Marker Data:   enabled");
-  }
   else
-  {
-    _vicon_client.DisableUnlabeledMarkerData();
     logString("Unlabeled Marker Data:   disabled");
-  }
 
   if (enableDeviceData)
-  {
-    _vicon_client.EnableDeviceData();
     logString("Device Data:             enabled");
-  }
   else
-  {
-    _vicon_client.DisableDeviceData();
     logString("Device Data:             disabled");
-  }
-
-  /* Set stream mode */
-  _vicon_client.SetStreamMode(streamMode);
 
   if (streamMode == StreamMode::ServerPush)
     logString("Stream mode:             ServerPush");
@@ -208,97 +663,606 @@ bool arbiter::enableStream(const bool enableSegmentData,
   else
     logString("Stream mode:             ClientPullPreFetch");
 
-  /* Set axis mapping (Z up) */
-  _vicon_client.SetAxisMapping(Direction::Forward, Direction::Left,
-                               Direction::Up);
+  /* Only ServerPush blocks in GetFrame(), the pull modes would spin. */
+  if (_grab_wait == GrabWait::Blocking && streamMode != StreamMode::ServerPush)
+  {
+    logString("Warning: Blocking grab wait requires ServerPush.",
+              LogLevel::Warning);
+    _grab_wait = GrabWait::Adaptive;
+  }
 
-  /* Testing the frame grabber. */
-  Output_GetFrame f;
+  if (_grab_wait == GrabWait::FixedSleep)
+    logString("Grab wait:               FixedSleep");
+  else if (_grab_wait == GrabWait::Blocking)
+    logString("Grab wait:               Blocking");
+  else
+    logString("Grab wait:               Adaptive");
 
-  for (int i = 0; i < 10; i++)
+  if (_realtime.lock_memory)
   {
-    f = _vicon_client.GetFrame();
+    std::string errors;
 
-    if (f.Result == Result::Success)
-    {
-      break;
-    }
+    if (lockMemory(errors))
+      logString("Memory:                  locked");
     else
-    {
-      /* Checking if end of look. */
-      if (i == 9)
-      {
-        logString("Frame grabber startup failed, aborting!");
-        _vicon_client.Disconnect();
+      logString("Warning: Memory not locked: " + errors, LogLevel::Warning);
+  }
 
-        return false;
-      }
-    }
+  setState(ConnectionState::Connecting);
+
+  {
+    std::lock_guard< std::mutex > locker(_connection_lock);
+    _connection = std::thread(&arbiter::connectionWorker, this);
   }
 
-  std::stringstream s;
-  Output_GetFrameRate framerate = _vicon_client.GetFrameRate();
+  return true;
+}
+
+void arbiter::reapConnection()
+{
+  std::thread connection;
 
-  while (std::isinf(framerate.FrameRateHz) || std::isnan(framerate.FrameRateHz))
   {
-    f         = _vicon_client.GetFrame();
-    framerate = _vicon_client.GetFrameRate();
-  };
+    std::lock_guard< std::mutex > locker(_connection_lock);
+    connection = std::move(_connection);
+  }
 
-  if (framerate.Result == Result::Success)
+  if (connection.joinable())
   {
-    s << _vicon_client.GetFrameRate().FrameRateHz;
-    logString("Frame rate:              " + s.str() + " Hz");
+    /* A state callback enabling the stream cannot join its own thread. */
+    if (_connection_id.load() == std::this_thread::get_id())
+      connection.detach();
+    else
+      connection.join();
   }
-  else
+}
+
+void arbiter::applyRealtime(const thread_settings &settings,
+                            const char *thread)
+{
+  std::string errors;
+
+  if (!applyThreadSettings(settings, errors))
+    _log.logf(LogLevel::Warning,
+              "Warning: Real-time settings of the %s not applied: %s",
+              thread, errors.c_str());
+}
+
+void arbiter::callbackWorker(std::shared_ptr< subscriber > sub)
+{
+  frame_ptr f;
+
+  applyRealtime(_realtime.dispatch, "async dispatcher");
+
+  current_worker = sub.get();
+
+  /* Only the subscriber is used here, as the worker may outlive the
+     arbiter's bookkeeping when a callback unregisters itself. */
+  while (sub->pop(f))
   {
-    logString("Frame rate:              Unknown");
+    sub->deliver(*f);
+
+    /* Give the frame back to the pool as soon as possible. */
+    f.reset();
+  }
+}
+
+void arbiter::stopSubscriber(const std::shared_ptr< subscriber > &sub)
+{
+  sub->stop();
+
+  if (sub->worker.joinable())
+  {
+    /* A callback unregistering itself cannot join its own thread. */
+    if (sub->worker.get_id() == std::this_thread::get_id())
+      sub->worker.detach();
+    else
+      sub->worker.join();
+  }
+}
+
+/*********************************
+ * Public members
+ ********************************/
+
+connection_settings::connection_settings()
+    : connect_attempts(3),
+      initial_backoff(500),
+      max_backoff(8000),
+      stall_timeout(0)
+{
+}
+
+arbiter::arbiter(std::string hostname, std::ostream &log_output,
+                 const log_settings &log)
+    : arbiter(std::unique_ptr< frame_source >(new vicon_source(hostname)),
+              log_output, log)
+{
+}
+
+arbiter::arbiter(std::unique_ptr< frame_source > source,
+                 std::ostream &log_output, const log_settings &log)
+    : _id(0),
+      _registry(std::make_shared< registry >()),
+      _registry_version(0),
+      _dispatch_seq(0),
+      _source(std::move(source)),
+      _host_name(_source->name()),
+      _log(log_output, log),
+      _shutdown(true),
+      _state(ConnectionState::Disconnected),
+      _grabber_exited(false),
+      _state_id(0),
+      _reconnects(0),
+      _grab_wait(GrabWait::Adaptive),
+      _handles_generation(0)
+{
+}
+
+arbiter::~arbiter()
+{
+  /* Also reaps a connection manager which gave up. */
+  disableStream();
+
+  std::shared_ptr< const registry > reg;
+
+  {
+    std::lock_guard< std::mutex > locker(_id_cblock);
+    reg = std::atomic_load(&_registry);
+    publishRegistry(std::make_shared< registry >());
+  }
+
+  for (auto &cb : reg->callbacks)
+    stopSubscriber(cb.second);
+}
+
+bool arbiter::enableStream(const bool enableSegmentData,
+                           const bool enableMarkerData,
+                           const bool enableUnlabeledMarkerData,
+                           const bool enableDeviceData,
+                           const StreamMode::Enum streamMode,
+                           const GrabWait::Enum grabWait)
+{
+  if (!startStream(enableSegmentData, enableMarkerData,
+                   enableUnlabeledMarkerData, enableDeviceData, streamMode,
+                   grabWait))
+    return false;
+
+  /* Wait for the first connection, or for its attempts to run out. */
+  {
+    std::unique_lock< std::mutex > locker(_connection_lock);
+    _connection_cv.wait(locker, [this]() {
+      return _state != ConnectionState::Connecting;
+    });
   }
 
-  /* Start the frame grabber/data pump thread. */
-  logString("Starting the frame grabber thread...");
-  _frame_grabber = std::thread(&arbiter::frameGrabberWorker, this);
+  /* The connection manager is reaped by the next enable or disable. */
+  if (_state == ConnectionState::Failed)
+    return false;
 
   return true;
 }
 
+bool arbiter::enableStreamAsync(const bool enableSegmentData,
+                                const bool enableMarkerData,
+                                const bool enableUnlabeledMarkerData,
+                                const bool enableDeviceData,
+                                const StreamMode::Enum streamMode,
+                                const GrabWait::Enum grabWait)
+{
+  return startStream(enableSegmentData, enableMarkerData,
+                     enableUnlabeledMarkerData, enableDeviceData, streamMode,
+                     grabWait);
+}
+
 void arbiter::disableStream()
 {
-  if (_vicon_client.IsConnected().Connected || !_shutdown)
+  bool enabled;
+
+  {
+    std::lock_guard< std::mutex > locker(_connection_lock);
+    enabled   = !_shutdown || _connection.joinable();
+    _shutdown = true;
+  }
+
+  if (enabled)
   {
     logString("Terminating the frame grabber...");
+    _connection_cv.notify_all();
 
-    _shutdown = true;
-    _frame_grabber.join();
+    /* The connection manager joins the frame grabber. */
+    reapConnection();
 
     logString("Frame grabber terminated!");
 
-    _vicon_client.Disconnect();
+    _source->disconnect();
+    setState(ConnectionState::Disconnected);
 
     logString("Connection to " + _host_name + " closed.");
   }
+
+  /* The stream is complete when disabled, the log is written async. */
+  _log.flush();
+}
+
+bool arbiter::setConnectionSettings(const connection_settings &settings)
+{
+  if (!_shutdown)
+    return false;
+
+  _connection_settings = settings;
+
+  return true;
+}
+
+bool arbiter::setRealtimeSettings(const realtime_settings &settings)
+{
+  if (!_shutdown)
+    return false;
+
+  _realtime = settings;
+
+  return true;
 }
 
-unsigned int arbiter::registerCallback(viconstream_callback callback)
+ConnectionState::Enum arbiter::connectionState() const
 {
+  return _state;
+}
+
+unsigned int arbiter::registerConnectionCallback(connection_callback callback)
+{
+  std::lock_guard< std::mutex > locker(_connection_lock);
+
+  _state_callbacks[_state_id] = callback;
+
+  return _state_id++;
+}
+
+bool arbiter::unregisterConnectionCallback(const unsigned int id)
+{
+  std::lock_guard< std::mutex > locker(_connection_lock);
+
+  return _state_callbacks.erase(id) > 0;
+}
+
+uint64_t arbiter::reconnects() const
+{
+  return _reconnects.load(std::memory_order_relaxed);
+}
+
+unsigned int arbiter::registerCallback(viconstream_callback callback,
+                                       const DispatchMode::Enum mode,
+                                       const size_t queue_size,
+                                       const OverflowPolicy::Enum policy)
+{
+  return registerCallback(subscription(), callback, mode, queue_size, policy);
+}
+
+unsigned int arbiter::registerCallback(const subscription &filter,
+                                       viconstream_callback callback,
+                                       const DispatchMode::Enum mode,
+                                       const size_t queue_size,
+                                       const OverflowPolicy::Enum policy)
+{
+  std::vector< subject_handle > handles;
+
+  for (auto &s : filter.subjects)
+    handles.push_back(_names.subject(s));
+
+  auto sub = std::make_shared< subscriber >(callback, mode, queue_size,
+                                            policy, filter, handles);
+
+  /* Async subscribers get their own worker thread. */
+  if (mode == DispatchMode::Async)
+    sub->worker = std::thread(&arbiter::callbackWorker, this, sub);
+
   std::lock_guard< std::mutex > locker(_id_cblock);
 
-  /* Add the callback to the list. */
-  callbacks.emplace(_id, callback);
+  /* Add the callback to a copy of the registry, the grabber keeps
+     dispatching from the current one until the swap. */
+  auto reg = std::make_shared< registry >(*std::atomic_load(&_registry));
+  reg->callbacks.emplace(_id, sub);
+  publishRegistry(std::move(reg));
 
   return _id++;
 }
 
 bool arbiter::unregisterCallback(const unsigned int id)
 {
-  std::lock_guard< std::mutex > locker(_id_cblock);
+  std::shared_ptr< subscriber > sub;
+
+  {
+    std::lock_guard< std::mutex > locker(_id_cblock);
+
+    auto reg = std::make_shared< registry >(*std::atomic_load(&_registry));
+    auto it  = reg->callbacks.find(id);
 
-  /* Delete the callback with correct ID. */
-  if (callbacks.erase(id) > 0)
-    return true;
-  else
     /* No match, return false. */
+    if (it == reg->callbacks.end())
+      return false;
+
+    sub = it->second;
+    reg->callbacks.erase(it);
+    publishRegistry(std::move(reg));
+  }
+
+  /* Stop the worker outside the lock, it may be waiting on the grabber.
+     A stopped subscriber is skipped by a dispatch still using the old
+     registry. */
+  stopSubscriber(sub);
+
+  /* An inline callback may be running on the grabber right now, wait for
+     it unless it is the one unregistering. An async worker waiting here
+     cannot empty its queue, so a grabber blocked on it must drop instead. */
+  if (sub->mode == DispatchMode::Inline &&
+      _grabber_id.load() != std::this_thread::get_id())
+  {
+    if (current_worker)
+      current_worker->giveWay(true);
+
+    waitForDispatch();
+
+    if (current_worker)
+      current_worker->giveWay(false);
+  }
+
+  return true;
+}
+
+bool arbiter::callbackStats(const unsigned int id, subscriber_stats &stats)
+{
+  auto reg = std::atomic_load(&_registry);
+  auto it  = reg->callbacks.find(id);
+
+  if (it == reg->callbacks.end())
+    return false;
+
+  stats = it->second->stats();
+
+  return true;
+}
+
+void arbiter::latencyStats(latency_stats &stats)
+{
+  latency_histogram start, duration;
+
+  auto reg = std::atomic_load(&_registry);
+
+  for (auto &cb : reg->callbacks)
+  {
+    start.add(cb.second->callback_start);
+    duration.add(cb.second->callback_duration);
+  }
+
+  stats.server            = _server_latency.summary();
+  stats.extraction        = _extraction_latency.summary();
+  stats.callback_start    = start.summary();
+  stats.callback_duration = duration.summary();
+}
+
+void arbiter::resetLatencyStats()
+{
+  _server_latency.reset();
+  _extraction_latency.reset();
+
+  auto reg = std::atomic_load(&_registry);
+
+  for (auto &cb : reg->callbacks)
+  {
+    cb.second->callback_start.reset();
+    cb.second->callback_duration.reset();
+  }
+}
+
+void arbiter::frameStats(frame_stats &stats)
+{
+  stats = _frame_counters.summary();
+}
+
+void arbiter::resetFrameStats()
+{
+  _frame_counters.reset();
+}
+
+void arbiter::arrivalStats(arrival_stats &stats)
+{
+  stats = _arrivals.summary();
+}
+
+void arbiter::resetArrivalStats()
+{
+  _arrivals.reset();
+}
+
+frame_ptr arbiter::latestFrame()
+{
+  auto latest = _latest.read();
+
+  if (latest)
+    return *latest;
+  else
+    return nullptr;
+}
+
+bool arbiter::latestPose(const std::string &subject, pose &p)
+{
+  /* Read through the pinned slot, no reference count is touched. */
+  auto latest = _latest.read();
+
+  if (!latest)
+    return false;
+
+  const pose *sp = (*latest)->subjectPose(subject);
+
+  if (sp == nullptr)
+    return false;
+
+  p = *sp;
+
+  return true;
+}
+
+bool arbiter::latestPose(const std::string &subject,
+                         const std::string &segment, pose &p)
+{
+  auto latest = _latest.read();
+
+  if (!latest)
+    return false;
+
+  const int idx = (*latest)->findSegment(subject, segment);
+
+  if (idx < 0)
     return false;
+
+  p = (*latest)->segments[idx].global;
+
+  return true;
+}
+
+subject_handle arbiter::subjectHandle(const std::string &subject)
+{
+  return _names.subject(subject);
+}
+
+segment_handle arbiter::segmentHandle(const std::string &subject,
+                                      const std::string &segment)
+{
+  return _names.segment(subject, segment);
+}
+
+marker_handle arbiter::markerHandle(const std::string &subject,
+                                    const std::string &marker)
+{
+  return _names.marker(subject, marker);
+}
+
+bool arbiter::latestPose(const subject_handle subject, pose &p)
+{
+  auto latest = _latest.read();
+
+  if (!latest)
+    return false;
+
+  const pose *sp = (*latest)->subjectPose(subject);
+
+  if (sp == nullptr)
+    return false;
+
+  p = *sp;
+
+  return true;
+}
+
+bool arbiter::latestPose(const segment_handle segment, pose &p)
+{
+  auto latest = _latest.read();
+
+  if (!latest)
+    return false;
+
+  const pose *sp = (*latest)->segmentPose(segment);
+
+  if (sp == nullptr)
+    return false;
+
+  p = *sp;
+
+  return true;
+}
+
+bool arbiter::predictPose(const subject_handle subject,
+                          const std::chrono::steady_clock::time_point &t,
+                          pose &p, const Prediction::Enum model)
+{
+  auto recent = _recent.read();
+
+  if (!recent)
+    return false;
+
+  return predict(recent->frames, recent_frames::depth,
+                 [subject](const frame &f) {
+                   return rootSegment(f, f.findSubject(subject));
+                 },
+                 t, model, p);
+}
+
+bool arbiter::predictPose(const segment_handle segment,
+                          const std::chrono::steady_clock::time_point &t,
+                          pose &p, const Prediction::Enum model)
+{
+  auto recent = _recent.read();
+
+  if (!recent)
+    return false;
+
+  return predict(recent->frames, recent_frames::depth,
+                 [segment](const frame &f) { return f.findSegment(segment); },
+                 t, model, p);
+}
+
+bool arbiter::predictPose(const std::string &subject,
+                          const std::chrono::steady_clock::time_point &t,
+                          pose &p, const Prediction::Enum model)
+{
+  auto recent = _recent.read();
+
+  if (!recent)
+    return false;
+
+  return predict(recent->frames, recent_frames::depth,
+                 [&subject](const frame &f) {
+                   return rootSegment(f, f.findSubject(subject));
+                 },
+                 t, model, p);
+}
+
+bool arbiter::setMotionSettings(const motion_settings &settings)
+{
+  if (!_shutdown)
+    return false;
+
+  _motion.reset(settings);
+
+  return true;
+}
+
+bool arbiter::enablePoseHistory(const history_settings &settings)
+{
+  if (!_shutdown)
+    return false;
+
+  std::lock_guard< std::mutex > locker(_id_cblock);
+
+  /* Readers of the previous history keep it alive through the old
+     registry. */
+  _history = std::make_shared< pose_history >(settings);
+
+  /* Widen the extraction to all subjects. */
+  publishRegistry(
+      std::make_shared< registry >(*std::atomic_load(&_registry)));
+
+  return true;
+}
+
+bool arbiter::poseAt(const subject_handle subject,
+                     const std::chrono::steady_clock::time_point &t, pose &p,
+                     const Interpolation::Enum mode)
+{
+  const auto history = std::atomic_load(&_registry)->history;
+
+  if (!history)
+    return false;
+
+  return history->poseAt(subject, t, p, mode);
+}
+
+bool arbiter::poseAt(const std::string &subject,
+                     const std::chrono::steady_clock::time_point &t, pose &p,
+                     const Interpolation::Enum mode)
+{
+  return poseAt(_names.subject(subject), t, p, mode);
 }
 
 } // end libviconstream